@@ -0,0 +1,2189 @@
+/**
+ * @file benchmark.cpp
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief Micro benchmarks of the hot paths, run against a simulated board.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <functional>
+#include <new>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "benchmark.h"
+#include "broker.h"
+#include "broker_client.h"
+#include "edge_recorder.h"
+#include "gpio.h"
+#include "gpio_pin_data.h"
+#include "input_capture.h"
+#include "pin_state.h"
+#include "quadrature_decoder.h"
+#include "realtime.h"
+#include "sim_board.h"
+#include "static_gpio.h"
+#include "trace.h"
+
+using jetson::bench::NowNs;
+using jetson::bench::Reporter;
+
+namespace {
+
+// Allocations of the whole process, counted by every form of operator new
+// below.
+std::atomic<uint64_t> g_allocations{0};
+
+// Out of line, so the compiler does not match the free() of operator delete
+// against the malloc() of operator new.
+__attribute__((noinline)) void* Allocate(std::size_t size,
+                                         std::size_t alignment) noexcept {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (size == 0) size = 1;
+  if (alignment <= alignof(std::max_align_t)) return std::malloc(size);
+  return std::aligned_alloc(alignment,
+                            (size + alignment - 1) / alignment * alignment);
+}
+
+__attribute__((noinline)) void Release(void* p) noexcept { std::free(p); }
+
+void* AllocateOrThrow(std::size_t size, std::size_t alignment) {
+  if (void* p = Allocate(size, alignment)) return p;
+  throw std::bad_alloc();
+}
+
+}  // namespace
+
+void* operator new(std::size_t size) { return AllocateOrThrow(size, 0); }
+
+void* operator new[](std::size_t size) { return AllocateOrThrow(size, 0); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  return Allocate(size, 0);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return Allocate(size, 0);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  return AllocateOrThrow(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+  return AllocateOrThrow(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment,
+                   const std::nothrow_t&) noexcept {
+  return Allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment,
+                     const std::nothrow_t&) noexcept {
+  return Allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* p) noexcept { Release(p); }
+
+void operator delete[](void* p) noexcept { Release(p); }
+
+void operator delete(void* p, std::size_t) noexcept { Release(p); }
+
+void operator delete[](void* p, std::size_t) noexcept { Release(p); }
+
+void operator delete(void* p, const std::nothrow_t&) noexcept { Release(p); }
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept { Release(p); }
+
+void operator delete(void* p, std::align_val_t) noexcept { Release(p); }
+
+void operator delete[](void* p, std::align_val_t) noexcept { Release(p); }
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+  Release(p);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept {
+  Release(p);
+}
+
+void operator delete(void* p, std::align_val_t,
+                     const std::nothrow_t&) noexcept {
+  Release(p);
+}
+
+void operator delete[](void* p, std::align_val_t,
+                       const std::nothrow_t&) noexcept {
+  Release(p);
+}
+
+namespace {
+
+struct Context {
+  jetson::SimulatedBoard& board;
+  Reporter& reporter;
+  int iterations;
+
+  // Board mode channels picked from the pin table of the simulated board.
+  std::string output_channel = {};
+  std::string input_channel = {};
+  std::string pwm_channel = {};
+  std::vector<std::string> pwm_channels = {};
+  std::vector<std::string> binary_channels = {};
+
+  int failures = 0;
+};
+
+using Case = std::pair<const char*, std::function<void(Context&)>>;
+
+void Check(const jetson::JResult& result) {
+  if (!result.second) throw std::runtime_error(result.first);
+}
+
+template <typename T>
+T Check(const jetson::JOutcome<T>& result) {
+  if (!result.second) throw std::runtime_error(result.first);
+  return result.second;
+}
+
+void SetUp(jetson::Gpio& gpio) {
+  Check(gpio.Detect());
+  Check(gpio.SetMode(jetson::BoardMode::BOARD));
+}
+
+void BenchDetect(Context& ctx) {
+  std::vector<double> samples;
+  for (int i = 0; i < ctx.iterations / 10; i++) {
+    jetson::Gpio gpio(ctx.board.GetRoot());
+    auto start = NowNs();
+    Check(gpio.Detect());
+    samples.push_back(NowNs() - start);
+  }
+  ctx.reporter.Add("detect", samples);
+}
+
+void BenchCreateDestroyBinary(Context& ctx) {
+  jetson::Gpio gpio(ctx.board.GetRoot());
+  SetUp(gpio);
+
+  // The first creation exports the line and waits for sysfs to catch up.
+  auto start = NowNs();
+  Check(gpio.CreateBinary(ctx.output_channel, jetson::Direction::OUT));
+  gpio.DestroyBinary(ctx.output_channel);
+  double first = NowNs() - start;
+
+  std::vector<double> samples;
+  for (int i = 0; i < ctx.iterations / 10; i++) {
+    start = NowNs();
+    Check(gpio.CreateBinary(ctx.output_channel, jetson::Direction::OUT));
+    gpio.DestroyBinary(ctx.output_channel);
+    samples.push_back(NowNs() - start);
+  }
+  ctx.reporter.Add("binary_create_destroy", samples, {{"first_ns", first}});
+}
+
+/**
+ * Teardown of a full header: every binary channel, inputs watched, destroyed
+ * at once and one by one, and every pwm channel destroyed at once.
+ */
+void BenchTeardown(Context& ctx) {
+  const int kRounds = std::max(10, ctx.iterations / 100);
+  jetson::Gpio gpio(ctx.board.GetRoot());
+  SetUp(gpio);
+
+  auto create_binaries = [&] {
+    bool input = false;
+    for (const auto& channel : ctx.binary_channels) {
+      input = !input;
+      if (!input) {
+        Check(gpio.CreateBinary(channel, jetson::Direction::OUT));
+        continue;
+      }
+      auto line = Check(gpio.CreateBinary(channel, jetson::Direction::IN));
+      line->RegisterCallback(jetson::TriggerEdge::BOTH, [](int) {});
+    }
+  };
+
+  std::vector<double> all;
+  std::vector<double> each;
+  std::vector<double> pwms;
+  for (int i = 0; i < kRounds; i++) {
+    create_binaries();
+    auto start = NowNs();
+    gpio.DestroyBinary();
+    all.push_back(NowNs() - start);
+
+    create_binaries();
+    start = NowNs();
+    for (const auto& channel : ctx.binary_channels) gpio.DestroyBinary(channel);
+    each.push_back(NowNs() - start);
+
+    for (const auto& channel : ctx.pwm_channels) {
+      Check(gpio.CreatePwm(channel, 1000, 50));
+    }
+    start = NowNs();
+    gpio.DestroyPwm();
+    pwms.push_back(NowNs() - start);
+  }
+
+  double lines = ctx.binary_channels.size();
+  ctx.reporter.Add("teardown/binary_all", all, {{"lines", lines}});
+  ctx.reporter.Add("teardown/binary_each", each, {{"lines", lines}});
+  double channels = ctx.pwm_channels.size();
+  ctx.reporter.Add("teardown/pwm_all", pwms, {{"channels", channels}});
+}
+
+void BenchWrite(Context& ctx) {
+  jetson::Gpio gpio(ctx.board.GetRoot());
+  SetUp(gpio);
+  auto output =
+      Check(gpio.CreateBinary(ctx.output_channel, jetson::Direction::OUT));
+
+  std::vector<double> samples;
+  samples.reserve(ctx.iterations);
+  for (int i = 0; i < ctx.iterations; i++) {
+    auto signal = (i & 1) ? jetson::Signal::HIGH : jetson::Signal::LOW;
+    auto start = NowNs();
+    output->Write2(signal);
+    samples.push_back(NowNs() - start);
+  }
+  ctx.reporter.Add("binary_write2", samples);
+
+  // A control loop re-asserting the level it already drives.
+  output->SetOutputPolicy(jetson::OutputPolicy::ELIDE_UNCHANGED);
+  samples.clear();
+  for (int i = 0; i < ctx.iterations; i++) {
+    auto start = NowNs();
+    output->Write2(jetson::Signal::HIGH);
+    samples.push_back(NowNs() - start);
+  }
+  ctx.reporter.Add("binary_write2_elided", samples);
+
+  samples.clear();
+  for (int i = 0; i < ctx.iterations; i++) {
+    auto start = NowNs();
+    output->Read2();
+    samples.push_back(NowNs() - start);
+  }
+  ctx.reporter.Add("binary_read2_output_shadow", samples);
+}
+
+/**
+ * Write2 with its tracepoints idle, and with the semaphore of write_return
+ * raised as an attached tracer does, which adds the duration measurement.
+ */
+void BenchTraceProbes(Context& ctx) {
+  jetson::Gpio gpio(ctx.board.GetRoot());
+  SetUp(gpio);
+  auto output =
+      Check(gpio.CreateBinary(ctx.output_channel, jetson::Direction::OUT));
+
+  auto run = [&](const char* name) {
+    std::vector<double> samples;
+    samples.reserve(ctx.iterations);
+    for (int i = 0; i < ctx.iterations; i++) {
+      auto signal = (i & 1) ? jetson::Signal::HIGH : jetson::Signal::LOW;
+      auto start = NowNs();
+      output->Write2(signal);
+      samples.push_back(NowNs() - start);
+    }
+    ctx.reporter.Add(name, samples);
+  };
+
+  run("trace/write2_idle");
+#ifdef JETSON_TRACE_ENABLED
+  jetson_gpio_write_return_semaphore++;
+  run("trace/write2_timed");
+  jetson_gpio_write_return_semaphore--;
+#endif
+}
+
+template <jetson::BoardType B>
+void BenchStaticWriteOn(Context& ctx) {
+  jetson::Gpio gpio(ctx.board.GetRoot());
+  SetUp(gpio);
+  jetson::StaticOutput<B, jetson::BoardMode::BOARD, 7> output(gpio);
+
+  std::vector<double> samples;
+  samples.reserve(ctx.iterations);
+  for (int i = 0; i < ctx.iterations; i++) {
+    auto start = NowNs();
+    output.Write(i & 1);
+    samples.push_back(NowNs() - start);
+  }
+  ctx.reporter.Add("static_output_write", samples);
+
+  // published like the writes of the controller
+  auto name = "/jetson_gpio_static_bench" + std::to_string(getpid());
+  Check(gpio.PublishState(name));
+  jetson::PinStateReader reader(name);
+  std::vector<jetson::PinState> states;
+  for (bool high : {true, false}) {
+    output.Write(high);
+    reader.Snapshot(&states);
+    auto shadow = output.Controller()->Read2();
+    if (states.size() != 1 || states[0].level != (high ? 1 : 0) ||
+        shadow != (high ? jetson::Signal::HIGH : jetson::Signal::LOW)) {
+      std::cerr << "[ERROR]: static output write not published" << std::endl;
+      ctx.failures++;
+    }
+  }
+}
+
+void BenchStaticWrite(Context& ctx) {
+  if (ctx.board.GetBoardType() == jetson::BoardType::JETSON_NANO) {
+    BenchStaticWriteOn<jetson::BoardType::JETSON_NANO>(ctx);
+  } else {
+    BenchStaticWriteOn<jetson::BoardType::JETSON_XAVIER>(ctx);
+  }
+}
+
+void BenchRead(Context& ctx) {
+  jetson::Gpio gpio(ctx.board.GetRoot());
+  SetUp(gpio);
+  auto input =
+      Check(gpio.CreateBinary(ctx.input_channel, jetson::Direction::IN));
+
+  std::vector<double> samples;
+  samples.reserve(ctx.iterations);
+  for (int i = 0; i < ctx.iterations; i++) {
+    auto start = NowNs();
+    input->Read2();
+    samples.push_back(NowNs() - start);
+  }
+  ctx.reporter.Add("binary_read2", samples);
+}
+
+void BenchPwm(Context& ctx) {
+  jetson::Gpio gpio(ctx.board.GetRoot());
+  SetUp(gpio);
+  auto pwm = Check(gpio.CreatePwm(ctx.pwm_channel, 50, 50));
+
+  std::vector<double> duty_samples;
+  duty_samples.reserve(ctx.iterations);
+  for (int i = 0; i < ctx.iterations; i++) {
+    auto start = NowNs();
+    pwm->ResetDutyCycle(i % 100);
+    duty_samples.push_back(NowNs() - start);
+  }
+  ctx.reporter.Add("pwm_reset_duty_cycle", duty_samples);
+
+  std::vector<double> frequency_samples;
+  frequency_samples.reserve(ctx.iterations);
+  for (int i = 0; i < ctx.iterations; i++) {
+    auto start = NowNs();
+    pwm->ResetFrequency(50 + i % 1000);
+    frequency_samples.push_back(NowNs() - start);
+  }
+  ctx.reporter.Add("pwm_reset_frequency", frequency_samples);
+}
+
+/**
+ * Skew between the first and the last sysfs write when all pwm channels of
+ * the board change frequency and duty cycle: one controller after the other
+ * versus a PwmGroup.
+ */
+void BenchPwmGroup(Context& ctx) {
+  jetson::Gpio gpio(ctx.board.GetRoot());
+  SetUp(gpio);
+
+  std::vector<jetson::PWMController*> pwms;
+  for (const auto& channel : ctx.pwm_channels) {
+    pwms.push_back(Check(gpio.CreatePwm(channel, 1000, 50)));
+  }
+  auto group = Check(gpio.CreatePwmGroup(ctx.pwm_channels));
+
+  std::vector<jetson::PwmTarget> targets;
+  for (const auto& channel : ctx.pwm_channels) {
+    targets.push_back(jetson::PwmTarget{channel});
+  }
+  auto set_targets = [&](int i) {
+    for (auto& target : targets) {
+      target.frequency = i % 2 ? 1500 : 1000;
+      target.duty_cycle = i % 2 ? 75 : 25;
+    }
+  };
+
+  std::vector<double> sequential;
+  sequential.reserve(ctx.iterations);
+  for (int i = 0; i < ctx.iterations; i++) {
+    set_targets(i);
+    auto start = NowNs();
+    for (std::size_t p = 0; p < pwms.size(); p++) {
+      pwms[p]->ResetFrequency(targets[p].frequency);
+      pwms[p]->ResetDutyCycle(targets[p].duty_cycle);
+      pwms[p]->Start();
+    }
+    sequential.push_back(NowNs() - start);
+  }
+  // period and duty cycle twice (ResetFrequency rewrites it), enable
+  ctx.reporter.Add("pwm_group/sequential", sequential,
+                   {{"channels", static_cast<double>(pwms.size())},
+                    {"writes", 4.0 * pwms.size()}});
+
+  std::vector<double> skew;
+  skew.reserve(ctx.iterations);
+  for (int i = 0; i < ctx.iterations; i++) {
+    set_targets(i);
+    Check(group->Apply(targets));
+    skew.push_back(group->GetStats().skew_ns);
+  }
+
+  // what the channels read back must match the last targets
+  for (const auto& target : targets) {
+    auto info = gpio.GetChannelInfo(jetson::BoardMode::BOARD, target.channel);
+    auto dir = *info.pwm_chip_dir + "/pwm" + std::to_string(*info.chip_pwm_id);
+    int64_t period = 0, duty_cycle = 0, enable = 0;
+    std::ifstream(dir + "/period") >> period;
+    std::ifstream(dir + "/duty_cycle") >> duty_cycle;
+    std::ifstream(dir + "/enable") >> enable;
+    if (period != static_cast<int64_t>(1e9 / target.frequency) ||
+        duty_cycle != static_cast<int64_t>(1e7 / target.frequency *
+                                           target.duty_cycle) ||
+        enable != 1) {
+      throw std::runtime_error("pwm group left " + target.channel +
+                               " in a wrong state.");
+    }
+  }
+
+  auto stats = group->GetStats();
+  ctx.reporter.Add("pwm_group/apply", skew,
+                   {{"channels", static_cast<double>(pwms.size())},
+                    {"writes", static_cast<double>(stats.writes)}});
+}
+
+/**
+ * A control cycle over up to 16 outputs: every output written, then every
+ * line read back from its value file, one line after the other and through
+ * a value batch on each backend. System calls per cycle are reported; what
+ * the value files hold must match the last levels written.
+ */
+void BenchValueBatch(Context& ctx) {
+  jetson::Gpio gpio(ctx.board.GetRoot());
+  SetUp(gpio);
+
+  std::vector<std::string> channels;
+  std::vector<jetson::BinaryController*> lines;
+  for (const auto& channel : ctx.binary_channels) {
+    if (channels.size() == 16) break;
+    if (channel == ctx.input_channel) continue;
+    lines.push_back(Check(gpio.CreateBinary(channel, jetson::Direction::OUT)));
+    lines.back()->SetOutputReadback(jetson::OutputReadback::VERIFY);
+    channels.push_back(channel);
+  }
+  auto extras = [&](double syscalls) {
+    return Reporter::Extras{{"lines", static_cast<double>(lines.size())},
+                            {"syscalls", syscalls}};
+  };
+
+  std::vector<double> samples;
+  samples.reserve(ctx.iterations);
+  for (int i = 0; i < ctx.iterations; i++) {
+    auto level = (i & 1) ? jetson::Signal::HIGH : jetson::Signal::LOW;
+    auto start = NowNs();
+    for (auto line : lines) line->Write2(level);
+    for (auto line : lines) line->Read2();
+    samples.push_back(NowNs() - start);
+  }
+  ctx.reporter.Add("value_batch/per_line", samples,
+                   extras(2.0 * lines.size()));
+
+  for (auto backend : {jetson::IoBackend::SYSCALLS, jetson::IoBackend::AUTO}) {
+    auto batch = Check(gpio.CreateValueBatch(channels, backend));
+    bool io_uring = batch->GetStats().io_uring;
+    std::vector<jetson::Signal> levels(lines.size());
+    std::vector<jetson::Signal> read;
+    read.reserve(lines.size());
+
+    samples.clear();
+    for (int i = 0; i < ctx.iterations; i++) {
+      for (std::size_t l = 0; l < levels.size(); l++) {
+        levels[l] = ((i + l) & 1) ? jetson::Signal::HIGH : jetson::Signal::LOW;
+      }
+      auto start = NowNs();
+      Check(batch->Write(levels));
+      Check(batch->Read(&read));
+      samples.push_back(NowNs() - start);
+
+      if (read != levels) {
+        std::cerr << "[ERROR]: value batch read back other levels"
+                  << std::endl;
+        ctx.failures++;
+        break;
+      }
+    }
+    auto stats = batch->GetStats();
+    ctx.reporter.Add(io_uring ? "value_batch/io_uring" : "value_batch/syscalls",
+                     samples,
+                     extras(static_cast<double>(stats.syscalls) /
+                            std::max<uint64_t>(1, ctx.iterations)));
+
+    // files of the simulation never signal an edge, the wait times out
+    std::vector<std::size_t> edged;
+    auto input =
+        Check(gpio.CreateBinary(ctx.input_channel, jetson::Direction::IN));
+    auto waiting = Check(gpio.CreateValueBatch({ctx.input_channel}, backend));
+    for (int i = 0; i < 2; i++) {
+      Check(waiting->WaitEdges(std::chrono::milliseconds(1), &edged));
+    }
+    if (!edged.empty()) {
+      std::cerr << "[ERROR]: value batch saw an edge that never was"
+                << std::endl;
+      ctx.failures++;
+    }
+    (void)input;
+    gpio.DestroyValueBatch(waiting);
+    gpio.DestroyValueBatch(batch);
+  }
+}
+
+/**
+ * A 1 kHz scan cycle over eight inputs and eight outputs, one output
+ * toggled per cycle. Samples are the deviation of the step starts from the
+ * period; the outputs must end up at the levels of the last output image.
+ */
+void BenchScanCycle(Context& ctx) {
+  const int64_t kPeriod_Ns = 1000000;
+  const int kCycles = std::min(ctx.iterations, 1000);
+
+  jetson::Gpio gpio(ctx.board.GetRoot());
+  SetUp(gpio);
+
+  std::vector<std::string> inputs;
+  std::vector<std::string> outputs;
+  std::vector<jetson::BinaryController*> output_lines;
+  for (const auto& channel : ctx.binary_channels) {
+    if (inputs.size() < 8) {
+      Check(gpio.CreateBinary(channel, jetson::Direction::IN));
+      inputs.push_back(channel);
+    } else if (outputs.size() < 8) {
+      output_lines.push_back(
+          Check(gpio.CreateBinary(channel, jetson::Direction::OUT)));
+      outputs.push_back(channel);
+    }
+  }
+
+  for (auto backend : {jetson::IoBackend::SYSCALLS, jetson::IoBackend::AUTO}) {
+    std::vector<int64_t> starts;
+    starts.reserve(kCycles);
+    std::vector<jetson::Signal> last(outputs.size());
+    std::atomic<int> cycles{0};
+
+    jetson::ScanCycleOptions options;
+    options.period = std::chrono::nanoseconds(kPeriod_Ns);
+    options.backend = backend;
+    auto cycle = Check(gpio.CreateScanCycle(
+        inputs, outputs,
+        [&](const std::vector<jetson::Signal>& in,
+            std::vector<jetson::Signal>* out) {
+          auto i = cycles.load();
+          if (i >= kCycles) return;
+          starts.push_back(NowNs());
+          auto& level = (*out)[i % out->size()];
+          level = level == jetson::Signal::HIGH ? jetson::Signal::LOW
+                                                : jetson::Signal::HIGH;
+          last = *out;
+          cycles.store(i + 1);
+          (void)in;
+        },
+        options));
+
+    cycle->Start();
+    while (cycles.load() < kCycles) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    cycle->Stop();
+    auto stats = cycle->GetStats();
+    gpio.DestroyScanCycle(cycle);
+
+    std::vector<double> samples;
+    for (std::size_t i = 1; i < starts.size(); i++) {
+      samples.push_back(std::abs(starts[i] - starts[i - 1] - kPeriod_Ns));
+    }
+
+    bool driven = true;
+    for (std::size_t i = 0; i < output_lines.size(); i++) {
+      driven &= output_lines[i]->Read2() == last[i];
+    }
+    if (!driven || stats.errors > 0 ||
+        stats.writes != static_cast<uint64_t>(kCycles)) {
+      std::cerr << "[ERROR]: scan cycle wrote " << stats.writes << " of "
+                << kCycles << " levels, " << stats.errors << " errors"
+                << std::endl;
+      ctx.failures++;
+    }
+    ctx.reporter.Add(
+        backend == jetson::IoBackend::AUTO ? "scan_cycle/auto"
+                                           : "scan_cycle/syscalls",
+        samples,
+        {{"mean_exec_ns", static_cast<double>(stats.mean_exec_ns)},
+         {"max_jitter_ns", static_cast<double>(stats.max_jitter_ns)},
+         {"overruns", static_cast<double>(stats.overruns)},
+         {"syscalls", static_cast<double>(stats.syscalls) /
+                          std::max<uint64_t>(1, stats.cycles)}});
+  }
+}
+
+/**
+ * Lateness of scheduled writes, due 200 us after being scheduled: one output,
+ * and eight outputs due at the same deadline, where the last write of the
+ * burst is the one measured. Cancelled writes must never be issued.
+ */
+void BenchScheduledWrite(Context& ctx) {
+  jetson::Gpio gpio(ctx.board.GetRoot());
+  SetUp(gpio);
+
+  std::vector<std::string> outputs;
+  for (const auto& channel : ctx.binary_channels) {
+    if (outputs.size() == 8) break;
+    Check(gpio.CreateBinary(channel, jetson::Direction::OUT));
+    outputs.push_back(channel);
+  }
+
+  auto wait_executed = [&](uint64_t executed) {
+    auto deadline = NowNs() + 100000000;  // 100 ms
+    while (gpio.GetWriteScheduleStats().executed < executed) {
+      if (NowNs() > deadline) throw std::runtime_error("write not issued.");
+      std::this_thread::yield();
+    }
+  };
+
+  for (std::size_t lines : {std::size_t(1), outputs.size()}) {
+    std::vector<std::string> channels(outputs.begin(), outputs.begin() + lines);
+    auto before = gpio.GetWriteScheduleStats();
+
+    std::vector<double> samples;
+    samples.reserve(ctx.iterations / 10);
+    for (int i = 0; i < ctx.iterations / 10; i++) {
+      auto level = i % 2 ? jetson::Signal::HIGH : jetson::Signal::LOW;
+      auto executed = gpio.GetWriteScheduleStats().executed + lines;
+      Check(gpio.ScheduleWrite(channels, level, NowNs() + 200000));
+      wait_executed(executed);
+      samples.push_back(gpio.GetWriteScheduleStats().last_late_ns);
+    }
+
+    auto after = gpio.GetWriteScheduleStats();
+    double bursts = after.bursts - before.bursts;
+    ctx.reporter.Add("scheduled_write/" + std::to_string(lines), samples,
+                     {{"lines", static_cast<double>(lines)},
+                      {"bursts_per_deadline", bursts / samples.size()}});
+  }
+
+  // cancelled in time, the write never happens
+  auto before = gpio.GetWriteScheduleStats();
+  auto id = Check(gpio.ScheduleWrite(outputs, jetson::Signal::HIGH,
+                                     NowNs() + 20000000));  // 20 ms
+  if (!gpio.CancelWrite(id) || gpio.CancelWrite(id)) {
+    throw std::runtime_error("cancelling a scheduled write failed.");
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  auto after = gpio.GetWriteScheduleStats();
+  if (after.executed != before.executed ||
+      after.cancelled != before.cancelled + outputs.size()) {
+    throw std::runtime_error("cancelled scheduled write was issued.");
+  }
+}
+
+/**
+ * A broker serving this process over a segment of its own: remote writes and
+ * reads, edge to callback through the broker, and ownership of an output
+ * checked from a second client and from a child process.
+ */
+void BenchBroker(Context& ctx) {
+  jetson::Gpio gpio(ctx.board.GetRoot());
+  SetUp(gpio);
+  auto name = "/jetson_gpio_bench_" + std::to_string(getpid());
+  jetson::GpioBroker broker(gpio, name);
+  jetson::BrokerClient client(name);
+
+  auto output =
+      Check(client.Open(ctx.output_channel, jetson::Direction::OUT));
+  auto input = Check(client.Open(ctx.input_channel, jetson::Direction::IN));
+
+  std::vector<double> writes;
+  writes.reserve(ctx.iterations);
+  for (int i = 0; i < ctx.iterations; i++) {
+    auto start = NowNs();
+    output->Write2(i % 2 ? jetson::Signal::HIGH : jetson::Signal::LOW);
+    writes.push_back(NowNs() - start);
+  }
+  ctx.reporter.Add("broker/write2", writes);
+
+  // a read is only answered once the writes before it are done
+  std::vector<double> round_trips;
+  round_trips.reserve(ctx.iterations);
+  for (int i = 0; i < ctx.iterations; i++) {
+    auto level = i % 2 ? jetson::Signal::HIGH : jetson::Signal::LOW;
+    auto start = NowNs();
+    output->Write2(level);
+    if (output->Read2() != level) {
+      throw std::runtime_error("broker read back a wrong level.");
+    }
+    round_trips.push_back(NowNs() - start);
+  }
+  ctx.reporter.Add("broker/write2_read2", round_trips);
+
+  std::atomic<int64_t> edge_time{0};
+  std::atomic<int> callbacks{0};
+  std::vector<double> latencies;
+  latencies.reserve(ctx.iterations / 10);
+  Check(input->RegisterCallback(
+      jetson::TriggerEdge::BOTH, [&edge_time, &callbacks, &latencies](int) {
+        auto then = edge_time.exchange(0);
+        if (then != 0) latencies.push_back(NowNs() - then);
+        callbacks.fetch_add(1);
+      }));
+
+  auto value_file = ctx.board.GetValueFile(
+      gpio.GetChannelInfo(jetson::BoardMode::BOARD, ctx.input_channel));
+  int fd = open(value_file.c_str(), O_WRONLY);
+  if (fd < 0) throw std::runtime_error("open " + value_file + " failed.");
+  int missed = 0;
+  for (int i = 0; i < ctx.iterations / 10; i++) {
+    int expected = callbacks.load() + 1;
+    edge_time.store(NowNs());
+    (void)pwrite(fd, i % 2 ? "0" : "1", 1, 0);
+    auto deadline = NowNs() + 100000000;  // 100 ms
+    while (callbacks.load() < expected && NowNs() < deadline) {
+      std::this_thread::yield();
+    }
+    if (callbacks.load() < expected) {
+      edge_time.store(0);
+      missed++;
+    }
+  }
+  close(fd);
+  client.Close(ctx.input_channel);
+  ctx.reporter.Add("broker/edge_to_callback", latencies,
+                   {{"missed", missed}});
+
+  // an output belongs to one client at a time
+  jetson::BrokerClient other(name);
+  if (other.Open(ctx.output_channel, jetson::Direction::OUT).second) {
+    throw std::runtime_error("broker handed out an owned output.");
+  }
+
+  // concurrent opens of a channel share its line
+  jetson::RemoteLine* opened[2] = {nullptr, nullptr};
+  std::thread opener([&] {
+    opened[0] = other.Open(ctx.input_channel, jetson::Direction::IN).second;
+  });
+  opened[1] = other.Open(ctx.input_channel, jetson::Direction::IN).second;
+  opener.join();
+  if (opened[0] == nullptr || opened[0] != opened[1]) {
+    throw std::runtime_error("broker opened a channel twice for a client.");
+  }
+  other.Close(ctx.input_channel);
+
+  auto child = fork();
+  if (child == 0) {
+    try {
+      jetson::BrokerClient remote(name);
+      _exit(remote.Open(ctx.output_channel, jetson::Direction::OUT).second
+                ? 1
+                : 0);
+    } catch (...) {
+      _exit(2);
+    }
+  }
+  int status = -1;
+  waitpid(child, &status, 0);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    throw std::runtime_error("broker ownership across processes failed.");
+  }
+
+  client.Close(ctx.output_channel);
+  Check(other.Open(ctx.output_channel, jetson::Direction::OUT));
+
+  // A client dying while it sets its slot up leaves it claimed; the broker
+  // reaps it like the slot of a connected client.
+  int segment_fd = shm_open(name.c_str(), O_RDWR, 0);
+  void* memory = mmap(nullptr, sizeof(jetson::broker::Segment),
+                      PROT_READ | PROT_WRITE, MAP_SHARED, segment_fd, 0);
+  close(segment_fd);
+  if (memory == MAP_FAILED) throw std::runtime_error("map broker failed.");
+  auto segment = static_cast<jetson::broker::Segment*>(memory);
+
+  child = fork();
+  if (child == 0) {
+    for (auto& slot : segment->slots) {
+      int32_t none = 0;
+      if (slot.pid.compare_exchange_strong(none, getpid())) {
+        slot.state.store(jetson::broker::CLAIMED);
+        _exit(0);
+      }
+    }
+    _exit(1);
+  }
+  waitpid(child, &status, 0);
+
+  auto claimed = [&] {
+    for (const auto& slot : segment->slots) {
+      if (slot.pid.load() == child) return true;
+    }
+    return false;
+  };
+  auto deadline = NowNs() + 1000000000;  // 1 s, the broker reaps when idle
+  while (claimed() && NowNs() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  bool leaked = claimed();
+  munmap(memory, sizeof(jetson::broker::Segment));
+  if (leaked) throw std::runtime_error("slot of a dead client not reaped.");
+}
+
+/**
+ * Runs `body(thread_index, samples)` on `threads` threads at once and reports
+ * the merged per operation samples along with the aggregate throughput.
+ */
+void RunThreads(Context& ctx, const std::string& name, int threads,
+                const std::function<void(int, std::vector<double>&)>& body) {
+  std::vector<std::vector<double>> samples(threads);
+  std::vector<std::thread> workers;
+  std::atomic<int> ready{0};
+
+  auto start = NowNs();
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&, t] {
+      ready.fetch_add(1);
+      while (ready.load() < threads) std::this_thread::yield();
+      body(t, samples[t]);
+    });
+  }
+  for (auto& w : workers) w.join();
+  double elapsed = NowNs() - start;
+
+  std::vector<double> merged;
+  for (auto& s : samples) merged.insert(merged.end(), s.begin(), s.end());
+  double operations = merged.size();
+  ctx.reporter.Add(name + "/" + std::to_string(threads), std::move(merged),
+                   {{"threads", threads},
+                    {"aggregate_ops_per_sec", 1e9 * operations / elapsed}});
+}
+
+/**
+ * Multi-threaded stress: writes on distinct lines should scale with the
+ * number of threads, writes on one shared line are serialized per line.
+ */
+void BenchThreaded(Context& ctx) {
+  jetson::Gpio gpio(ctx.board.GetRoot());
+  SetUp(gpio);
+
+  const int kMaxThreads = std::min<int>(8, ctx.binary_channels.size());
+  std::vector<jetson::BinaryController*> outputs;
+  for (int t = 0; t < kMaxThreads; t++) {
+    outputs.push_back(Check(
+        gpio.CreateBinary(ctx.binary_channels[t], jetson::Direction::OUT)));
+  }
+
+  for (int threads = 1; threads <= kMaxThreads; threads *= 2) {
+    RunThreads(ctx, "mt_write_own_line", threads,
+               [&](int t, std::vector<double>& samples) {
+                 samples.reserve(ctx.iterations);
+                 for (int i = 0; i < ctx.iterations; i++) {
+                   auto start = NowNs();
+                   outputs[t]->Write(i & 1);
+                   samples.push_back(NowNs() - start);
+                 }
+               });
+  }
+
+  for (int threads = 1; threads <= kMaxThreads; threads *= 2) {
+    RunThreads(ctx, "mt_write_shared_line", threads,
+               [&](int, std::vector<double>& samples) {
+                 samples.reserve(ctx.iterations);
+                 for (int i = 0; i < ctx.iterations; i++) {
+                   auto start = NowNs();
+                   outputs[0]->Write(i & 1);
+                   samples.push_back(NowNs() - start);
+                 }
+               });
+  }
+
+  gpio.DestroyBinary();
+  for (int threads = 1; threads <= kMaxThreads; threads *= 2) {
+    RunThreads(ctx, "mt_create_destroy", threads,
+               [&](int t, std::vector<double>& samples) {
+                 const auto& channel = ctx.binary_channels[t];
+                 for (int i = 0; i < ctx.iterations / 100; i++) {
+                   auto start = NowNs();
+                   Check(gpio.CreateBinary(channel, jetson::Direction::OUT));
+                   gpio.DestroyBinary(channel);
+                   samples.push_back(NowNs() - start);
+                 }
+               });
+  }
+}
+
+/**
+ * Drives the value file of an input the way the kernel would and measures the
+ * time until a probe callback runs. One edge is in flight at a time.
+ */
+class EdgeProbe {
+ public:
+  EdgeProbe(Context& ctx, jetson::Gpio& gpio, const std::string& channel,
+            jetson::CallbackOptions options = {})
+      : state_(std::make_shared<State>()) {
+    auto input = Check(gpio.CreateBinary(channel, jetson::Direction::IN));
+    auto state = state_;
+    input->RegisterCallback(
+        jetson::TriggerEdge::BOTH,
+        [state](int) {
+          auto now = NowNs();
+          auto then = state->edge_time.exchange(0);
+          if (then != 0) state->samples.push_back(now - then);
+          state->callbacks.fetch_add(1);
+        },
+        std::move(options));
+
+    auto value_file = ctx.board.GetValueFile(
+        gpio.GetChannelInfo(jetson::BoardMode::BOARD, channel));
+    fd_ = open(value_file.c_str(), O_WRONLY);
+    if (fd_ < 0) throw std::runtime_error("open " + value_file + " failed.");
+    state_->samples.reserve(ctx.iterations);
+  }
+
+  ~EdgeProbe() { close(fd_); }
+
+  /**
+   * Drive `edges` edges and return the edge to callback latencies. Edges
+   * whose callback did not run within 100 ms are counted in `missed`.
+   */
+  std::vector<double> Run(int edges, int* missed) {
+    for (int i = 0; i < edges; i++) {
+      int expected = state_->callbacks.load() + 1;
+      state_->edge_time.store(NowNs());
+      level_ = !level_;
+      if (pwrite(fd_, level_ ? "1" : "0", 1, 0) != 1 || !Wait(expected)) {
+        state_->edge_time.store(0);
+        (*missed)++;
+      }
+    }
+    return state_->samples;
+  }
+
+ private:
+  bool Wait(int expected) {
+    auto deadline = NowNs() + 100000000;  // 100 ms
+    while (state_->callbacks.load() < expected) {
+      if (NowNs() > deadline) return false;
+      std::this_thread::yield();
+    }
+    return true;
+  }
+
+ private:
+  struct State {
+    std::atomic<int64_t> edge_time{0};
+    std::atomic<int> callbacks{0};
+    std::vector<double> samples;
+  };
+
+  std::shared_ptr<State> state_;
+  int fd_ = -1;
+  bool level_ = false;
+};
+
+/**
+ * Pin state published to shared memory: the cost it adds to a write, the
+ * cost of a reader snapshot, and a reader racing a writer that flips a pwm
+ * group between two settings, which must only ever see one of the two.
+ * Edges of a published input must all be counted.
+ */
+void BenchStatePublish(Context& ctx) {
+  auto name = "/jetson_gpio_state_bench" + std::to_string(getpid());
+
+  jetson::Gpio gpio(ctx.board.GetRoot());
+  SetUp(gpio);
+  auto output =
+      Check(gpio.CreateBinary(ctx.output_channel, jetson::Direction::OUT));
+  Check(gpio.PublishState(name));
+  for (const auto& channel : ctx.pwm_channels) {
+    Check(gpio.CreatePwm(channel, 1000, 25));
+  }
+  auto group = Check(gpio.CreatePwmGroup(ctx.pwm_channels));
+
+  std::vector<double> samples;
+  samples.reserve(ctx.iterations);
+  for (int i = 0; i < ctx.iterations; i++) {
+    auto signal = (i & 1) ? jetson::Signal::HIGH : jetson::Signal::LOW;
+    auto start = NowNs();
+    output->Write2(signal);
+    samples.push_back(NowNs() - start);
+  }
+  ctx.reporter.Add("state_publish/binary_write2", samples);
+
+  jetson::PinStateReader reader(name);
+  std::vector<jetson::PinState> states;
+  states.reserve(jetson::kMax_Published_Lines);
+  samples.clear();
+  for (int i = 0; i < ctx.iterations; i++) {
+    auto start = NowNs();
+    reader.Snapshot(&states);
+    samples.push_back(NowNs() - start);
+  }
+  ctx.reporter.Add("state_publish/snapshot", samples,
+                   {{"lines", static_cast<double>(states.size())}});
+
+  std::vector<jetson::PwmTarget> targets;
+  for (const auto& channel : ctx.pwm_channels) {
+    targets.push_back(jetson::PwmTarget{channel});
+  }
+  std::atomic<bool> stop{false};
+  std::thread writer([&] {
+    for (int i = 0; !stop.load(); i++) {
+      for (auto& target : targets) {
+        target.frequency = i % 2 ? 2000 : 1000;
+        target.duty_cycle = i % 2 ? 75 : 25;
+      }
+      (void)group->Apply(targets);
+    }
+  });
+
+  int torn = 0;
+  samples.clear();
+  for (int i = 0; i < ctx.iterations; i++) {
+    auto start = NowNs();
+    reader.Snapshot(&states);
+    samples.push_back(NowNs() - start);
+    for (const auto& state : states) {
+      if (state.kind != jetson::PIN_PWM) continue;
+      if (!(state.frequency == 1000 && state.duty_cycle == 25) &&
+          !(state.frequency == 2000 && state.duty_cycle == 75)) {
+        torn++;
+      }
+    }
+  }
+  stop = true;
+  writer.join();
+
+  int missed = 0;
+  int edges = std::max(2, ctx.iterations / 100);
+  {
+    EdgeProbe probe(ctx, gpio, ctx.input_channel);
+    (void)probe.Run(edges, &missed);
+  }
+  uint64_t counted = 0;
+  for (const auto& state : reader.Snapshot()) {
+    if (state.channel == ctx.input_channel) {
+      counted = state.rising_edges + state.falling_edges;
+    }
+  }
+
+  if (torn > 0 || counted != static_cast<uint64_t>(edges - missed)) {
+    std::cerr << "[ERROR]: state_publish read " << torn << " torn states, "
+              << counted << " of " << edges - missed << " edges" << std::endl;
+    ctx.failures++;
+  }
+  ctx.reporter.Add("state_publish/snapshot_racing", samples,
+                   {{"torn", torn},
+                    {"edges", static_cast<double>(counted)}});
+}
+
+/**
+ * The cost of one flight recorder entry, also when switching between two
+ * recorders, and of Write2 while recording. A
+ * dump written on request and one written by the signal handler must decode
+ * to the same timeline, ending with the operations last made.
+ */
+void BenchFlightRecorder(Context& ctx) {
+  const int kBatch = 1000;  // entries per sample, each is too short to time
+  auto path = "/tmp/jetson_gpio_flight_bench" + std::to_string(getpid());
+  auto signal_path = path + ".signal";
+
+  {
+    jetson::FlightRecorder recorder(4096);
+    std::vector<double> samples;
+    samples.reserve(ctx.iterations);
+    for (int i = 0; i < ctx.iterations; i++) {
+      auto start = NowNs();
+      for (int j = 0; j < kBatch; j++) {
+        recorder.Record(jetson::FlightOp::WRITE, 1, j & 1);
+      }
+      samples.push_back(static_cast<double>(NowNs() - start) / kBatch);
+    }
+    ctx.reporter.Add("flight_recorder/record", samples);
+
+    // Switching keeps the ring of each recorder instead of taking new ones.
+    jetson::FlightRecorder other(4096);
+    samples.clear();
+    for (int i = 0; i < ctx.iterations; i++) {
+      auto start = NowNs();
+      for (int j = 0; j < kBatch; j++) {
+        auto& target = j & 1 ? other : recorder;
+        target.Record(jetson::FlightOp::WRITE, 1, j & 1);
+      }
+      samples.push_back(static_cast<double>(NowNs() - start) / kBatch);
+    }
+    if (recorder.GetThreads() != 1 || other.GetThreads() != 1) {
+      std::cerr << "[ERROR]: flight_recorder took " << recorder.GetThreads()
+                << " and " << other.GetThreads()
+                << " rings for one thread" << std::endl;
+      ctx.failures++;
+    }
+    ctx.reporter.Add("flight_recorder/record_alternating", samples);
+  }
+
+  jetson::Gpio gpio(ctx.board.GetRoot());
+  SetUp(gpio);
+  Check(gpio.StartFlightRecorder(4096));
+  auto output =
+      Check(gpio.CreateBinary(ctx.output_channel, jetson::Direction::OUT));
+  auto pwm = Check(gpio.CreatePwm(ctx.pwm_channel, 1000, 25));
+
+  std::vector<double> samples;
+  samples.reserve(ctx.iterations);
+  for (int i = 0; i < ctx.iterations; i++) {
+    auto signal = (i & 1) ? jetson::Signal::HIGH : jetson::Signal::LOW;
+    auto start = NowNs();
+    output->Write2(signal);
+    samples.push_back(NowNs() - start);
+  }
+  pwm->Start();
+  (void)output->Read2();
+
+  Check(gpio.DumpFlightRecorder(path));
+  Check(gpio.DumpFlightRecorderOnSignal(signal_path, SIGUSR2, false));
+  raise(SIGUSR2);
+
+  jetson::FlightDump dump;
+  jetson::FlightDump signal_dump;
+  Check(jetson::LoadFlightDump(path, &dump));
+  Check(jetson::LoadFlightDump(signal_path, &signal_dump));
+  std::remove(path.c_str());
+  std::remove(signal_path.c_str());
+
+  int writes = 0;
+  for (const auto& event : dump.events) {
+    writes += event.op == jetson::FlightOp::WRITE;
+  }
+  auto size = dump.events.size();
+  if (size < 2 || signal_dump.events.size() != size ||
+      dump.events[size - 2].op != jetson::FlightOp::PWM_START ||
+      dump.events[size - 1].op != jetson::FlightOp::READ ||
+      writes < std::min(ctx.iterations, 2048)) {
+    std::cerr << "[ERROR]: flight_recorder decoded " << size << " and "
+              << signal_dump.events.size() << " operations, " << writes
+              << " writes" << std::endl;
+    ctx.failures++;
+  }
+  ctx.reporter.Add("flight_recorder/binary_write2", samples,
+                   {{"decoded", static_cast<double>(size)}});
+}
+
+/**
+ * Scrapes of the metrics exporter over its Unix socket, after writes and
+ * edges whose counts must show up. A scrape served into the buffer of an
+ * earlier one must not allocate.
+ */
+void BenchMetricsExport(Context& ctx) {
+  auto path = "/tmp/jetson_gpio_metrics_bench" + std::to_string(getpid());
+
+  jetson::Gpio gpio(ctx.board.GetRoot());
+  SetUp(gpio);
+  auto output =
+      Check(gpio.CreateBinary(ctx.output_channel, jetson::Direction::OUT));
+  Check(gpio.StartMetricsExporter(path));
+
+  int writes = 1 + ctx.iterations / 10;  // and the initial one
+  for (int i = 1; i < writes; i++) {
+    output->Write2((i & 1) ? jetson::Signal::HIGH : jetson::Signal::LOW);
+  }
+  int missed = 0;
+  int edges = std::max(2, ctx.iterations / 100);
+  EdgeProbe probe(ctx, gpio, ctx.input_channel);
+  (void)probe.Run(edges, &missed);
+
+  struct sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+  static char response[1 << 16];
+  auto scrape = [&]() -> std::size_t {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    const char request[] = "GET /metrics HTTP/1.0\r\n\r\n";
+    std::size_t length = 0;
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&address),
+                sizeof(address)) == 0 &&
+        write(fd, request, sizeof(request) - 1) > 0) {
+      ssize_t n = 0;
+      while ((n = read(fd, response + length,
+                       sizeof(response) - 1 - length)) > 0) {
+        length += n;
+      }
+    }
+    close(fd);
+    response[length] = '\0';
+    return length;
+  };
+
+  (void)scrape();  // the exporter has rendered once
+  std::vector<double> samples;
+  samples.reserve(ctx.iterations / 10);
+  auto before = g_allocations.load();
+  std::size_t length = 0;
+  for (int i = 0; i < ctx.iterations / 10; i++) {
+    auto start = NowNs();
+    length = scrape();
+    samples.push_back(NowNs() - start);
+  }
+  auto allocations = g_allocations.load() - before;
+
+  std::string body(response, length);
+  auto expect = [&](const std::string& sample) {
+    if (body.find(sample) == std::string::npos) {
+      std::cerr << "[ERROR]: metrics_export is missing " << sample
+                << std::endl;
+      ctx.failures++;
+    }
+  };
+  expect("jetson_gpio_writes_total{channel=\"" + ctx.output_channel +
+         "\",gpio=\"" +
+         std::to_string(gpio.GetChannelInfo(jetson::BoardMode::BOARD,
+                                            ctx.output_channel)
+                            .gpio) +
+         "\"} " + std::to_string(writes) + "\n");
+  expect("edge=\"rising\"} " + std::to_string((edges - missed + 1) / 2));
+  expect("jetson_gpio_callback_latency_seconds_count{channel=\"" +
+         ctx.input_channel);
+  if (allocations > 0) {
+    std::cerr << "[ERROR]: metrics_export allocated " << allocations
+              << " times" << std::endl;
+    ctx.failures++;
+  }
+
+  ctx.reporter.Add("metrics_export/scrape", samples,
+                   {{"bytes", static_cast<double>(length)},
+                    {"allocations", static_cast<double>(allocations)}});
+}
+
+/**
+ * Edges of an input recorded at 1 ms intervals, saved, loaded and replayed
+ * into an inline callback with the original timing, ten times faster and as
+ * fast as possible. Every replayed edge must reach the callback.
+ */
+void BenchEdgeReplay(Context& ctx) {
+  jetson::Gpio gpio(ctx.board.GetRoot());
+  SetUp(gpio);
+
+  int edges = std::max(2, ctx.iterations / 10);
+  jetson::EdgeRecorder recorder(gpio, {ctx.input_channel});
+  {
+    auto value_file = ctx.board.GetValueFile(
+        gpio.GetChannelInfo(jetson::BoardMode::BOARD, ctx.input_channel));
+    int fd = open(value_file.c_str(), O_WRONLY);
+    for (int i = 0; i < edges; i++) {
+      (void)pwrite(fd, (i & 1) ? "0" : "1", 1, 0);
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    close(fd);
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  recorder.Stop();
+
+  auto path = "/tmp/jetson_gpio_replay_bench" + std::to_string(getpid());
+  Check(jetson::SaveRecording(recorder.GetRecording(), path));
+  jetson::EdgeRecording recording;
+  Check(jetson::LoadRecording(path, &recording));
+  std::remove(path.c_str());
+  auto recorded = recording.edges.size();
+
+  std::atomic<uint64_t> callbacks{0};
+  auto input = Check(gpio.CreateBinary(ctx.input_channel,
+                                       jetson::Direction::IN));
+  input->RegisterCallback(jetson::TriggerEdge::BOTH,
+                          [&callbacks](int) { callbacks.fetch_add(1); });
+
+  jetson::EdgeReplayer replayer(gpio, std::move(recording));
+  struct Mode {
+    const char* name;
+    jetson::ReplayOptions options;
+    int replays;
+  };
+  const Mode kModes[] = {
+      {"edge_replay/original", {jetson::ReplayTiming::ORIGINAL, 1}, 1},
+      {"edge_replay/scaled_10x", {jetson::ReplayTiming::SCALED, 10}, 3},
+      {"edge_replay/fast", {jetson::ReplayTiming::FAST, 1},
+       std::max(1, ctx.iterations / 10)},
+  };
+
+  for (const auto& mode : kModes) {
+    std::vector<double> samples;
+    jetson::ReplayStats stats;
+    for (int r = 0; r < mode.replays; r++) {
+      auto before = callbacks.load();
+      stats = replayer.Replay(mode.options);
+      samples.push_back(stats.mean_dispatch_ns);
+      if (callbacks.load() - before != stats.edges || stats.edges != recorded) {
+        std::cerr << "[ERROR]: " << mode.name << " delivered "
+                  << callbacks.load() - before << " of " << recorded
+                  << " edges" << std::endl;
+        ctx.failures++;
+      }
+    }
+    ctx.reporter.Add(mode.name, samples,
+                     {{"edges", static_cast<double>(stats.edges)},
+                      {"edges_per_sec", stats.edges_per_sec},
+                      {"duration_ms", stats.duration_ns / 1e6},
+                      {"mean_late_ns", static_cast<double>(stats.mean_late_ns)},
+                      {"max_late_ns", static_cast<double>(stats.max_late_ns)}});
+  }
+}
+
+/**
+ * Loopback from an input edge to an output following it: by reflex rules,
+ * by a reflex delayed 100 us (samples without the delay), and by inline and
+ * pool callbacks writing the output. The edge is driven through the value
+ * file of the input, the output is polled through its value file.
+ */
+void BenchReflex(Context& ctx) {
+  const int kEdges = std::max(2, std::min(ctx.iterations / 10, 2000));
+  const int64_t kDelay_Ns = 100000;
+
+  enum Variant { RULE, DELAYED_RULE, INLINE_CALLBACK, POOL_CALLBACK };
+  const char* kNames[] = {"reflex/loopback", "reflex/loopback_delayed",
+                          "reflex/callback_inline", "reflex/callback_pool"};
+
+  for (auto variant : {RULE, DELAYED_RULE, INLINE_CALLBACK, POOL_CALLBACK}) {
+    jetson::Gpio gpio(ctx.board.GetRoot());
+    SetUp(gpio);
+    auto input =
+        Check(gpio.CreateBinary(ctx.input_channel, jetson::Direction::IN));
+    auto output =
+        Check(gpio.CreateBinary(ctx.output_channel, jetson::Direction::OUT));
+
+    int64_t delay = variant == DELAYED_RULE ? kDelay_Ns : 0;
+    if (variant == RULE || variant == DELAYED_RULE) {
+      for (auto edge : {jetson::TriggerEdge::RISING,
+                        jetson::TriggerEdge::FALLING}) {
+        jetson::ReflexRule rule;
+        rule.input = ctx.input_channel;
+        rule.edge = edge;
+        rule.output = ctx.output_channel;
+        rule.level = edge == jetson::TriggerEdge::RISING
+                         ? jetson::Signal::HIGH
+                         : jetson::Signal::LOW;
+        rule.delay = std::chrono::nanoseconds(delay);
+        Check(gpio.AddReflex(rule));
+      }
+    } else {
+      jetson::CallbackOptions options;
+      if (variant == POOL_CALLBACK) options.mode = jetson::CallbackMode::POOL;
+      input->RegisterCallback(
+          jetson::TriggerEdge::BOTH,
+          [output](int value) {
+            output->Write2(value ? jetson::Signal::HIGH : jetson::Signal::LOW);
+          },
+          options);
+    }
+
+    auto file = [&](const std::string& channel) {
+      return ctx.board.GetValueFile(
+          gpio.GetChannelInfo(jetson::BoardMode::BOARD, channel));
+    };
+    int in_fd = open(file(ctx.input_channel).c_str(), O_WRONLY);
+    int out_fd = open(file(ctx.output_channel).c_str(), O_RDONLY);
+    if (in_fd < 0 || out_fd < 0) throw std::runtime_error("open failed.");
+
+    std::vector<double> samples;
+    samples.reserve(kEdges);
+    int missed = 0;
+    bool level = false;
+    for (int i = 0; i < kEdges; i++) {
+      level = !level;
+      char expected = level ? '1' : '0';
+      char value = 0;
+      auto start = NowNs();
+      auto deadline = start + 100000000;  // 100 ms
+      (void)pwrite(in_fd, &expected, 1, 0);
+      do {
+        (void)pread(out_fd, &value, 1, 0);
+      } while (value != expected && NowNs() < deadline);
+
+      if (value != expected) {
+        missed++;
+      } else {
+        samples.push_back(NowNs() - start - delay);
+      }
+    }
+    close(in_fd);
+    close(out_fd);
+
+    auto stats = gpio.GetReflexStats();
+    bool by_rule = variant == RULE || variant == DELAYED_RULE;
+    if (missed > 0 ||
+        stats.fired != (by_rule ? static_cast<uint64_t>(kEdges) : 0)) {
+      std::cerr << "[ERROR]: " << kNames[variant] << " missed " << missed
+                << " of " << kEdges << " edges, " << stats.fired
+                << " reflexes fired" << std::endl;
+      ctx.failures++;
+    }
+
+    // A burst faster than the delay fills the pending writes of both rules;
+    // the rest is dropped rather than queued.
+    double overflows = 0;
+    if (variant == DELAYED_RULE) {
+      const int kBurst = 100;
+      auto gpio_number =
+          gpio.GetChannelInfo(jetson::BoardMode::BOARD, ctx.input_channel)
+              .gpio;
+      std::vector<jetson::EdgeEvent> burst;
+      for (int i = 0; i < kBurst; i++) {
+        burst.push_back(jetson::EdgeEvent{NowNs(), gpio_number, i % 2});
+      }
+      gpio.InjectEdges(jetson::EdgeSpan(burst.data(), burst.size()));
+      overflows = gpio.GetReflexStats().overflows;
+      if (overflows != kBurst - 2 * 16) {
+        std::cerr << "[ERROR]: " << kNames[variant] << " dropped "
+                  << overflows << " of a burst of " << kBurst << std::endl;
+        ctx.failures++;
+      }
+    }
+    ctx.reporter.Add(kNames[variant], samples,
+                     {{"missed", missed}, {"burst_overflows", overflows}});
+  }
+}
+
+/**
+ * Threads of this process, from /proc/self/status.
+ */
+int CountThreads() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 8, "Threads:") == 0) return std::stoi(line.substr(8));
+  }
+  return -1;
+}
+
+/**
+ * Edge to inline callback and scheduled writes run from an epoll loop of the
+ * benchmark, with no thread started by the library.
+ */
+void BenchEventLoop(Context& ctx) {
+  const int kEdges = std::max(2, std::min(ctx.iterations / 10, 2000));
+
+  jetson::Gpio gpio(ctx.board.GetRoot());
+  SetUp(gpio);
+  auto threads = CountThreads();
+  Check(gpio.UseEventLoop());
+
+  auto input =
+      Check(gpio.CreateBinary(ctx.input_channel, jetson::Direction::IN));
+  Check(gpio.CreateBinary(ctx.output_channel, jetson::Direction::OUT));
+  int64_t called_ns = 0;
+  input->RegisterCallback(jetson::TriggerEdge::BOTH,
+                          [&](int) { called_ns = NowNs(); });
+
+  jetson::CallbackOptions pooled;
+  pooled.mode = jetson::CallbackMode::POOL;
+  if (input->RegisterCallback(jetson::TriggerEdge::BOTH, [](int) {}, pooled)
+          .second) {
+    throw std::runtime_error("pool callback accepted in an event loop.");
+  }
+
+  int loop = epoll_create1(EPOLL_CLOEXEC);
+  for (int fd : gpio.GetPollFds()) {
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(loop, EPOLL_CTL_ADD, fd, &event) != 0) {
+      throw std::runtime_error("epoll_ctl failed.");
+    }
+  }
+
+  // one turn of the caller's loop, true if anything was dispatched
+  auto turn = [&](int timeout_ms) {
+    struct epoll_event events[2];
+    if (epoll_wait(loop, events, 2, timeout_ms) <= 0) return false;
+    gpio.Dispatch();
+    return true;
+  };
+
+  int in_fd = open(ctx.board
+                       .GetValueFile(gpio.GetChannelInfo(
+                           jetson::BoardMode::BOARD, ctx.input_channel))
+                       .c_str(),
+                   O_WRONLY);
+  if (in_fd < 0) throw std::runtime_error("open failed.");
+
+  std::vector<double> samples;
+  samples.reserve(kEdges);
+  int missed = 0;
+  for (int i = 0; i < kEdges; i++) {
+    char value = i % 2 ? '0' : '1';
+    called_ns = 0;
+    auto start = NowNs();
+    (void)pwrite(in_fd, &value, 1, 0);
+    while (called_ns == 0 && turn(100)) {
+    }
+    if (called_ns == 0) {
+      missed++;
+    } else {
+      samples.push_back(called_ns - start);
+    }
+  }
+  close(in_fd);
+  ctx.reporter.Add("event_loop/edge_to_callback", samples,
+                   {{"missed", missed}});
+
+  // scheduled writes fire from the same loop
+  samples.clear();
+  for (int i = 0; i < ctx.iterations / 10; i++) {
+    auto level = i % 2 ? jetson::Signal::HIGH : jetson::Signal::LOW;
+    auto executed = gpio.GetWriteScheduleStats().executed + 1;
+    Check(gpio.ScheduleWrite({ctx.output_channel}, level, NowNs() + 200000));
+    while (gpio.GetWriteScheduleStats().executed < executed) {
+      if (!turn(100)) throw std::runtime_error("write not issued.");
+    }
+    samples.push_back(gpio.GetWriteScheduleStats().last_late_ns);
+  }
+  close(loop);
+  ctx.reporter.Add("event_loop/scheduled_write", samples);
+
+  if (missed > 0 || CountThreads() != threads) {
+    std::cerr << "[ERROR]: event_loop missed " << missed << " of " << kEdges
+              << " edges, threads " << threads << " -> " << CountThreads()
+              << std::endl;
+    ctx.failures++;
+  }
+}
+
+void BenchEdgeLatency(Context& ctx) {
+  for (auto mode : {jetson::CallbackMode::INLINE, jetson::CallbackMode::POOL}) {
+    jetson::Gpio gpio(ctx.board.GetRoot());
+    SetUp(gpio);
+
+    jetson::CallbackOptions options;
+    options.mode = mode;
+    EdgeProbe probe(ctx, gpio, ctx.input_channel, options);
+
+    int missed = 0;
+    auto samples = probe.Run(ctx.iterations / 10, &missed);
+    gpio.DestroyBinary();
+    ctx.reporter.Add(mode == jetson::CallbackMode::INLINE
+                         ? "edge_to_callback"
+                         : "edge_to_callback_pool",
+                     samples, {{"missed", missed}});
+  }
+}
+
+/**
+ * In the spirit of cyclictest: edge to callback latency while spinning
+ * threads keep every cpu busy, with inherited scheduling and with SCHED_FIFO.
+ * The thread driving the edges runs with the same config as the library.
+ * The worst case (max) is what matters here.
+ */
+void BenchRealtimeEdge(Context& ctx) {
+  jetson::RealtimeConfig realtime;
+  realtime.policy = jetson::SchedPolicy::FIFO;
+  realtime.priority = 80;
+  realtime.lock_memory = true;
+  realtime.prefault_stack = 256 << 10;
+
+  const int kLoad_Threads = std::max(1u, std::thread::hardware_concurrency());
+  for (bool fifo : {false, true}) {
+    jetson::Gpio gpio(ctx.board.GetRoot());
+    SetUp(gpio);
+    if (fifo) {
+      auto result = gpio.SetRealtimeConfig(realtime);
+      if (!result.second) {
+        std::cerr << "[WARNING]: realtime_edge/fifo skipped, " << result.first
+                  << std::endl;
+        continue;
+      }
+    }
+    EdgeProbe probe(ctx, gpio, ctx.input_channel);
+
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> load;
+    for (int i = 0; i < kLoad_Threads; i++) {
+      load.emplace_back([&] {
+        volatile uint64_t spins = 0;
+        while (!stop.load(std::memory_order_relaxed)) spins = spins + 1;
+      });
+    }
+
+    int missed = 0;
+    std::vector<double> samples;
+    std::thread driver([&] {
+      if (fifo) Check(jetson::ApplyRealtimeConfig(realtime));
+      samples = probe.Run(ctx.iterations / 10, &missed);
+    });
+    driver.join();
+
+    stop = true;
+    for (auto& t : load) t.join();
+    gpio.DestroyBinary();
+
+    ctx.reporter.Add(fifo ? "realtime_edge/fifo" : "realtime_edge/inherit",
+                     samples,
+                     {{"missed", missed}, {"load_threads", kLoad_Threads}});
+  }
+}
+
+/**
+ * A slow pool callback on the same line as the probe falls behind; its
+ * bounded queue overflows while the probe keeps its latency.
+ */
+void BenchCallbackOverload(Context& ctx) {
+  for (auto overflow :
+       {jetson::OverflowPolicy::DROP_OLDEST, jetson::OverflowPolicy::DROP_NEWEST,
+        jetson::OverflowPolicy::COALESCE}) {
+    jetson::Gpio gpio(ctx.board.GetRoot());
+    SetUp(gpio);
+    EdgeProbe probe(ctx, gpio, ctx.input_channel);
+
+    jetson::CallbackOptions options;
+    options.mode = jetson::CallbackMode::POOL;
+    options.queue_capacity = 8;
+    options.overflow = overflow;
+    auto input = Check(gpio.CreateBinary(ctx.input_channel,
+                                         jetson::Direction::IN));
+    input->RegisterCallback(
+        jetson::TriggerEdge::BOTH,
+        [](int) { std::this_thread::sleep_for(std::chrono::microseconds(200)); },
+        options);
+
+    int missed = 0;
+    auto samples = probe.Run(ctx.iterations / 10, &missed);
+    auto stats = input->GetCallbackStats().back();
+    gpio.DestroyBinary();
+
+    const char* names[] = {"callback_overload_drop_oldest",
+                           "callback_overload_drop_newest",
+                           "callback_overload_coalesce"};
+    ctx.reporter.Add(names[static_cast<int>(overflow)], samples,
+                     {{"missed", missed},
+                      {"slow_executed", stats.executed},
+                      {"slow_dropped_oldest", stats.dropped_oldest},
+                      {"slow_dropped_newest", stats.dropped_newest},
+                      {"slow_coalesced", stats.coalesced}});
+  }
+}
+
+/**
+ * Toggles several inputs back to back and waits until every edge has been
+ * delivered, once through one inline callback per line and once through a
+ * single batch subscription holding edges back until the burst is complete.
+ * Reports the round trip of a whole burst and how many callback invocations
+ * it took.
+ */
+void BenchEdgeBatch(Context& ctx) {
+  const std::size_t kLines = std::min<std::size_t>(
+      4, ctx.binary_channels.size() - 1);
+  const std::vector<std::string> channels(
+      ctx.binary_channels.begin() + 1,
+      ctx.binary_channels.begin() + 1 + kLines);
+
+  for (bool batch : {false, true}) {
+    jetson::Gpio gpio(ctx.board.GetRoot());
+    SetUp(gpio);
+
+    auto edges = std::make_shared<std::atomic<int>>(0);
+    auto calls = std::make_shared<std::atomic<int>>(0);
+    std::vector<int> fds;
+    for (const auto& channel : channels) {
+      auto input = Check(gpio.CreateBinary(channel, jetson::Direction::IN));
+      if (!batch) {
+        input->RegisterCallback(jetson::TriggerEdge::BOTH, [=](int) {
+          edges->fetch_add(1);
+          calls->fetch_add(1);
+        });
+      }
+
+      auto value_file = ctx.board.GetValueFile(
+          gpio.GetChannelInfo(jetson::BoardMode::BOARD, channel));
+      fds.push_back(open(value_file.c_str(), O_WRONLY));
+      if (fds.back() < 0) {
+        throw std::runtime_error("open " + value_file + " failed.");
+      }
+    }
+
+    if (batch) {
+      jetson::BatchOptions options;
+      options.max_batch = kLines;
+      options.max_latency = std::chrono::milliseconds(1);
+      Check(gpio.RegisterBatchCallback(
+          channels,
+          [=](jetson::EdgeSpan span) {
+            edges->fetch_add(static_cast<int>(span.size()));
+            calls->fetch_add(1);
+          },
+          options));
+    }
+
+    std::vector<double> samples;
+    int missed = 0;
+    bool level = false;
+    for (int i = 0; i < ctx.iterations / 10; i++) {
+      int expected = edges->load() + static_cast<int>(kLines);
+      level = !level;
+      auto start = NowNs();
+      for (auto fd : fds) (void)pwrite(fd, level ? "1" : "0", 1, 0);
+
+      auto deadline = start + 100000000;  // 100 ms
+      while (edges->load() < expected && NowNs() < deadline) {
+        std::this_thread::yield();
+      }
+      if (edges->load() < expected) {
+        // resynchronize on the next burst
+        missed++;
+        edges->store(expected);
+        continue;
+      }
+      samples.push_back(NowNs() - start);
+    }
+
+    for (auto fd : fds) close(fd);
+    gpio.DestroyBinary();
+    ctx.reporter.Add(batch ? "edge_burst_batch" : "edge_burst_per_edge",
+                     samples,
+                     {{"lines", static_cast<double>(kLines)},
+                      {"missed", missed},
+                      {"edges", edges->load()},
+                      {"callbacks", calls->load()}});
+  }
+}
+
+/**
+ * Decoding cost alone: spans of a forward running encoder fed straight into
+ * the decoder. Samples are per edge.
+ */
+void BenchQuadratureDecode(Context& ctx) {
+  jetson::Gpio gpio(ctx.board.GetRoot());
+  SetUp(gpio);
+  const auto& a = ctx.binary_channels[1];
+  const auto& b = ctx.binary_channels[2];
+  jetson::QuadratureDecoder decoder(gpio, a, b);
+
+  const int kA = gpio.GetChannelInfo(jetson::BoardMode::BOARD, a).gpio;
+  const int kB = gpio.GetChannelInfo(jetson::BoardMode::BOARD, b).gpio;
+  std::vector<jetson::EdgeEvent> events(256);
+  int level_a = 0;
+  int level_b = 0;
+  for (std::size_t i = 0; i < events.size(); i++) {
+    // A and B toggle in turn: 00 -> 10 -> 11 -> 01 -> 00
+    if (i % 2 == 0) {
+      level_a = !level_a;
+      events[i] = {static_cast<int64_t>(i) * 1000, kA, level_a};
+    } else {
+      level_b = !level_b;
+      events[i] = {static_cast<int64_t>(i) * 1000, kB, level_b};
+    }
+  }
+
+  std::vector<double> samples;
+  for (int i = 0; i < ctx.iterations; i++) {
+    auto start = NowNs();
+    decoder.Decode(jetson::EdgeSpan(events.data(), events.size()));
+    samples.push_back(static_cast<double>(NowNs() - start) / events.size());
+  }
+
+  ctx.reporter.Add("quadrature_decode_per_edge", samples,
+                   {{"position", decoder.GetPosition()},
+                    {"illegal", decoder.GetIllegalTransitions()}});
+}
+
+/**
+ * Drives a simulated encoder on two inputs at rising edge rates and checks
+ * the decoded position. The fastest rate without lost or illegal counts is
+ * reported as the maximum sustainable rate.
+ */
+void BenchQuadratureSim(Context& ctx) {
+  const auto& a = ctx.binary_channels[1];
+  const auto& b = ctx.binary_channels[2];
+  const int kEdges = std::max(40, ctx.iterations / 10) / 4 * 4;
+
+  std::vector<double> best;
+  double best_rate = 0;
+  for (int64_t interval : {100000, 50000, 20000, 10000, 5000, 2000, 0}) {
+    jetson::Gpio gpio(ctx.board.GetRoot());
+    SetUp(gpio);
+
+    int fds[2];
+    for (int i = 0; i < 2; i++) {
+      auto value_file = ctx.board.GetValueFile(
+          gpio.GetChannelInfo(jetson::BoardMode::BOARD, i ? b : a));
+      fds[i] = open(value_file.c_str(), O_WRONLY);
+      if (fds[i] < 0) {
+        throw std::runtime_error("open " + value_file + " failed.");
+      }
+      (void)pwrite(fds[i], "0", 1, 0);
+    }
+
+    jetson::QuadratureDecoder decoder(gpio, a, b);
+    int levels[2] = {0, 0};
+    std::vector<double> samples;
+    auto start = NowNs();
+    auto previous = start;
+    for (int i = 0; i < kEdges; i++) {
+      while (NowNs() - previous < interval) std::this_thread::yield();
+      auto now = NowNs();
+      if (i > 0) samples.push_back(now - previous);
+      previous = now;
+
+      levels[i % 2] = !levels[i % 2];
+      (void)pwrite(fds[i % 2], levels[i % 2] ? "1" : "0", 1, 0);
+    }
+    double rate = 1e9 * kEdges / std::max<int64_t>(1, NowNs() - start);
+
+    // let the monitor catch up
+    auto deadline = NowNs() + 100000000;  // 100 ms
+    while (decoder.GetPosition() != kEdges && NowNs() < deadline) {
+      std::this_thread::yield();
+    }
+
+    auto counted = decoder.GetPosition();
+    auto illegal = decoder.GetIllegalTransitions();
+    for (auto fd : fds) close(fd);
+    if (counted == kEdges && illegal == 0 && rate > best_rate) {
+      best_rate = rate;
+      best = samples;
+    }
+
+    ctx.reporter.Add("quadrature_sim/" + std::to_string(interval / 1000) + "us",
+                     samples,
+                     {{"edges_per_sec", rate},
+                      {"expected", kEdges},
+                      {"counted", counted},
+                      {"illegal", illegal}});
+  }
+
+  ctx.reporter.Add("quadrature_sim_max_sustained", best,
+                   {{"edges_per_sec", best_rate}});
+}
+
+/**
+ * Capture cost alone: spans of a square wave fed straight into the capture.
+ * Samples are per edge.
+ */
+void BenchCaptureEdges(Context& ctx) {
+  jetson::Gpio gpio(ctx.board.GetRoot());
+  SetUp(gpio);
+  const auto& channel = ctx.binary_channels[1];
+  jetson::InputCapture capture(gpio, channel);
+
+  const int kGpio = gpio.GetChannelInfo(jetson::BoardMode::BOARD, channel).gpio;
+  std::vector<jetson::EdgeEvent> events(256);
+  int64_t time = 1;
+  for (std::size_t i = 0; i < events.size(); i++) {
+    // 200 us high, 300 us low
+    time += i % 2 ? 200000 : 300000;
+    events[i] = {time, kGpio, static_cast<int>(i % 2 == 0)};
+  }
+
+  std::vector<double> samples;
+  for (int i = 0; i < ctx.iterations; i++) {
+    for (auto& e : events) e.timestamp_ns += 128 * 500000;
+    auto start = NowNs();
+    capture.Capture(jetson::EdgeSpan(events.data(), events.size()));
+    samples.push_back(static_cast<double>(NowNs() - start) / events.size());
+  }
+
+  auto period = capture.GetPeriod();
+
+  // A reset reads as empty at once and is carried out by the next span,
+  // which must not measure a period from the edges before the reset.
+  capture.Reset();
+  if (capture.GetPeriod().count != 0) {
+    throw std::runtime_error("capture not empty after a reset.");
+  }
+  for (auto& e : events) e.timestamp_ns += 128 * 500000;
+  capture.Capture(jetson::EdgeSpan(events.data(), events.size()));
+  if (capture.GetPeriod().count != events.size() / 2 - 1) {
+    throw std::runtime_error("capture kept edges across a reset.");
+  }
+
+  ctx.reporter.Add("capture_per_edge", samples,
+                   {{"periods", period.count}, {"period_p50", period.p50_ns}});
+}
+
+/**
+ * Drives a 2 kHz signal with 40 % duty cycle on a simulated input and
+ * compares what the capture measured with what was driven. Samples are the
+ * driven periods.
+ */
+void BenchCaptureSim(Context& ctx) {
+  jetson::Gpio gpio(ctx.board.GetRoot());
+  SetUp(gpio);
+  const auto& channel = ctx.binary_channels[1];
+
+  auto value_file = ctx.board.GetValueFile(
+      gpio.GetChannelInfo(jetson::BoardMode::BOARD, channel));
+  int fd = open(value_file.c_str(), O_WRONLY);
+  if (fd < 0) throw std::runtime_error("open " + value_file + " failed.");
+  (void)pwrite(fd, "0", 1, 0);
+
+  jetson::InputCapture capture(gpio, channel);
+  const int64_t kHigh = 200000;
+  const int64_t kLow = 300000;
+
+  std::vector<double> samples;
+  auto previous_rise = NowNs();
+  auto next = previous_rise;
+  for (int i = 0; i < std::max(10, ctx.iterations / 10); i++) {
+    for (int level : {1, 0}) {
+      while (NowNs() < next) std::this_thread::yield();
+      auto now = NowNs();
+      (void)pwrite(fd, level ? "1" : "0", 1, 0);
+      if (level) {
+        if (i > 0) samples.push_back(now - previous_rise);
+        previous_rise = now;
+      }
+      next += level ? kHigh : kLow;
+    }
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  close(fd);
+
+  auto period = capture.GetPeriod();
+  auto high = capture.GetHighTime();
+  auto low = capture.GetLowTime();
+  ctx.reporter.Add("capture_sim_period", samples,
+                   {{"measured_periods", period.count},
+                    {"measured_period_mean", period.mean_ns},
+                    {"measured_period_p50", period.p50_ns},
+                    {"measured_period_p99", period.p99_ns},
+                    {"measured_high_mean", high.mean_ns},
+                    {"measured_low_mean", low.mean_ns},
+                    {"measured_hz", capture.GetFrequency()}});
+}
+
+/**
+ * Fails the run if a hot path allocates once set up: reads, writes, pwm
+ * updates and edge dispatch, inline, on the pool and in batches. Allocations
+ * are counted process wide, which covers the edge monitor and pool threads.
+ */
+void BenchAllocFree(Context& ctx) {
+  jetson::Gpio gpio(ctx.board.GetRoot());
+  SetUp(gpio);
+  auto output =
+      Check(gpio.CreateBinary(ctx.output_channel, jetson::Direction::OUT));
+  auto input =
+      Check(gpio.CreateBinary(ctx.input_channel, jetson::Direction::IN));
+  auto pwm = Check(gpio.CreatePwm(ctx.pwm_channel, 1000, 50));
+
+  struct Counters {
+    std::atomic<int> inline_edges{0};
+    std::atomic<int> pool_edges{0};
+    std::atomic<int> batch_edges{0};
+  };
+  auto counters = std::make_shared<Counters>();
+  input->RegisterCallback(jetson::TriggerEdge::BOTH,
+                          [counters](int) { counters->inline_edges++; });
+  jetson::CallbackOptions pool;
+  pool.mode = jetson::CallbackMode::POOL;
+  input->RegisterCallback(jetson::TriggerEdge::BOTH,
+                          [counters](int) { counters->pool_edges++; }, pool);
+  Check(gpio.RegisterBatchCallback(
+      {ctx.input_channel}, [counters](jetson::EdgeSpan edges) {
+        counters->batch_edges += static_cast<int>(edges.size());
+      }));
+
+  auto value_file = ctx.board.GetValueFile(
+      gpio.GetChannelInfo(jetson::BoardMode::BOARD, ctx.input_channel));
+  int fd = open(value_file.c_str(), O_WRONLY);
+  if (fd < 0) throw std::runtime_error("open " + value_file + " failed.");
+
+  bool level = false;
+  int edges = 0;
+  auto edge = [&] {
+    level = !level;
+    edges++;
+    (void)pwrite(fd, level ? "1" : "0", 1, 0);
+    auto deadline = NowNs() + 100000000;  // 100 ms
+    while ((counters->inline_edges < edges || counters->pool_edges < edges ||
+            counters->batch_edges < edges) &&
+           NowNs() < deadline) {
+      std::this_thread::yield();
+    }
+    // resynchronize after a missed edge
+    edges = std::max({counters->inline_edges.load(),
+                      counters->pool_edges.load(),
+                      counters->batch_edges.load()});
+  };
+
+  bool high = false;
+  double duty_cycle = 10;
+  double frequency = 1000;
+  const std::vector<std::pair<const char*, std::function<void()>>> kPaths = {
+      {"write2", [&] { output->Write2((high = !high) ? jetson::Signal::HIGH
+                                                     : jetson::Signal::LOW); }},
+      {"force_write", [&] { output->ForceWrite(jetson::Signal::LOW); }},
+      {"read2_output", [&] { (void)output->Read2(); }},
+      {"read2_input", [&] { (void)input->Read2(); }},
+      {"pwm_duty_cycle",
+       [&] { pwm->ResetDutyCycle(duty_cycle = 100 - duty_cycle); }},
+      {"pwm_frequency",
+       [&] { pwm->ResetFrequency(frequency = 3000 - frequency); }},
+      {"pwm_start_stop", [&] { pwm->Start(), pwm->Stop(); }},
+      {"edge_dispatch", edge}};
+
+  for (const auto& path : kPaths) {
+    bool is_edge = std::string(path.first) == "edge_dispatch";
+    int iterations = is_edge ? ctx.iterations / 10 : ctx.iterations;
+    std::vector<double> samples;
+    samples.reserve(iterations);
+
+    for (int i = 0; i < 16; i++) path.second();  // warm up
+
+    auto before = g_allocations.load();
+    for (int i = 0; i < iterations; i++) {
+      auto start = NowNs();
+      path.second();
+      samples.push_back(NowNs() - start);
+    }
+    auto allocations = g_allocations.load() - before;
+
+    if (allocations > 0) {
+      std::cerr << "[ERROR]: " << path.first << " allocated " << allocations
+                << " times" << std::endl;
+      ctx.failures++;
+    }
+    ctx.reporter.Add(std::string("alloc_free/") + path.first, samples,
+                     {{"allocations", allocations}});
+  }
+  close(fd);
+}
+
+const std::vector<Case> kCases = {
+    {"detect", BenchDetect},
+    {"binary_create_destroy", BenchCreateDestroyBinary},
+    {"teardown", BenchTeardown},
+    {"binary_write2", BenchWrite},
+    {"static_output_write", BenchStaticWrite},
+    {"trace_probes", BenchTraceProbes},
+    {"binary_read2", BenchRead},
+    {"pwm", BenchPwm},
+    {"pwm_group", BenchPwmGroup},
+    {"value_batch", BenchValueBatch},
+    {"scheduled_write", BenchScheduledWrite},
+    {"scan_cycle", BenchScanCycle},
+    {"broker", BenchBroker},
+    {"state_publish", BenchStatePublish},
+    {"metrics_export", BenchMetricsExport},
+    {"flight_recorder", BenchFlightRecorder},
+    {"edge_to_callback", BenchEdgeLatency},
+    {"reflex", BenchReflex},
+    {"event_loop", BenchEventLoop},
+    {"callback_overload", BenchCallbackOverload},
+    {"edge_batch", BenchEdgeBatch},
+    {"edge_replay", BenchEdgeReplay},
+    {"alloc_free", BenchAllocFree},
+    {"quadrature_decode", BenchQuadratureDecode},
+    {"quadrature_sim", BenchQuadratureSim},
+    {"capture_edges", BenchCaptureEdges},
+    {"capture_sim", BenchCaptureSim},
+    {"mt", BenchThreaded},
+    {"realtime_edge", BenchRealtimeEdge},  // last, it locks memory
+};
+
+void PrintUsage() {
+  std::cout << "Usage: benchmark [--json] [--iterations=N] [--filter=NAME]"
+               " [--board=nano|xavier]\n"
+               "  --json          machine readable output\n"
+               "  --iterations=N  samples per hot path (default 10000)\n"
+               "  --filter=NAME   run benchmarks whose name contains NAME\n"
+               "  --board=NAME    simulated board (default nano)\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool json = false;
+  int iterations = 10000;
+  std::string filter;
+  auto board_type = jetson::BoardType::JETSON_NANO;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--json") {
+      json = true;
+    } else if (arg.rfind("--iterations=", 0) == 0) {
+      iterations = std::max(10, std::stoi(arg.substr(13)));
+    } else if (arg.rfind("--filter=", 0) == 0) {
+      filter = arg.substr(9);
+    } else if (arg == "--board=nano") {
+      board_type = jetson::BoardType::JETSON_NANO;
+    } else if (arg == "--board=xavier") {
+      board_type = jetson::BoardType::JETSON_XAVIER;
+    } else {
+      PrintUsage();
+      return arg == "--help" ? 0 : -1;
+    }
+  }
+
+  jetson::SimulatedBoard board(board_type);
+  Reporter reporter(json);
+  Context ctx{board, reporter, iterations};
+
+  for (const auto& pin_def : jetson::kBoardPins.at(board_type)) {
+    auto channel = jetson::PinNumber2String(pin_def.board_pin_num);
+    if (pin_def.chip_pwm_sysfs_dir != jetson::kNONE) {
+      if (ctx.pwm_channel.empty()) ctx.pwm_channel = channel;
+      ctx.pwm_channels.push_back(channel);
+    } else {
+      ctx.binary_channels.push_back(channel);
+    }
+  }
+
+  ctx.output_channel = ctx.binary_channels.at(0);
+  ctx.input_channel = ctx.binary_channels.at(1);
+
+  try {
+    for (const auto& c : kCases) {
+      if (std::string(c.first).find(filter) != std::string::npos) {
+        c.second(ctx);
+      }
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "[ERROR]: " << e.what() << std::endl;
+    return -1;
+  }
+
+  reporter.Print(std::cout, jetson::BoardType2String(board_type));
+  return ctx.failures > 0 ? 1 : 0;
+}
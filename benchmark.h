@@ -0,0 +1,171 @@
+/**
+ * @file benchmark.h
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <time.h>
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace jetson {
+namespace bench {
+
+/**
+ * @brief Monotonic time in nano seconds.
+ */
+inline int64_t NowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+struct Summary {
+  std::size_t count = 0;
+  double min = 0;
+  double mean = 0;
+  double p50 = 0;
+  double p90 = 0;
+  double p99 = 0;
+  double p999 = 0;
+  double max = 0;
+  double ops_per_sec = 0;
+};
+
+/**
+ * @brief Summarize per operation samples (nano seconds). Percentiles use the
+ * nearest-rank method.
+ */
+inline Summary Summarize(std::vector<double> samples) {
+  Summary s;
+  s.count = samples.size();
+  if (samples.empty()) return s;
+
+  std::sort(samples.begin(), samples.end());
+  auto rank = [&](double p) {
+    auto index = static_cast<std::size_t>(p * (samples.size() - 1) + 0.5);
+    return samples[std::min(index, samples.size() - 1)];
+  };
+
+  double total = 0;
+  for (auto x : samples) total += x;
+
+  s.min = samples.front();
+  s.max = samples.back();
+  s.mean = total / samples.size();
+  s.p50 = rank(0.50);
+  s.p90 = rank(0.90);
+  s.p99 = rank(0.99);
+  s.p999 = rank(0.999);
+  s.ops_per_sec = total > 0 ? 1e9 * samples.size() / total : 0;
+  return s;
+}
+
+/**
+ * @brief Collects results and prints them either as a table or as JSON.
+ */
+class Reporter {
+ public:
+  using Extras = std::map<std::string, double>;
+
+  explicit Reporter(bool json) : json_(json) {}
+
+  void Add(const std::string& name, std::vector<double> samples_ns,
+           Extras extras = {}) {
+    results_.push_back({name, Summarize(std::move(samples_ns)), extras});
+  }
+
+  void Print(std::ostream& os, const std::string& board) const {
+    if (json_) {
+      PrintJson(os, board);
+    } else {
+      PrintTable(os, board);
+    }
+  }
+
+ private:
+  struct Result {
+    std::string name;
+    Summary summary;
+    Extras extras;
+  };
+
+  void PrintJson(std::ostream& os, const std::string& board) const {
+    os << std::fixed << std::setprecision(1);
+    os << "{\n  \"board\": \"" << board << "\",\n  \"unit\": \"ns\",\n"
+       << "  \"results\": [";
+    for (std::size_t i = 0; i < results_.size(); i++) {
+      const auto& r = results_[i];
+      const auto& s = r.summary;
+      os << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << r.name << "\""
+         << ", \"count\": " << s.count << ", \"min\": " << s.min
+         << ", \"mean\": " << s.mean << ", \"p50\": " << s.p50
+         << ", \"p90\": " << s.p90 << ", \"p99\": " << s.p99
+         << ", \"p999\": " << s.p999 << ", \"max\": " << s.max
+         << ", \"ops_per_sec\": " << s.ops_per_sec;
+      for (const auto& e : r.extras) {
+        os << ", \"" << e.first << "\": " << e.second;
+      }
+      os << "}";
+    }
+    os << "\n  ]\n}" << std::endl;
+  }
+
+  void PrintTable(std::ostream& os, const std::string& board) const {
+    os << "Board: " << board << " (times in ns)\n";
+    os << std::left << std::setw(36) << "benchmark" << std::right
+       << std::setw(8) << "count" << std::setw(12) << "mean" << std::setw(12)
+       << "p50" << std::setw(12) << "p99" << std::setw(12) << "p99.9"
+       << std::setw(12) << "max" << std::setw(14) << "ops/s" << '\n';
+    os << std::fixed << std::setprecision(0);
+    for (const auto& r : results_) {
+      const auto& s = r.summary;
+      os << std::left << std::setw(36) << r.name << std::right << std::setw(8)
+         << s.count << std::setw(12) << s.mean << std::setw(12) << s.p50
+         << std::setw(12) << s.p99 << std::setw(12) << s.p999 << std::setw(12)
+         << s.max << std::setw(14) << s.ops_per_sec << '\n';
+      for (const auto& e : r.extras) {
+        os << "    " << e.first << ": " << e.second << '\n';
+      }
+    }
+    os << std::flush;
+  }
+
+ private:
+  const bool json_;
+  std::vector<Result> results_;
+};
+
+}  // namespace bench
+}  // namespace jetson
@@ -31,7 +31,7 @@
  */
 
 #include "binary_gpio.h"
-#include <sys/inotify.h>
+#include <fcntl.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <chrono>
@@ -42,7 +42,7 @@
 #include <string>
 #include <thread>
 #include <utility>
-#include "limits.h"
+#include "trace.h"
 #include "types.h"
 
 namespace fs = std::experimental::filesystem;
@@ -50,18 +50,60 @@ namespace fs = std::experimental::filesystem;
 namespace jetson {
 
 BinaryController::BinaryController(ChannelInfo info, Direction direction,
-                                   Signal signal, Pull pull)
-    : info_(info), direction_(direction) {
+                                   Signal signal, Pull pull,
+                                   CallbackPool *pool, EdgeMonitor *monitor)
+    : info_(info),
+      direction_(direction),
+      pool_(pool),
+      own_monitor_(monitor ? nullptr : std::make_unique<EdgeMonitor>()),
+      monitor_(monitor ? monitor : own_monitor_.get()) {
+  metrics_.labels = "channel=\"" + info_.channel + "\",gpio=\"" +
+                    std::to_string(info_.gpio) + "\"";
   Export();
   SetDirection();
-  monitor_ = std::async(std::bind(&BinaryController::EdgeMonitor, this));
   if (direction_ == Direction::OUT) Write2(signal);
 }
 
 BinaryController::~BinaryController() {
-  if (direction_ == Direction::OUT) Write2(Signal::LOW);
+  if (!detached_) {
+    // No edge is dispatched to this controller once removed.
+    monitor_->Remove(this);
+    Detach();
+  }
   Unexport();
-  monitor_.get();
+  if (publisher_) publisher_->Release(state_.load());
+}
+
+void BinaryController::Destroy(
+    std::list<std::unique_ptr<BinaryController>> lines) {
+  // one removal per monitor instead of one per line
+  std::map<EdgeMonitor *, std::vector<BinaryController *>> watched;
+  for (auto &line : lines) watched[line->monitor_].push_back(line.get());
+  for (auto &w : watched) w.first->Remove(w.second);
+  for (auto &line : lines) line->Detach();
+
+  // and one open unexport file per sysfs root
+  std::map<std::string, int> unexport_fds;
+  for (auto &line : lines) {
+    const auto &root = line->info_.sysfs_root;
+    auto it = unexport_fds.find(root);
+    if (it == unexport_fds.end()) {
+      auto path = root + "/unexport";
+      it = unexport_fds.emplace(root, open(path.c_str(), O_WRONLY | O_CLOEXEC))
+               .first;
+    }
+    line->Unexport(it->second);
+  }
+  for (auto &fd : unexport_fds) {
+    if (fd.second >= 0) close(fd.second);
+  }
+}
+
+void BinaryController::Detach() {
+  detached_ = true;
+  for (auto id : subscriptions_) monitor_->Unsubscribe(id);
+  if (direction_ == Direction::OUT) Write2(Signal::LOW);
+  for (auto &queue : callbacks_) queue->Close();
 }
 
 void BinaryController::Write(int s) {
@@ -69,38 +111,87 @@ void BinaryController::Write(int s) {
 }
 
 void BinaryController::Write2(Signal s) {
+  JETSON_TRACE2(write_entry, info_.gpio, static_cast<int>(s));
+  const int64_t kTrace_Start = JETSON_TRACE_START(write_return);
+
+  if (policy_.load(std::memory_order_relaxed) !=
+          OutputPolicy::ELIDE_UNCHANGED ||
+      shadow_.load(std::memory_order_relaxed) !=
+          (s == Signal::HIGH ? Signal::HIGH : Signal::LOW)) {
+    ForceWrite(s);
+  } else {
+    Record(FlightOp::WRITE, static_cast<int>(s), 1);
+  }
+
+  JETSON_TRACE3(write_return, info_.gpio, static_cast<int>(s),
+                JETSON_TRACE_SINCE(kTrace_Start));
+}
+
+void BinaryController::ForceWrite(Signal s) {
   if (direction_ == Direction::OUT) {
-    f_value_.seekp(0, std::ios::beg);
-    if (s == Signal::HIGH)
-      f_value_.write("1", 1);
-    else
-      f_value_.write("0", 1);
-    f_value_.flush();
+    // Serialized per line so that the shadow always matches the last write.
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    pwrite(value_fd_, s == Signal::HIGH ? "1" : "0", 1, 0);
+    Wrote(s);
+  }
+}
+
+void BinaryController::Wrote(Signal s) {
+  shadow_.store(s == Signal::HIGH ? Signal::HIGH : Signal::LOW,
+                std::memory_order_relaxed);
+  metrics_.writes.fetch_add(1, std::memory_order_relaxed);
+  Record(FlightOp::WRITE, static_cast<int>(s));
+
+  if (auto state = state_.load(std::memory_order_acquire)) {
+    state->Update([&](PinState &p) {
+      p.level = s == Signal::HIGH ? 1 : 0;
+      p.updated_ns = MonotonicNs();
+    });
   }
 }
 
 int BinaryController::Read() { return Read2() == Signal::LOW ? 0 : 1; }
 
 Signal BinaryController::Read2() {
-  if (direction_ == Direction::IN) {
+  JETSON_TRACE1(read_entry, info_.gpio);
+  const int64_t kTrace_Start = JETSON_TRACE_START(read_return);
+
+  Signal level = Signal::UNKNOWN;
+  if (direction_ == Direction::IN ||
+      readback_.load(std::memory_order_relaxed) == OutputReadback::VERIFY) {
     char value = 0;
-    f_value_.seekg(0, std::ios::beg);
-    f_value_.read(&value, 1);
-    return (value - '0') == 0 ? Signal::LOW : Signal::HIGH;
+    pread(value_fd_, &value, 1, 0);
+    level = (value - '0') == 0 ? Signal::LOW : Signal::HIGH;
+  } else {
+    level = shadow_.load(std::memory_order_relaxed);
   }
+  Record(FlightOp::READ, static_cast<int>(level));
+
+  JETSON_TRACE3(read_return, info_.gpio, static_cast<int>(level),
+                JETSON_TRACE_SINCE(kTrace_Start));
+  return level;
+}
 
-  return Signal::UNKNOWN;
+void BinaryController::SetOutputPolicy(OutputPolicy policy) {
+  policy_.store(policy, std::memory_order_relaxed);
+}
+
+void BinaryController::SetOutputReadback(OutputReadback readback) {
+  readback_.store(readback, std::memory_order_relaxed);
 }
 
 void BinaryController::Export() {
-  const std::string kEXPORT_FILE = kSysfs_Root + "/export";
-  const std::string kGPIO_DIR = kSysfs_Root + "/" + info_.gpio_name;
+  JETSON_TRACE1(export_entry, info_.gpio);
+  const int64_t kTrace_Start = JETSON_TRACE_START(export_return);
+
+  const std::string kEXPORT_FILE = info_.sysfs_root + "/export";
+  const std::string kGPIO_DIR = info_.sysfs_root + "/" + info_.gpio_name;
   const std::string kGPIO_DIRECTION_FILE =
-      kSysfs_Root + "/" + info_.gpio_name + "/direction";
+      info_.sysfs_root + "/" + info_.gpio_name + "/direction";
   const std::string kGPIO_VALUE_FILE =
-      kSysfs_Root + "/" + info_.gpio_name + "/value";
+      info_.sysfs_root + "/" + info_.gpio_name + "/value";
   const std::string kGPIO_EDGE_FILE =
-      kSysfs_Root + "/" + info_.gpio_name + "/edge";
+      info_.sysfs_root + "/" + info_.gpio_name + "/edge";
 
   // Export channel by writing into export file
   if (!fs::exists(kGPIO_DIR)) {
@@ -129,24 +220,38 @@ void BinaryController::Export() {
       throw std::runtime_error(
           "Gpio exported but gpio directory was not created.");
     }
+  }
 
-    f_direction_.open(kGPIO_DIRECTION_FILE);
-    f_value_.open(kGPIO_VALUE_FILE);
+  // A channel left exported (e.g. by a previous process) is reused as is.
+  f_direction_.open(kGPIO_DIRECTION_FILE);
+  value_fd_ = open(kGPIO_VALUE_FILE.c_str(), O_RDWR | O_CLOEXEC);
+  if (value_fd_ < 0) throw std::runtime_error("open \"value\" file failed.");
 
-    // always trigger on both edge
-    std::ofstream f_edge(kGPIO_EDGE_FILE, std::ios::out | std::ios::binary);
-    std::string edge_name("both");
-    f_edge.write(edge_name.c_str(), edge_name.size());
-    f_edge.close();
-  }
+  // always trigger on both edge
+  std::ofstream f_edge(kGPIO_EDGE_FILE, std::ios::out | std::ios::binary);
+  std::string edge_name("both");
+  f_edge.write(edge_name.c_str(), edge_name.size());
+  f_edge.close();
+
+  JETSON_TRACE2(export_return, info_.gpio, JETSON_TRACE_SINCE(kTrace_Start));
 }
 
-void BinaryController::Unexport() {
-  f_value_.close();
+void BinaryController::Unexport(int unexport_fd) {
+  if (unexported_) return;
+  unexported_ = true;
+
+  if (value_fd_ >= 0) close(value_fd_);
+  value_fd_ = -1;
   f_direction_.close();
 
-  std::ofstream file(kSysfs_Root + "/unexport");
   std::string gpio_num_str = std::to_string(info_.gpio);
+  if (unexport_fd >= 0) {
+    // sysfs takes every write as a whole, regardless of the offset
+    (void)pwrite(unexport_fd, gpio_num_str.c_str(), gpio_num_str.size(), 0);
+    return;
+  }
+
+  std::ofstream file(info_.sysfs_root + "/unexport");
   file.write(gpio_num_str.c_str(), gpio_num_str.size());
   file.close();
 }
@@ -164,59 +269,102 @@ Direction BinaryController::GetDirection() const { return direction_; }
 
 std::string BinaryController::GetChannel() const { return info_.channel; }
 
-void BinaryController::RegisterCallback(TriggerEdge edge,
-                                        TriggerCallBack callback) {
-  callbacks_[edge].emplace_back(std::move(callback));
+int BinaryController::NativeHandle() const { return value_fd_; }
+
+JResult BinaryController::RegisterCallback(TriggerEdge edge,
+                                           TriggerCallBack callback,
+                                           CallbackOptions options) {
+  if (options.mode == CallbackMode::POOL && pool_ == nullptr) {
+    return JResult{"No worker pool for pool callbacks", false};
+  }
+  if (options.mode == CallbackMode::EXECUTOR && !options.executor) {
+    return JResult{"No executor for executor callbacks", false};
+  }
+
+  auto queue = std::make_shared<CallbackQueue>(edge, std::move(callback),
+                                               std::move(options), pool_,
+                                               &metrics_);
+  {
+    std::unique_lock<std::shared_mutex> lock(callbacks_mutex_);
+    callbacks_.emplace_back(std::move(queue));
+  }
+  Watch();
+  return JResult{"Ok", true};
 }
 
-void BinaryController::EdgeMonitor() {
-  int inotify = inotify_init();
+std::vector<CallbackStats> BinaryController::GetCallbackStats() const {
+  std::shared_lock<std::shared_mutex> lock(callbacks_mutex_);
+  std::vector<CallbackStats> stats;
+  for (const auto &queue : callbacks_) stats.push_back(queue->GetStats());
+  return stats;
+}
 
-  const std::string kGPIO_VALUE_FILE =
-      kSysfs_Root + "/" + info_.gpio_name + "/value";
-  int watch = inotify_add_watch(inotify, kGPIO_VALUE_FILE.c_str(),
-                                IN_MODIFY | IN_CLOSE_WRITE);
-
-  bool delete_detected = false;
-  while (!delete_detected) {
-    constexpr int kEvent_Size = sizeof(struct inotify_event);
-    constexpr int kEvent_Buffer_Len = (kEvent_Size + NAME_MAX + 1) * 8;
-    char buffer[kEvent_Buffer_Len];
-    auto length = read(inotify, buffer, kEvent_Buffer_Len);
-
-    int i = 0;
-    while (i < length) {
-      struct inotify_event *event =
-          reinterpret_cast<struct inotify_event *>(&buffer + i);
-
-      if (event->mask & IN_CLOSE_WRITE) {
-        delete_detected = true;
-        break;
-      }
+void BinaryController::RegisterBatchCallback(
+    EdgeMonitor::BatchCallBack callback, BatchOptions options) {
+  auto id = monitor_->Subscribe({info_.gpio}, std::move(callback), options);
+  {
+    std::unique_lock<std::shared_mutex> lock(callbacks_mutex_);
+    subscriptions_.push_back(id);
+  }
+  Watch();
+}
 
-      if (event->mask & IN_MODIFY) {
-        auto value = Read();
-        for (auto &cb : callbacks_[TriggerEdge::BOTH]) {
-          std::invoke(cb, value);
-        }
-
-        if (value == 1) {
-          for (auto &cb : callbacks_[TriggerEdge::RISING]) {
-            std::invoke(cb, value);
-          }
-        } else {
-          for (auto &cb : callbacks_[TriggerEdge::FALLING]) {
-            std::invoke(cb, value);
-          }
-        }
-      }
+void BinaryController::Watch() {
+  std::call_once(watched_, [this] {
+    monitor_->Add(this, info_.sysfs_root + "/" + info_.gpio_name + "/value",
+                  info_.gpio);
+  });
+}
 
-      i += kEvent_Size + event->len;
+void BinaryController::Dispatch(int value, int64_t timestamp_ns) {
+  auto edge = value == 1 ? TriggerEdge::RISING : TriggerEdge::FALLING;
+  (value == 1 ? metrics_.rising_edges : metrics_.falling_edges)
+      .fetch_add(1, std::memory_order_relaxed);
+  Record(FlightOp::EDGE, value);
+  if (auto state = state_.load(std::memory_order_acquire)) {
+    state->Update([&](PinState &p) {
+      p.level = value;
+      (value == 1 ? p.rising_edges : p.falling_edges)++;
+      p.updated_ns = MonotonicNs();
+    });
+  }
+
+  std::shared_lock<std::shared_mutex> lock(callbacks_mutex_);
+  for (auto &queue : callbacks_) {
+    if (queue->GetEdge() == TriggerEdge::BOTH || queue->GetEdge() == edge) {
+      queue->Push(value, timestamp_ns);
     }
   }
+}
 
-  inotify_rm_watch(inotify, watch);
-  close(inotify);
+void BinaryController::AttachPublisher(StatePublisher *publisher) {
+  auto record = publisher->Acquire(info_, PIN_BINARY);
+  if (record == nullptr) return;
+
+  {
+    // no write slips in between reading and publishing the level
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    auto level = direction_ == Direction::IN ? Read2() : shadow_.load();
+    record->Update([&](PinState &p) {
+      p.direction = static_cast<int32_t>(direction_);
+      p.level = level == Signal::UNKNOWN ? -1 : level == Signal::HIGH;
+    });
+    publisher_ = publisher;
+    state_.store(record, std::memory_order_release);
+  }
+
+  // inputs are watched so that their edges are counted
+  if (direction_ == Direction::IN) Watch();
+}
+
+void BinaryController::AttachRecorder(FlightRecorder *recorder) {
+  recorder_.store(recorder, std::memory_order_release);
+}
+
+void BinaryController::Record(FlightOp op, int value, int64_t arg) {
+  if (auto recorder = recorder_.load(std::memory_order_acquire)) {
+    recorder->Record(op, info_.gpio, value, arg);
+  }
 }
 
 }  // namespace jetson
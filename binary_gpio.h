@@ -30,22 +30,46 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#pragma once
+
 #include <atomic>
 #include <fstream>
-#include <future>
 #include <list>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <vector>
+#include "callback_executor.h"
+#include "edge_monitor.h"
+#include "flight_recorder.h"
+#include "metrics.h"
+#include "state_publisher.h"
 #include "types.h"
 
 namespace jetson {
+
+template <BoardType B, BoardMode M, int Pin>
+class StaticOutput;
+
+/**
+ * @brief A binary (input or output) GPIO line.
+ *
+ * All member functions may be called concurrently. Writes to one line are
+ * serialized, writes to different lines never contend. Inline callbacks run
+ * on the edge monitor thread; no callback may register further callbacks, or
+ * destroy a controller watched by the same monitor.
+ */
 class BinaryController {
  public:
-  using TriggerCallBack = std::function<void(int)>;
+  using TriggerCallBack = InplaceFunction<void(int)>;
 
  public:
   BinaryController(ChannelInfo info, Direction direction,
-                   Signal initial_value = Signal::LOW, Pull pull = Pull::OFF);
+                   Signal initial_value = Signal::LOW, Pull pull = Pull::OFF,
+                   CallbackPool* pool = nullptr,
+                   EdgeMonitor* monitor = nullptr);
   ~BinaryController();
 
   /**
@@ -57,12 +81,20 @@ class BinaryController {
   void Write(int signal);
 
   /**
-   * @brief Output a signal.
+   * @brief Output a signal. With OutputPolicy::ELIDE_UNCHANGED, nothing is
+   * written if the output already drives the signal.
    *
    * @param signal high or low
    */
   void Write2(Signal signal);
 
+  /**
+   * @brief Output a signal regardless of the output policy.
+   *
+   * @param signal high or low
+   */
+  void ForceWrite(Signal signal);
+
   /**
    * @brief Read a input signal.
    *
@@ -71,12 +103,29 @@ class BinaryController {
   int Read();
 
   /**
-   * @brief Read from the input signal.
+   * @brief Read from the input signal. On an output, this returns the level
+   * last driven, or what the value file reads back with
+   * OutputReadback::VERIFY.
    *
-   * @return high or low.
+   * @return high or low. Unknown for an output that was never driven.
    */
   Signal Read2();
 
+  /**
+   * @brief Set whether redundant output writes are skipped. Defaults to
+   * OutputPolicy::WRITE_THROUGH.
+   *
+   * @param policy the output policy.
+   */
+  void SetOutputPolicy(OutputPolicy policy);
+
+  /**
+   * @brief Set how an output is read back. Defaults to OutputReadback::SHADOW.
+   *
+   * @param readback the readback mode.
+   */
+  void SetOutputReadback(OutputReadback readback);
+
   /**
    * @brief Get the direction
    *
@@ -92,29 +141,96 @@ class BinaryController {
   std::string GetChannel() const;
 
   /**
-   * @brief Register a call back for an edge event.
+   * @brief Get the file descriptor of the value file. It stays valid for the
+   * lifetime of the controller.
+   *
+   * @return file descriptor of the value file.
+   */
+  int NativeHandle() const;
+
+  /**
+   * @brief Register a call back for an edge event. The line is watched from
+   * the first registration on. By default the callback runs on the edge
+   * monitor thread. With CallbackMode::POOL or
+   * CallbackMode::EXECUTOR, edges are queued in a bounded queue of the
+   * callback and delivered in order on the worker pool of the Gpio or on the
+   * given executor, so a slow callback never holds up edge detection.
    *
    * @param edge the event for which call back is triggered.
    * @param callback the register callback for the given edge event.
+   * @param options where the callback runs and how its queue overflows.
+   * @return The result of registration. CallbackMode::POOL is refused
+   * without a worker pool, as in event loop mode (see Gpio::UseEventLoop),
+   * CallbackMode::EXECUTOR without an executor.
+   */
+  JResult RegisterCallback(TriggerEdge edge, TriggerCallBack callback,
+                           CallbackOptions options = {});
+
+  /**
+   * @brief Get the delivery counters of the registered callbacks, in
+   * registration order.
+   *
+   * @return one entry per registered callback.
+   */
+  std::vector<CallbackStats> GetCallbackStats() const;
+
+  /**
+   * @brief Register a callback receiving the edges of this line in spans.
+   * Edges reported by one wake-up of the edge monitor are delivered together,
+   * up to options.max_batch per span. A non zero options.max_latency holds
+   * edges back for at most that long to gather larger spans.
+   *
+   * @param callback called on the edge monitor thread.
+   * @param options batch size and latency bounds.
    */
-  void RegisterCallback(TriggerEdge edge, TriggerCallBack callback);
+  void RegisterBatchCallback(EdgeMonitor::BatchCallBack callback,
+                             BatchOptions options = {});
 
  private:
   BinaryController(const BinaryController &) = delete;
   BinaryController(BinaryController &&) = delete;
 
  private:
+  static void Destroy(std::list<std::unique_ptr<BinaryController>> lines);
   void Export();
-  void Unexport();
+  void Unexport(int unexport_fd = -1);
+  void Detach();  // once removed from the monitor
   void SetDirection();
-  void EdgeMonitor();
+  void Watch();
+  void Dispatch(int value, int64_t timestamp_ns = 0);
+  void Wrote(Signal signal);  // with write_mutex_ held, or by StaticOutput
+  void AttachPublisher(StatePublisher* publisher);
+  void AttachRecorder(FlightRecorder* recorder);
+  void Record(FlightOp op, int value, int64_t arg = 0);
+
+  friend class EdgeMonitor;
+  friend class Gpio;
+  friend class ValueBatch;
+  friend class WriteScheduler;
+  template <BoardType B, BoardMode M, int Pin>
+  friend class StaticOutput;
 
  private:
   const ChannelInfo info_;
   const Direction direction_;
   std::ofstream f_direction_;
-  std::fstream f_value_;
-  std::future<void> monitor_;
-  std::map<TriggerEdge, std::list<TriggerCallBack>> callbacks_;
+  int value_fd_ = -1;
+  std::atomic<Signal> shadow_{Signal::UNKNOWN};
+  std::atomic<OutputPolicy> policy_{OutputPolicy::WRITE_THROUGH};
+  std::atomic<OutputReadback> readback_{OutputReadback::SHADOW};
+  std::mutex write_mutex_;
+  CallbackPool *const pool_;
+  std::unique_ptr<EdgeMonitor> own_monitor_;  // when none is shared
+  EdgeMonitor *const monitor_;
+  std::once_flag watched_;
+  std::vector<int> subscriptions_;
+  mutable std::shared_mutex callbacks_mutex_;
+  std::vector<std::shared_ptr<CallbackQueue>> callbacks_;
+  StatePublisher* publisher_ = nullptr;
+  std::atomic<PinStateRecord*> state_{nullptr};  // when published
+  std::atomic<FlightRecorder*> recorder_{nullptr};
+  LineMetrics metrics_;
+  bool detached_ = false;
+  bool unexported_ = false;
 };
 }  // namespace jetson
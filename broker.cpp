@@ -0,0 +1,330 @@
+/**
+ * @file broker.cpp
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "broker.h"
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+namespace jetson {
+
+using broker::Message;
+using broker::Op;
+
+// How long the broker sleeps without requests before checking for dead
+// clients and for being stopped.
+static const int64_t kIdle_Ns = 100000000;  // 100 ms
+
+static bool Alive(int32_t pid) {
+  return pid > 0 && (kill(pid, 0) == 0 || errno != ESRCH);
+}
+
+// The state first: a client claims a slot by its pid and expects it free.
+static void Free(broker::Slot& slot) {
+  slot.state.store(broker::FREE, std::memory_order_release);
+  slot.pid.store(0, std::memory_order_release);
+}
+
+GpioBroker::GpioBroker(Gpio& gpio, std::string name)
+    : gpio_(gpio), name_(std::move(name)) {
+  fd_ = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0666);
+  if (fd_ < 0 && errno == EEXIST) {
+    // left behind by a broker that died, unless it still runs
+    int fd = shm_open(name_.c_str(), O_RDWR, 0);
+    if (fd >= 0) {
+      void* old = mmap(nullptr, sizeof(broker::Segment), PROT_READ,
+                       MAP_SHARED, fd, 0);
+      bool running = old != MAP_FAILED &&
+                     static_cast<broker::Segment*>(old)->magic ==
+                         broker::kMagic &&
+                     Alive(static_cast<broker::Segment*>(old)->broker_pid);
+      if (old != MAP_FAILED) munmap(old, sizeof(broker::Segment));
+      close(fd);
+      if (running) throw std::runtime_error("broker " + name_ + " runs.");
+    }
+
+    shm_unlink(name_.c_str());
+    fd_ = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0666);
+  }
+
+  if (fd_ < 0 || ftruncate(fd_, sizeof(broker::Segment)) != 0) {
+    if (fd_ >= 0) close(fd_);
+    throw std::runtime_error("create broker segment " + name_ + " failed.");
+  }
+
+  void* memory = mmap(nullptr, sizeof(broker::Segment),
+                      PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (memory == MAP_FAILED) {
+    close(fd_);
+    shm_unlink(name_.c_str());
+    throw std::runtime_error("map broker segment " + name_ + " failed.");
+  }
+
+  segment_ = new (memory) broker::Segment();
+  segment_->magic = broker::kMagic;
+  segment_->version = broker::kVersion;
+  segment_->broker_pid.store(getpid());
+
+  thread_ = std::async(std::launch::async, &GpioBroker::Run, this);
+}
+
+GpioBroker::~GpioBroker() {
+  stop_ = true;
+  segment_->broker_bell.Ring();
+  thread_.get();
+
+  for (int client = 0; client < broker::kMax_Clients; client++) {
+    Release(client);
+  }
+  segment_->broker_pid.store(0);
+
+  munmap(segment_, sizeof(broker::Segment));
+  close(fd_);
+  shm_unlink(name_.c_str());
+}
+
+int GpioBroker::GetClients() const {
+  int clients = 0;
+  for (const auto& slot : segment_->slots) {
+    if (slot.state.load() == broker::CONNECTED) clients++;
+  }
+  return clients;
+}
+
+void GpioBroker::Run() {
+  auto reaped = MonotonicNs();
+  while (!stop_) {
+    auto seen = segment_->broker_bell.rings.load();
+
+    bool busy = false;
+    for (int client = 0; client < broker::kMax_Clients; client++) {
+      auto& slot = segment_->slots[client];
+      auto state = slot.state.load(std::memory_order_acquire);
+      if (state == broker::CONNECTED) {
+        busy |= Serve(client);
+      } else if (state == broker::CLOSING) {
+        Release(client);
+        Free(slot);
+      }
+    }
+    if (busy) continue;
+
+    if (MonotonicNs() - reaped > kIdle_Ns) {
+      Reap();
+      reaped = MonotonicNs();
+    }
+    segment_->broker_bell.Wait(seen, kIdle_Ns);
+  }
+}
+
+bool GpioBroker::Serve(int client) {
+  // a bounded number per turn, so that no client starves the others
+  Message request;
+  int served = 0;
+  while (served < 64 && segment_->slots[client].requests.Pop(request)) {
+    Handle(client, request);
+    served++;
+  }
+  return served > 0;
+}
+
+void GpioBroker::Handle(int client, const Message& request) {
+  if (request.op == Op::OPEN) {
+    Open(client, request);
+    return;
+  }
+
+  Line* line = nullptr;
+  if (request.op == Op::CLOSE && request.handle < 0) {
+    // the client gave up waiting for the handle
+    line = Find(client, std::string(request.text,
+                                    strnlen(request.text,
+                                            sizeof(request.text))));
+  } else {
+    line = Find(client, request.handle);
+  }
+  switch (request.op) {
+    case Op::CLOSE:
+      if (line) Close(client, line);
+      break;
+    case Op::WRITE:
+      if (line && line->owner == client) {
+        line->controller->Write2(request.value ? Signal::HIGH : Signal::LOW);
+      }
+      break;
+    case Op::READ:
+      if (line == nullptr) {
+        Reply(client, request.seq, -1, "Line not open");
+      } else {
+        Reply(client, request.seq,
+              line->controller->Read2() == Signal::HIGH ? 1 : 0);
+      }
+      break;
+    case Op::SUBSCRIBE:
+      if (line == nullptr || line->direction != Direction::IN) {
+        Reply(client, request.seq, -1, "Line not open as input");
+      } else {
+        line->subscribers.fetch_or(1u << client);
+        Reply(client, request.seq, 0);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void GpioBroker::Open(int client, const Message& request) {
+  std::string channel(request.text,
+                      strnlen(request.text, sizeof(request.text)));
+  auto direction = request.value == static_cast<int>(Direction::OUT)
+                       ? Direction::OUT
+                       : Direction::IN;
+
+  for (auto& line : lines_) {
+    if (!line || line->channel != channel) continue;
+
+    if (line->direction != direction) {
+      Reply(client, request.seq, -1,
+            "Channel " + channel + " is used as " +
+                (line->direction == Direction::OUT ? "output" : "input"));
+    } else if (direction == Direction::OUT && line->owner != client) {
+      Reply(client, request.seq, -1,
+            "Channel " + channel + " is owned by another client");
+    } else {
+      line->openers |= 1u << client;
+      Reply(client, request.seq, line->handle);
+    }
+    return;
+  }
+
+  auto created = gpio_.CreateBinary(channel, direction);
+  if (!created.second) {
+    Reply(client, request.seq, -1, created.first);
+    return;
+  }
+
+  // a free handle, or a new one
+  int handle = 0;
+  while (handle < static_cast<int>(lines_.size()) && lines_[handle]) handle++;
+  if (handle == static_cast<int>(lines_.size())) lines_.emplace_back();
+
+  lines_[handle] = std::make_unique<Line>();
+  auto line = lines_[handle].get();
+  line->channel = channel;
+  line->handle = handle;
+  line->controller = created.second;
+  line->direction = direction;
+  line->owner = direction == Direction::OUT ? client : -1;
+  line->openers = 1u << client;
+
+  if (direction == Direction::IN) {
+    // fanned out on the edge monitor thread, the only producer of events
+    line->controller->RegisterCallback(
+        TriggerEdge::BOTH, [this, line](int value) {
+          Message event = {Op::EDGE, 0, line->handle, value, MonotonicNs(), {}};
+          auto subscribers = line->subscribers.load();
+          for (int client = 0; subscribers != 0; client++, subscribers >>= 1) {
+            if (!(subscribers & 1)) continue;
+
+            auto& slot = segment_->slots[client];
+            if (slot.events.Push(event)) {
+              slot.event_bell.Ring();
+            } else {
+              slot.dropped_events.fetch_add(1);
+            }
+          }
+        });
+  }
+
+  Reply(client, request.seq, handle);
+}
+
+void GpioBroker::Close(int client, Line* line) {
+  line->openers &= ~(1u << client);
+  line->subscribers.fetch_and(~(1u << client));
+  if (line->owner == client) line->owner = -1;
+  if (line->openers != 0) return;
+
+  // waits for an edge being fanned out
+  gpio_.DestroyBinary(line->channel);
+  lines_[line->handle].reset();
+}
+
+void GpioBroker::Reply(int client, uint32_t seq, int value,
+                       const std::string& error) {
+  auto& slot = segment_->slots[client];
+  slot.reply = Message{Op::REPLY, seq, 0, value, MonotonicNs(), {}};
+  slot.reply.SetText(error);
+  slot.reply_seq.store(seq, std::memory_order_release);
+  slot.reply_bell.Ring();
+}
+
+void GpioBroker::Release(int client) {
+  for (auto& line : lines_) {
+    if (line && (line->openers & (1u << client))) Close(client, line.get());
+  }
+}
+
+void GpioBroker::Reap() {
+  for (int client = 0; client < broker::kMax_Clients; client++) {
+    auto& slot = segment_->slots[client];
+    // claimed, connected or closing, the slot of a dead client is freed
+    auto pid = slot.pid.load();
+    if (pid != 0 && !Alive(pid)) {
+      Release(client);
+      Free(slot);
+    }
+  }
+}
+
+GpioBroker::Line* GpioBroker::Find(int client, int handle) {
+  if (handle < 0 || handle >= static_cast<int>(lines_.size())) return nullptr;
+
+  auto line = lines_[handle].get();
+  return line && (line->openers & (1u << client)) ? line : nullptr;
+}
+
+GpioBroker::Line* GpioBroker::Find(int client, const std::string& channel) {
+  for (auto& line : lines_) {
+    if (line && line->channel == channel && (line->openers & (1u << client))) {
+      return line.get();
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace jetson
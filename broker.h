@@ -0,0 +1,113 @@
+/**
+ * @file broker.h
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include "broker_shm.h"
+#include "gpio.h"
+
+namespace jetson {
+
+// Name of the shared memory segment of the broker, unless given otherwise.
+static constexpr const char* kBroker_Name = "/jetson_gpio";
+
+/**
+ * @brief Serves the binary lines of a Gpio to other processes (see
+ * BrokerClient). Clients talk to the broker through rings in a shared memory
+ * segment; futex doorbells wake either side only while it sleeps.
+ *
+ * An output belongs to the client that opened it until it is closed; an
+ * input may be opened by any number of clients, which all receive its edges.
+ * Lines are created on first open and destroyed with their last close. The
+ * lines of a client that disconnects or dies are released.
+ */
+class GpioBroker {
+ public:
+  /**
+   * @brief Create the segment and start serving. Throws if another broker
+   * serves under the same name.
+   *
+   * @param gpio a Gpio with its board mode set. Its binary lines must not be
+   * used otherwise while the broker runs.
+   * @param name name of the shared memory segment.
+   */
+  explicit GpioBroker(Gpio& gpio, std::string name = kBroker_Name);
+  ~GpioBroker();
+
+  /**
+   * @brief Get the number of connected clients.
+   */
+  int GetClients() const;
+
+ private:
+  GpioBroker(const GpioBroker&) = delete;
+  GpioBroker(GpioBroker&&) = delete;
+
+ private:
+  struct Line {
+    std::string channel;
+    int handle;
+    BinaryController* controller;
+    Direction direction;
+    int owner;         // client writing an output
+    uint32_t openers;  // bit per client
+    std::atomic<uint32_t> subscribers{0};  // bit per client
+  };
+
+  void Run();
+  bool Serve(int client);
+  void Handle(int client, const broker::Message& request);
+  void Open(int client, const broker::Message& request);
+  void Close(int client, Line* line);
+  void Reply(int client, uint32_t seq, int value,
+             const std::string& error = "");
+  void Release(int client);
+  void Reap();
+  Line* Find(int client, int handle);
+  Line* Find(int client, const std::string& channel);
+
+ private:
+  Gpio& gpio_;
+  const std::string name_;
+  int fd_ = -1;
+  broker::Segment* segment_ = nullptr;
+  std::atomic<bool> stop_{false};
+  std::future<void> thread_;
+
+  std::vector<std::unique_ptr<Line>> lines_;  // by handle, broker thread only
+};
+
+}  // namespace jetson
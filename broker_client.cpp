@@ -0,0 +1,288 @@
+/**
+ * @file broker_client.cpp
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "broker_client.h"
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace jetson {
+
+using broker::Message;
+using broker::Op;
+
+// How long a request waits for the reply of the broker.
+static const int64_t kReply_Timeout_Ns = 1000000000;  // 1 s
+
+RemoteLine::RemoteLine(BrokerClient* client, std::string channel,
+                       Direction direction, int handle)
+    : client_(client),
+      channel_(std::move(channel)),
+      direction_(direction),
+      handle_(handle) {}
+
+void RemoteLine::Write2(Signal signal) {
+  client_->Send(Message{Op::WRITE, 0, handle_,
+                        signal == Signal::HIGH ? 1 : 0, 0, {}});
+}
+
+Signal RemoteLine::Read2() {
+  auto reply = client_->Request(Message{Op::READ, 0, handle_, 0, 0, {}});
+  if (reply.second < 0) return Signal::UNKNOWN;
+  return reply.second == 1 ? Signal::HIGH : Signal::LOW;
+}
+
+JResult RemoteLine::RegisterCallback(TriggerEdge edge,
+                                     TriggerCallBack callback) {
+  std::lock_guard<std::mutex> lock(callbacks_mutex_);
+  if (!subscribed_) {
+    auto reply =
+        client_->Request(Message{Op::SUBSCRIBE, 0, handle_, 0, 0, {}});
+    if (reply.second < 0) return JResult{reply.first, false};
+    subscribed_ = true;
+    std::call_once(client_->events_started_, [this] {
+      client_->events_thread_ = std::async(
+          std::launch::async, &BrokerClient::RunEvents, client_);
+    });
+  }
+
+  callbacks_.emplace_back(edge, std::move(callback));
+  return JResult{"Ok", true};
+}
+
+std::string RemoteLine::GetChannel() const { return channel_; }
+
+Direction RemoteLine::GetDirection() const { return direction_; }
+
+void RemoteLine::Dispatch(int value) {
+  auto edge = value == 1 ? TriggerEdge::RISING : TriggerEdge::FALLING;
+  std::lock_guard<std::mutex> lock(callbacks_mutex_);
+  for (auto& callback : callbacks_) {
+    if (callback.first == TriggerEdge::BOTH || callback.first == edge) {
+      callback.second(value);
+    }
+  }
+}
+
+BrokerClient::BrokerClient(const std::string& name) {
+  fd_ = shm_open(name.c_str(), O_RDWR, 0);
+  struct stat info;
+  if (fd_ < 0 || fstat(fd_, &info) != 0 ||
+      info.st_size < static_cast<off_t>(sizeof(broker::Segment))) {
+    if (fd_ >= 0) close(fd_);
+    throw std::runtime_error("no broker at " + name + ".");
+  }
+
+  void* memory = mmap(nullptr, sizeof(broker::Segment),
+                      PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (memory == MAP_FAILED) {
+    close(fd_);
+    throw std::runtime_error("map broker segment " + name + " failed.");
+  }
+  segment_ = static_cast<broker::Segment*>(memory);
+
+  if (segment_->magic != broker::kMagic ||
+      segment_->version != broker::kVersion ||
+      segment_->broker_pid.load() <= 0) {
+    munmap(segment_, sizeof(broker::Segment));
+    close(fd_);
+    throw std::runtime_error("no broker at " + name + ".");
+  }
+
+  for (auto& slot : segment_->slots) {
+    // The pid claims the slot, so the broker reaps it should this process
+    // die at any point from here on.
+    int32_t none = 0;
+    if (!slot.pid.compare_exchange_strong(none, getpid())) continue;
+
+    uint32_t expected = broker::FREE;
+    if (!slot.state.compare_exchange_strong(expected, broker::CLAIMED)) {
+      slot.pid.store(0);
+      continue;
+    }
+
+    slot.requests.Reset();
+    slot.events.Reset();
+    slot.reply_seq.store(0);
+    slot.dropped_events.store(0);
+    slot.state.store(broker::CONNECTED, std::memory_order_release);
+    slot_ = &slot;
+    return;
+  }
+
+  munmap(segment_, sizeof(broker::Segment));
+  close(fd_);
+  throw std::runtime_error("broker " + name + " has no free client slot.");
+}
+
+BrokerClient::~BrokerClient() {
+  if (events_thread_.valid()) {
+    stop_ = true;
+    slot_->event_bell.Ring();
+    events_thread_.get();
+  }
+
+  // the broker releases the lines of the client
+  slot_->state.store(broker::CLOSING, std::memory_order_release);
+  segment_->broker_bell.Ring();
+
+  munmap(segment_, sizeof(broker::Segment));
+  close(fd_);
+}
+
+JOutcome<RemoteLine*> BrokerClient::Open(const std::string& channel,
+                                         Direction direction) {
+  // The broker hands out one handle per channel and client; serialized, so
+  // that concurrent opens don't make two lines of it.
+  std::lock_guard<std::mutex> open_lock(open_mutex_);
+  {
+    std::shared_lock<std::shared_mutex> lock(lines_mutex_);
+    for (const auto& line : lines_) {
+      if (line->GetChannel() != channel) continue;
+      if (line->GetDirection() != direction) {
+        return JOutcome<RemoteLine*>{
+            "Channel " + channel + " is open in the other direction", nullptr};
+      }
+      return JOutcome<RemoteLine*>{"Ok", line.get()};
+    }
+  }
+
+  Message request{Op::OPEN, 0, -1, static_cast<int>(direction), 0, {}};
+  request.SetText(channel);
+  auto reply = Request(request);
+  if (reply.second < 0) return JOutcome<RemoteLine*>{reply.first, nullptr};
+
+  std::unique_lock<std::shared_mutex> lock(lines_mutex_);
+  lines_.emplace_back(new RemoteLine(this, channel, direction, reply.second));
+  return JOutcome<RemoteLine*>{"Ok", lines_.back().get()};
+}
+
+void BrokerClient::Close(const std::string& channel) {
+  std::unique_ptr<RemoteLine> line;
+  {
+    // waits for edges being dispatched to the line
+    std::unique_lock<std::shared_mutex> lock(lines_mutex_);
+    for (auto it = lines_.begin(); it != lines_.end(); ++it) {
+      if ((*it)->GetChannel() == channel) {
+        line = std::move(*it);
+        lines_.erase(it);
+        break;
+      }
+    }
+  }
+
+  if (line) Send(Message{Op::CLOSE, 0, line->handle_, 0, 0, {}});
+}
+
+uint64_t BrokerClient::GetDroppedEvents() const {
+  return slot_->dropped_events.load();
+}
+
+void BrokerClient::Send(Message request) {
+  std::lock_guard<std::mutex> lock(request_mutex_);
+  Push(request);
+}
+
+void BrokerClient::Push(const Message& request) {
+  // the broker drains the ring unless it is gone
+  while (!slot_->requests.Push(request)) {
+    if (segment_->broker_pid.load() <= 0) return;
+    segment_->broker_bell.Ring();
+    std::this_thread::yield();
+  }
+  segment_->broker_bell.Ring();
+}
+
+JOutcome<int> BrokerClient::Request(Message request) {
+  std::lock_guard<std::mutex> lock(request_mutex_);
+  request.seq = next_seq_++;
+  if (request.seq == 0) request.seq = next_seq_++;  // 0 is never replied
+
+  auto deadline = MonotonicNs() + kReply_Timeout_Ns;
+  while (!slot_->requests.Push(request)) {
+    if (MonotonicNs() > deadline) {
+      return JOutcome<int>{"Broker not responding", -1};
+    }
+    segment_->broker_bell.Ring();
+    std::this_thread::yield();
+  }
+  segment_->broker_bell.Ring();
+
+  while (true) {
+    auto seen = slot_->reply_bell.rings.load();
+    if (slot_->reply_seq.load(std::memory_order_acquire) == request.seq) break;
+    if (segment_->broker_pid.load() <= 0) {
+      return JOutcome<int>{"Broker not responding", -1};
+    }
+    if (MonotonicNs() > deadline) {
+      // A line the broker opens after all is closed again, by channel since
+      // its handle is never seen. Requests are served in order.
+      if (request.op == Op::OPEN) {
+        Message close{Op::CLOSE, 0, -1, 0, 0, {}};
+        std::memcpy(close.text, request.text, sizeof(close.text));
+        Push(close);
+      }
+      return JOutcome<int>{"Broker not responding", -1};
+    }
+    slot_->reply_bell.Wait(seen, kReply_Timeout_Ns / 10);
+  }
+
+  const auto& reply = slot_->reply;
+  std::string text(reply.text, strnlen(reply.text, sizeof(reply.text)));
+  return JOutcome<int>{reply.value < 0 ? text : "Ok", reply.value};
+}
+
+void BrokerClient::RunEvents() {
+  Message event;
+  while (!stop_) {
+    auto seen = slot_->event_bell.rings.load();
+
+    bool any = false;
+    while (slot_->events.Pop(event)) {
+      any = true;
+      std::shared_lock<std::shared_mutex> lock(lines_mutex_);
+      for (const auto& line : lines_) {
+        if (line->handle_ == event.handle) line->Dispatch(event.value);
+      }
+    }
+
+    if (!any) slot_->event_bell.Wait(seen, kReply_Timeout_Ns / 10);
+  }
+}
+
+}  // namespace jetson
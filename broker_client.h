@@ -0,0 +1,179 @@
+/**
+ * @file broker_client.h
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+#include "broker.h"
+#include "broker_shm.h"
+#include "inplace_function.h"
+#include "types.h"
+
+namespace jetson {
+
+class BrokerClient;
+
+/**
+ * @brief A binary line served by a GpioBroker, with the calls of
+ * BinaryController that make sense across processes. Writes are queued to the
+ * broker without waiting; reads wait for its reply.
+ */
+class RemoteLine {
+ public:
+  using TriggerCallBack = InplaceFunction<void(int)>;
+
+ public:
+  /**
+   * @brief Output a signal. Only the client owning an output can write it.
+   *
+   * @param signal high or low
+   */
+  void Write2(Signal signal);
+
+  /**
+   * @brief Read the line through the broker.
+   *
+   * @return high or low, unknown if the broker did not answer.
+   */
+  Signal Read2();
+
+  /**
+   * @brief Register a callback for edges of an input. Callbacks run on the
+   * event thread of the client.
+   *
+   * @param edge the event for which call back is triggered.
+   * @param callback the callback.
+   * @return The result of the registration.
+   */
+  JResult RegisterCallback(TriggerEdge edge, TriggerCallBack callback);
+
+  /**
+   * @brief Get the channel name
+   */
+  std::string GetChannel() const;
+
+  /**
+   * @brief Get the direction
+   */
+  Direction GetDirection() const;
+
+ private:
+  RemoteLine(BrokerClient* client, std::string channel, Direction direction,
+             int handle);
+  RemoteLine(const RemoteLine&) = delete;
+  RemoteLine(RemoteLine&&) = delete;
+
+  void Dispatch(int value);
+
+  friend class BrokerClient;
+
+ private:
+  BrokerClient* const client_;
+  const std::string channel_;
+  const Direction direction_;
+  const int handle_;
+
+  std::mutex callbacks_mutex_;
+  std::vector<std::pair<TriggerEdge, TriggerCallBack>> callbacks_;
+  bool subscribed_ = false;
+};
+
+/**
+ * @brief Connection of a process to a GpioBroker. Throws if no broker serves
+ * under the name or all its client slots are taken. Lines opened through the
+ * client are released by the broker when the client is destroyed or its
+ * process exits.
+ */
+class BrokerClient {
+ public:
+  explicit BrokerClient(const std::string& name = kBroker_Name);
+  ~BrokerClient();
+
+  /**
+   * @brief Open a line through the broker. Opening a line already open
+   * returns it.
+   *
+   * @param channel The channel, named as in the board mode of the broker.
+   * @param direction Output lines are owned by one client at a time.
+   * @return The line on success.
+   */
+  JOutcome<RemoteLine*> Open(const std::string& channel, Direction direction);
+
+  /**
+   * @brief Close a line. No effect if it was not opened.
+   *
+   * @param channel the name of the channel.
+   */
+  void Close(const std::string& channel);
+
+  /**
+   * @brief Get how many edges the broker dropped because the event ring of
+   * this client was full.
+   */
+  uint64_t GetDroppedEvents() const;
+
+ private:
+  BrokerClient(const BrokerClient&) = delete;
+  BrokerClient(BrokerClient&&) = delete;
+
+ private:
+  void Send(broker::Message request);
+  void Push(const broker::Message& request);  // with request_mutex_ held
+  JOutcome<int> Request(broker::Message request);
+  void RunEvents();
+
+  friend class RemoteLine;
+
+ private:
+  int fd_ = -1;
+  broker::Segment* segment_ = nullptr;
+  broker::Slot* slot_ = nullptr;
+
+  std::mutex open_mutex_;     // one line per channel
+  std::mutex request_mutex_;  // one producer, one request in flight
+  uint32_t next_seq_ = 1;
+
+  mutable std::shared_mutex lines_mutex_;
+  std::list<std::unique_ptr<RemoteLine>> lines_;
+
+  std::once_flag events_started_;
+  std::future<void> events_thread_;
+  std::atomic<bool> stop_{false};
+};
+
+}  // namespace jetson
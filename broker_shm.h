@@ -0,0 +1,181 @@
+/**
+ * @file broker_shm.h
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include "types.h"
+
+namespace jetson {
+
+/**
+ * @brief Layout of the shared memory segment between a GpioBroker and its
+ * clients. Only used by broker.cpp and broker_client.cpp.
+ */
+namespace broker {
+
+static constexpr uint32_t kMagic = 0x4a47504f;  // "JGPO"
+static constexpr uint32_t kVersion = 1;
+static constexpr int kMax_Clients = 16;
+static constexpr uint32_t kRequest_Ring = 256;
+static constexpr uint32_t kEvent_Ring = 1024;
+
+enum class Op : uint32_t {
+  OPEN = 1,   // text: channel, value: direction. Replied with the handle.
+  CLOSE,      // handle, or text: channel if the handle is < 0
+  WRITE,      // handle, value: level. Not replied.
+  READ,       // handle. Replied with the level.
+  SUBSCRIBE,  // handle. Replied.
+  EDGE,       // broker to client: handle, value, timestamp_ns
+  REPLY,      // broker to client: value, text: error if value < 0
+};
+
+struct Message {
+  Op op;
+  uint32_t seq;
+  int32_t handle;
+  int32_t value;
+  int64_t timestamp_ns;
+  char text[48];
+
+  void SetText(const std::string& s) {
+    auto length = std::min(s.size(), sizeof(text) - 1);
+    std::memcpy(text, s.data(), length);
+    text[length] = '\0';
+  }
+};
+
+/**
+ * @brief Wakes a single consumer waiting for work of any number of
+ * producers. The futex is only woken while the consumer sleeps.
+ */
+struct Doorbell {
+  std::atomic<uint32_t> rings{0};
+  std::atomic<uint32_t> sleeping{0};
+
+  void Ring() {
+    rings.fetch_add(1);
+    if (sleeping.load()) {
+      syscall(SYS_futex, &rings, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+    }
+  }
+
+  // Sleep unless rung since `seen` was loaded from rings.
+  void Wait(uint32_t seen, int64_t timeout_ns) {
+    struct timespec timeout;
+    timeout.tv_sec = timeout_ns / 1000000000;
+    timeout.tv_nsec = timeout_ns % 1000000000;
+    sleeping.store(1);
+    if (rings.load() == seen) {
+      syscall(SYS_futex, &rings, FUTEX_WAIT, seen, &timeout, nullptr, 0);
+    }
+    sleeping.store(0);
+  }
+};
+
+// Single producer, single consumer ring of messages.
+template <uint32_t N>
+struct Ring {
+  std::atomic<uint32_t> head{0};  // next to consume
+  std::atomic<uint32_t> tail{0};  // next to produce
+  Message messages[N];
+
+  bool Push(const Message& message) {
+    auto tail_now = tail.load(std::memory_order_relaxed);
+    if (tail_now - head.load(std::memory_order_acquire) == N) return false;
+    messages[tail_now % N] = message;
+    tail.store(tail_now + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool Pop(Message& message) {
+    auto head_now = head.load(std::memory_order_relaxed);
+    if (head_now == tail.load(std::memory_order_acquire)) return false;
+    message = messages[head_now % N];
+    head.store(head_now + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool Empty() const {
+    return head.load(std::memory_order_acquire) ==
+           tail.load(std::memory_order_acquire);
+  }
+
+  void Reset() {
+    head.store(0);
+    tail.store(0);
+  }
+};
+
+enum SlotState : uint32_t {
+  FREE = 0,
+  CLAIMED,    // a client is setting the slot up
+  CONNECTED,
+  CLOSING,    // the broker releases the lines of the client
+};
+
+struct Slot {
+  std::atomic<uint32_t> state{FREE};
+  std::atomic<int32_t> pid{0};  // claims the slot before the state, 0 if free
+
+  Ring<kRequest_Ring> requests;  // client to broker
+
+  // One request in flight per client. The broker stores reply_seq after the
+  // reply.
+  Message reply;
+  std::atomic<uint32_t> reply_seq{0};
+  Doorbell reply_bell;
+
+  Ring<kEvent_Ring> events;  // broker to client
+  Doorbell event_bell;
+  std::atomic<uint64_t> dropped_events{0};
+};
+
+struct Segment {
+  uint32_t magic;
+  uint32_t version;
+  std::atomic<int32_t> broker_pid{0};
+  Doorbell broker_bell;  // rung by clients for requests and disconnects
+  Slot slots[kMax_Clients];
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "shared memory atomics must be lock free");
+
+}  // namespace broker
+}  // namespace jetson
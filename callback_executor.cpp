@@ -0,0 +1,304 @@
+/**
+ * @file callback_executor.cpp
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "callback_executor.h"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include "realtime.h"
+
+namespace jetson {
+
+// Edges handled by one drain task before it yields its worker to others.
+static const int kDrain_Batch = 16;
+
+// Smallest task ring of a worker.
+static const std::size_t kMin_Ring = 16;
+
+CallbackPool::~CallbackPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    stop_ = true;
+  }
+  wakeup_.notify_all();
+
+  for (auto& t : threads_) t.join();
+}
+
+void CallbackPool::SetThreads(int threads) {
+  std::lock_guard<std::mutex> lock(config_mutex_);
+  if (!config_fixed_) thread_count_ = threads;
+}
+
+bool CallbackPool::SetRealtimeConfig(RealtimeConfig config) {
+  std::lock_guard<std::mutex> lock(config_mutex_);
+  if (config_fixed_) return false;
+  realtime_ = std::move(config);
+  return true;
+}
+
+void CallbackPool::Reserve(std::size_t tasks) {
+  std::call_once(started_, &CallbackPool::Start, this);
+
+  // Round robin may well queue all pending tasks to the same worker.
+  auto capacity = reserved_.fetch_add(tasks) + tasks;
+  for (auto& worker : workers_) {
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    if (worker->ring.size() < capacity) worker->Grow(capacity);
+  }
+}
+
+void CallbackPool::Submit(Task task) {
+  std::call_once(started_, &CallbackPool::Start, this);
+
+  auto index = next_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+  {
+    auto& worker = *workers_[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    // only when more tasks are pending than reserved for
+    if (worker.size == worker.ring.size()) worker.Grow(2 * worker.size);
+    worker.ring[(worker.head + worker.size) % worker.ring.size()] =
+        std::move(task);
+    worker.size++;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    queued_.fetch_add(1, std::memory_order_relaxed);
+  }
+  wakeup_.notify_one();
+}
+
+void CallbackPool::Worker::Grow(std::size_t capacity) {
+  std::vector<Task> grown(std::max<std::size_t>(capacity, kMin_Ring));
+  for (std::size_t i = 0; i < size; i++) {
+    grown[i] = std::move(ring[(head + i) % ring.size()]);
+  }
+  ring.swap(grown);
+  head = 0;
+}
+
+void CallbackPool::Start() {
+  {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    config_fixed_ = true;
+  }
+
+  int threads = thread_count_ > 0
+                    ? thread_count_
+                    : std::max(1u, std::thread::hardware_concurrency());
+
+  for (int i = 0; i < threads; i++) {
+    workers_.emplace_back(std::make_unique<Worker>());
+    workers_.back()->Grow(reserved_.load());
+  }
+
+  for (int i = 0; i < threads; i++) {
+    threads_.emplace_back(&CallbackPool::Run, this, i);
+  }
+}
+
+bool CallbackPool::Pop(std::size_t index, Task& task) {
+  // own tasks first, oldest first
+  {
+    auto& own = *workers_[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (own.size > 0) {
+      task = std::move(own.ring[own.head]);
+      own.ring[own.head] = nullptr;
+      own.head = (own.head + 1) % own.ring.size();
+      own.size--;
+      return true;
+    }
+  }
+
+  // then steal the newest task of another worker
+  for (std::size_t i = 1; i < workers_.size(); i++) {
+    auto& other = *workers_[(index + i) % workers_.size()];
+    std::lock_guard<std::mutex> lock(other.mutex);
+    if (other.size > 0) {
+      auto back = (other.head + other.size - 1) % other.ring.size();
+      task = std::move(other.ring[back]);
+      other.ring[back] = nullptr;
+      other.size--;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void CallbackPool::Run(std::size_t index) {
+  (void)ApplyRealtimeConfig(realtime_);  // checked when it was set
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(sleep_mutex_);
+      wakeup_.wait(lock, [&] { return stop_ || queued_.load() > 0; });
+      if (stop_) return;
+    }
+
+    Task task;
+    if (Pop(index, task)) {
+      queued_.fetch_sub(1, std::memory_order_relaxed);
+      task();
+    } else {
+      // another worker took it between wake up and pop
+      std::this_thread::yield();
+    }
+  }
+}
+
+CallbackQueue::CallbackQueue(TriggerEdge edge, Callback callback,
+                             CallbackOptions options, CallbackPool* pool,
+                             LineMetrics* metrics)
+    : edge_(edge),
+      callback_(std::move(callback)),
+      options_(std::move(options)),
+      pool_(pool),
+      metrics_(metrics),
+      ring_(std::max<std::size_t>(1, options_.queue_capacity)) {
+  if (options_.mode == CallbackMode::POOL && pool_ == nullptr) {
+    throw std::invalid_argument("no worker pool for pool callbacks.");
+  }
+
+  if (options_.mode == CallbackMode::EXECUTOR && !options_.executor) {
+    throw std::invalid_argument("no executor for executor callbacks.");
+  }
+
+  // A queue has at most one drain task pending.
+  if (options_.mode == CallbackMode::POOL) pool_->Reserve(1);
+}
+
+void CallbackQueue::Push(int value, int64_t timestamp_ns) {
+  if (options_.mode == CallbackMode::INLINE) {
+    if (metrics_ && timestamp_ns > 0) {
+      metrics_->callback_latency.Record(MonotonicNs() - timestamp_ns);
+    }
+    callback_(value);
+    executed_.fetch_add(1, std::memory_order_relaxed);
+    if (metrics_) metrics_->callbacks.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  bool schedule = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closed_) return;
+
+    if (size_ > 0 && options_.overflow == OverflowPolicy::COALESCE) {
+      ring_[(head_ + size_ - 1) % ring_.size()].value = value;
+      coalesced_.fetch_add(1, std::memory_order_relaxed);
+      if (metrics_) metrics_->coalesced.fetch_add(1, std::memory_order_relaxed);
+    } else if (size_ == ring_.size()) {
+      if (options_.overflow == OverflowPolicy::DROP_NEWEST) {
+        dropped_newest_.fetch_add(1, std::memory_order_relaxed);
+      } else {
+        ring_[head_] = Edge{value, timestamp_ns};
+        head_ = (head_ + 1) % ring_.size();
+        dropped_oldest_.fetch_add(1, std::memory_order_relaxed);
+      }
+      if (metrics_) metrics_->dropped.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      ring_[(head_ + size_) % ring_.size()] = Edge{value, timestamp_ns};
+      size_++;
+    }
+
+    schedule = !scheduled_;
+    scheduled_ = true;
+  }
+
+  if (schedule) Schedule();
+}
+
+void CallbackQueue::Schedule() {
+  auto self = shared_from_this();
+  auto task = [self] { self->Drain(); };
+  if (options_.mode == CallbackMode::POOL) {
+    pool_->Submit(std::move(task));
+  } else {
+    options_.executor(std::move(task));
+  }
+}
+
+void CallbackQueue::Drain() {
+  for (int i = 0; i < kDrain_Batch; i++) {
+    Edge edge{0, 0};
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (closed_ || size_ == 0) {
+        scheduled_ = false;
+        return;
+      }
+
+      edge = ring_[head_];
+      head_ = (head_ + 1) % ring_.size();
+      size_--;
+      running_ = true;
+    }
+
+    if (metrics_ && edge.timestamp_ns > 0) {
+      metrics_->callback_latency.Record(MonotonicNs() - edge.timestamp_ns);
+    }
+    callback_(edge.value);
+    executed_.fetch_add(1, std::memory_order_relaxed);
+    if (metrics_) metrics_->callbacks.fetch_add(1, std::memory_order_relaxed);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      running_ = false;
+    }
+    idle_.notify_all();
+  }
+
+  // More pending. Queue up again so other callbacks get their turn.
+  Schedule();
+}
+
+void CallbackQueue::Close() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  closed_ = true;
+  idle_.wait(lock, [&] { return !running_; });
+}
+
+CallbackStats CallbackQueue::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return CallbackStats{edge_,
+                       options_.mode,
+                       executed_.load(),
+                       dropped_oldest_.load(),
+                       dropped_newest_.load(),
+                       coalesced_.load(),
+                       size_};
+}
+
+TriggerEdge CallbackQueue::GetEdge() const { return edge_; }
+
+}  // namespace jetson
@@ -0,0 +1,204 @@
+/**
+ * @file callback_executor.h
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "inplace_function.h"
+#include "metrics.h"
+#include "types.h"
+
+namespace jetson {
+
+using Task = InplaceFunction<void()>;
+using Executor = std::function<void(Task)>;
+
+struct CallbackOptions {
+  CallbackMode mode = CallbackMode::INLINE;
+  Executor executor;  // only used with CallbackMode::EXECUTOR
+  std::size_t queue_capacity = 64;
+  OverflowPolicy overflow = OverflowPolicy::DROP_OLDEST;
+};
+
+struct CallbackStats {
+  TriggerEdge edge;
+  CallbackMode mode;
+  uint64_t executed;
+  uint64_t dropped_oldest;
+  uint64_t dropped_newest;
+  uint64_t coalesced;
+  std::size_t pending;
+};
+
+/**
+ * @brief A worker pool with one task ring per worker. Tasks are spread over
+ * the rings round robin, and an idle worker steals from the back of the
+ * others. Threads are only started by the first reservation or task.
+ */
+class CallbackPool {
+ public:
+  CallbackPool() = default;
+  ~CallbackPool();
+
+  /**
+   * @brief Set the number of worker threads. Only effective before the first
+   * task is submitted.
+   *
+   * @param threads number of threads, 0 means one per core.
+   */
+  void SetThreads(int threads);
+
+  /**
+   * @brief Set how the worker threads run. Only possible before they are
+   * started.
+   *
+   * @param config the config, see CheckRealtimeConfig().
+   * @return false if the workers run already.
+   */
+  bool SetRealtimeConfig(RealtimeConfig config);
+
+  /**
+   * @brief Make room for more tasks pending at the same time, so that
+   * submitting them never allocates. Starts the workers.
+   *
+   * @param tasks number of additional tasks.
+   */
+  void Reserve(std::size_t tasks);
+
+  /**
+   * @brief Queue a task to run on one of the workers.
+   *
+   * @param task the task.
+   */
+  void Submit(Task task);
+
+ private:
+  CallbackPool(const CallbackPool&) = delete;
+  CallbackPool(CallbackPool&&) = delete;
+
+ private:
+  struct Worker {
+    std::mutex mutex;
+    std::vector<Task> ring;
+    std::size_t head = 0;
+    std::size_t size = 0;
+
+    void Grow(std::size_t capacity);
+  };
+
+  void Start();
+  void Run(std::size_t index);
+  bool Pop(std::size_t index, Task& task);
+
+ private:
+  std::mutex config_mutex_;
+  int thread_count_ = 0;       // fixed once config_fixed_
+  RealtimeConfig realtime_;    // fixed once config_fixed_
+  bool config_fixed_ = false;  // set by Start()
+  std::once_flag started_;
+  std::atomic<std::size_t> reserved_{0};
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread> threads_;
+  std::atomic<std::size_t> next_{0};
+  std::atomic<int> queued_{0};
+  std::mutex sleep_mutex_;
+  std::condition_variable wakeup_;
+  bool stop_ = false;
+};
+
+/**
+ * @brief Bounded queue of edges pending for one registered callback. The
+ * queue is drained by at most one task at a time, which keeps the edges of a
+ * callback in order.
+ */
+class CallbackQueue : public std::enable_shared_from_this<CallbackQueue> {
+ public:
+  using Callback = InplaceFunction<void(int)>;
+
+  CallbackQueue(TriggerEdge edge, Callback callback, CallbackOptions options,
+                CallbackPool* pool, LineMetrics* metrics = nullptr);
+
+  /**
+   * @brief Deliver an edge, either inline or through the queue.
+   *
+   * @param value the value of the line after the edge.
+   * @param timestamp_ns when the edge was seen, 0 if unknown. Used for the
+   * latency metrics only.
+   */
+  void Push(int value, int64_t timestamp_ns = 0);
+
+  /**
+   * @brief Stop delivering and wait for a running callback to return.
+   */
+  void Close();
+
+  CallbackStats GetStats() const;
+
+  TriggerEdge GetEdge() const;
+
+ private:
+  void Schedule();
+  void Drain();
+
+ private:
+  const TriggerEdge edge_;
+  const Callback callback_;
+  const CallbackOptions options_;
+  CallbackPool* const pool_;
+  LineMetrics* const metrics_;
+
+  struct Edge {
+    int value;
+    int64_t timestamp_ns;
+  };
+
+  mutable std::mutex mutex_;
+  std::condition_variable idle_;
+  std::vector<Edge> ring_;
+  std::size_t head_ = 0;
+  std::size_t size_ = 0;
+  bool scheduled_ = false;
+  bool running_ = false;
+  bool closed_ = false;
+
+  std::atomic<uint64_t> executed_{0};
+  std::atomic<uint64_t> dropped_oldest_{0};
+  std::atomic<uint64_t> dropped_newest_{0};
+  std::atomic<uint64_t> coalesced_{0};
+};
+
+}  // namespace jetson
@@ -0,0 +1 @@
+g++ -O3 -std=c++17 gpio_broker.cpp sim_board.cpp state_publisher.cpp broker.cpp binary_gpio.cpp broker_client.cpp callback_executor.cpp edge_monitor.cpp edge_recorder.cpp flight_recorder.cpp gpio.cpp gpio_chips.cpp input_capture.cpp io_uring.cpp quadrature_decoder.cpp metrics_exporter.cpp realtime.cpp trace.cpp value_batch.cpp pwm.cpp pwm_group.cpp scan_cycle.cpp write_scheduler.cpp -lstdc++fs -lpthread -lrt -o gpio_broker
\ No newline at end of file
@@ -0,0 +1 @@
+g++ -O3 -std=c++17 flight_decode.cpp flight_recorder.cpp -lpthread -o flight_decode
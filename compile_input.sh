@@ -1 +1 @@
-g++ -DDEBUG=on -O3 -std=c++17 simple_input.cpp binary_gpio.cpp gpio.cpp pwm.cpp -lstdc++fs -lpthread -o simple_input
\ No newline at end of file
+g++ -DDEBUG=on -O3 -std=c++17 simple_input.cpp binary_gpio.cpp broker.cpp broker_client.cpp callback_executor.cpp edge_monitor.cpp edge_recorder.cpp flight_recorder.cpp gpio.cpp gpio_chips.cpp input_capture.cpp io_uring.cpp quadrature_decoder.cpp metrics_exporter.cpp realtime.cpp trace.cpp value_batch.cpp state_publisher.cpp pwm.cpp pwm_group.cpp scan_cycle.cpp write_scheduler.cpp -lstdc++fs -lpthread -lrt -o simple_input
\ No newline at end of file
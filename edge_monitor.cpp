@@ -0,0 +1,489 @@
+/**
+ * @file edge_monitor.cpp
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "edge_monitor.h"
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include "binary_gpio.h"
+#include "realtime.h"
+#include "trace.h"
+
+namespace jetson {
+
+// Size of the buffer inotify events are read into.
+static const std::size_t kEvent_Buffer_Len = 4096;
+
+// Writes a delayed reflex may have pending, for inputs toggling faster than
+// the delay.
+static const std::size_t kDelayed_Per_Reflex = 16;
+
+EdgeMonitor::EdgeMonitor() {
+  inotify_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  wakeup_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  kick_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (inotify_ < 0 || wakeup_ < 0 || kick_ < 0) {
+    throw std::runtime_error("create edge monitor failed.");
+  }
+
+  // as many edges as one read can return
+  events_.reserve(kEvent_Buffer_Len / sizeof(struct inotify_event));
+}
+
+EdgeMonitor::~EdgeMonitor() {
+  if (thread_.valid()) {
+    uint64_t one = 1;
+    if (write(wakeup_, &one, sizeof(one)) == sizeof(one)) thread_.get();
+  }
+
+  if (loop_ >= 0) close(loop_);
+  if (timer_ >= 0) close(timer_);
+  close(kick_);
+  close(wakeup_);
+  close(inotify_);
+}
+
+void EdgeMonitor::Add(BinaryController* line, const std::string& value_file,
+                      int gpio) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& l : lines_) {
+      if (l.second.controller == line) return;
+    }
+
+    int watch = inotify_add_watch(inotify_, value_file.c_str(), IN_MODIFY);
+    if (watch < 0) {
+      throw std::runtime_error("watch " + value_file + " failed.");
+    }
+    lines_[watch] = Line{line, gpio, 0, 0};
+    IndexReflexes();
+  }
+
+  std::call_once(started_, &EdgeMonitor::Start, this);
+}
+
+void EdgeMonitor::Remove(BinaryController* line) {
+  Remove(std::vector<BinaryController*>{line});
+}
+
+void EdgeMonitor::Remove(const std::vector<BinaryController*>& lines) {
+  std::vector<BinaryController*> removed(lines);
+  std::sort(removed.begin(), removed.end());
+  auto is_removed = [&](BinaryController* line) {
+    return std::binary_search(removed.begin(), removed.end(), line);
+  };
+
+  // Taking the lock waits for a dispatch in progress.
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<int> gpios;
+  for (auto it = lines_.begin(); it != lines_.end();) {
+    if (is_removed(it->second.controller)) {
+      gpios.push_back(it->second.gpio);
+      inotify_rm_watch(inotify_, it->first);
+      it = lines_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  std::sort(gpios.begin(), gpios.end());
+
+  // a line may be the output of reflexes, even if it is not watched
+  reflexes_.erase(
+      std::remove_if(reflexes_.begin(), reflexes_.end(),
+                     [&](const Reflex& reflex) {
+                       return is_removed(reflex.output) ||
+                              std::binary_search(gpios.begin(), gpios.end(),
+                                                 reflex.gpio);
+                     }),
+      reflexes_.end());
+  delayed_.erase(std::remove_if(delayed_.begin(), delayed_.end(),
+                                [&](const DelayedWrite& write) {
+                                  return is_removed(write.output);
+                                }),
+                 delayed_.end());
+  IndexReflexes();
+}
+
+int EdgeMonitor::Subscribe(std::vector<int> gpios, BatchCallBack callback,
+                           BatchOptions options) {
+  int id = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    options.max_batch = std::max<std::size_t>(1, options.max_batch);
+
+    Subscriber subscriber{std::move(gpios), std::move(callback), options, {}};
+    // Less than a batch is left over from a read, and one read adds at most
+    // as many edges as fit into the event buffer.
+    subscriber.pending.reserve(options.max_batch + events_.capacity());
+    id = next_subscriber_++;
+    subscribers_.emplace(id, std::move(subscriber));
+  }
+
+  std::call_once(started_, &EdgeMonitor::Start, this);
+  return id;
+}
+
+void EdgeMonitor::Unsubscribe(int id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  subscribers_.erase(id);
+}
+
+void EdgeMonitor::SetReflexes(std::vector<Reflex> reflexes) {
+  std::stable_sort(reflexes.begin(), reflexes.end(),
+                   [](const Reflex& a, const Reflex& b) {
+                     return a.gpio < b.gpio;
+                   });
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  reflexes_ = std::move(reflexes);
+
+  // Sized here, the event path never grows it. Writes still pending stay.
+  std::size_t delayed = 0;
+  for (const auto& reflex : reflexes_) delayed += reflex.delay_ns > 0;
+  max_delayed_ = std::max(delayed * kDelayed_Per_Reflex, delayed_.size());
+  delayed_.reserve(max_delayed_);
+  IndexReflexes();
+}
+
+ReflexStats EdgeMonitor::GetReflexStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return reflex_stats_;
+}
+
+uint64_t EdgeMonitor::GetOverflows() const { return overflows_.load(); }
+
+bool EdgeMonitor::SetRealtimeConfig(RealtimeConfig config) {
+  std::lock_guard<std::mutex> lock(realtime_mutex_);
+  if (realtime_fixed_) return false;
+  realtime_ = std::move(config);
+  return true;
+}
+
+JResult EdgeMonitor::UseExternalLoop(const std::vector<int>& fds) {
+  if (thread_.valid()) return JResult{"Edge monitor already started", false};
+  if (loop_ >= 0) return JResult{"Already on an external loop", false};
+
+  timer_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  loop_ = epoll_create1(EPOLL_CLOEXEC);
+  bool added = timer_ >= 0 && loop_ >= 0;
+
+  std::vector<int> aggregated{kick_, timer_};
+  aggregated.insert(aggregated.end(), fds.begin(), fds.end());
+  for (int fd : aggregated) {
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    added = added && epoll_ctl(loop_, EPOLL_CTL_ADD, fd, &event) == 0;
+  }
+
+  if (!added) {
+    if (loop_ >= 0) close(loop_);
+    if (timer_ >= 0) close(timer_);
+    loop_ = timer_ = -1;
+    return JResult{"create loop fd failed", false};
+  }
+  return JResult{"Ok", true};
+}
+
+int EdgeMonitor::GetEdgeFd() const { return inotify_; }
+
+int EdgeMonitor::GetLoopFd() const { return loop_; }
+
+int EdgeMonitor::Dispatch(int max_events) {
+  uint64_t count = 0;
+  (void)read(kick_, &count, sizeof(count));
+  (void)read(timer_, &count, sizeof(count));
+
+  // Each edge is a bare event of the watched file, so the size of the read
+  // bounds the number of edges.
+  alignas(struct inotify_event) char buffer[kEvent_Buffer_Len];
+  auto size = std::min(sizeof(buffer),
+                       std::max(1, max_events) * sizeof(struct inotify_event));
+  auto length = read(inotify_, buffer, size);
+  auto now = MonotonicNs();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  int edges = 0;
+  if (length > 0) {
+    Process(buffer, length, now);
+    edges = static_cast<int>(events_.size());
+  }
+  Expire(MonotonicNs());
+
+  // a zero time disarms the timer, any time in the past fires at once
+  auto deadline = NextDeadline();
+  struct itimerspec spec = {};
+  spec.it_value.tv_sec = deadline / 1000000000;
+  spec.it_value.tv_nsec = deadline % 1000000000;
+  timerfd_settime(timer_, TFD_TIMER_ABSTIME, &spec, nullptr);
+  return edges;
+}
+
+void EdgeMonitor::Start() {
+  {
+    std::lock_guard<std::mutex> lock(realtime_mutex_);
+    realtime_fixed_ = true;
+  }
+  if (loop_ >= 0) return;  // the caller's loop dispatches
+  thread_ = std::async(std::launch::async, &EdgeMonitor::Run, this);
+}
+
+void EdgeMonitor::Run() {
+  (void)ApplyRealtimeConfig(realtime_);  // checked when it was set
+
+  alignas(struct inotify_event) char buffer[kEvent_Buffer_Len];
+  struct pollfd fds[3] = {
+      {inotify_, POLLIN, 0}, {wakeup_, POLLIN, 0}, {kick_, POLLIN, 0}};
+
+  while (true) {
+    struct timespec timeout;
+    struct timespec* timeout_ptr = nullptr;
+    int64_t deadline = 0;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      deadline = NextDeadline();
+    }
+    if (deadline > 0) {
+      int64_t wait = std::max<int64_t>(0, deadline - MonotonicNs());
+      timeout.tv_sec = wait / 1000000000;
+      timeout.tv_nsec = wait % 1000000000;
+      timeout_ptr = &timeout;
+    }
+
+    if (ppoll(fds, 3, timeout_ptr, nullptr) < 0) continue;
+    if (fds[1].revents & POLLIN) break;
+    if (fds[2].revents & POLLIN) {
+      uint64_t kicks = 0;
+      (void)read(kick_, &kicks, sizeof(kicks));
+    }
+
+    if (fds[0].revents & POLLIN) {
+      auto length = read(inotify_, buffer, sizeof(buffer));
+      auto now = MonotonicNs();
+      if (length > 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Process(buffer, length, now);
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Expire(MonotonicNs());
+  }
+}
+
+void EdgeMonitor::Expire(int64_t now) {
+  // delayed reflexes and spans whose latency bound expired
+  WriteDelayed(now);
+  for (auto& s : subscribers_) {
+    auto& subscriber = s.second;
+    if (!subscriber.pending.empty() &&
+        subscriber.pending.front().timestamp_ns +
+                subscriber.options.max_latency.count() <=
+            now) {
+      Flush(subscriber, true);
+    }
+  }
+}
+
+void EdgeMonitor::Process(const char* buffer, std::size_t length,
+                          int64_t now) {
+  constexpr std::size_t kEvent_Size = sizeof(struct inotify_event);
+
+  events_.clear();
+  std::size_t i = 0;
+  while (i < length) {
+    auto event = reinterpret_cast<const struct inotify_event*>(&buffer[i]);
+    i += kEvent_Size + event->len;
+
+    if (event->mask & IN_Q_OVERFLOW) {
+      overflows_.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+
+    if (!(event->mask & IN_MODIFY)) continue;
+
+    auto line = lines_.find(event->wd);
+    if (line == lines_.end()) continue;
+
+    auto value = line->second.controller->Read();
+    React(line->second, value, now);
+    JETSON_TRACE2(dispatch_entry, line->second.gpio, value);
+    const int64_t kTrace_Start = JETSON_TRACE_START(dispatch_return);
+    line->second.controller->Dispatch(value, now);
+    JETSON_TRACE3(dispatch_return, line->second.gpio, value,
+                  JETSON_TRACE_SINCE(kTrace_Start));
+    events_.push_back(EdgeEvent{now, line->second.gpio, value});
+  }
+
+  Fan(EdgeSpan(events_.data(), events_.size()));
+}
+
+void EdgeMonitor::Inject(EdgeSpan edges) {
+  bool pending = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = MonotonicNs();  // recorded time stamps may be long past
+    for (const auto& edge : edges) {
+      for (auto& line : lines_) {
+        if (line.second.gpio == edge.gpio) {
+          React(line.second, edge.value, now);
+          line.second.controller->Dispatch(edge.value, edge.timestamp_ns);
+        }
+      }
+    }
+
+    Fan(edges);
+    for (const auto& s : subscribers_) pending |= !s.second.pending.empty();
+    pending |= !delayed_.empty();
+  }
+
+  // the monitor thread picks up the latency bound of edges held back
+  if (pending) {
+    uint64_t one = 1;
+    (void)write(kick_, &one, sizeof(one));
+  }
+}
+
+void EdgeMonitor::Fan(EdgeSpan edges) {
+  for (auto& s : subscribers_) {
+    auto& subscriber = s.second;
+    for (const auto& event : edges) {
+      if (std::find(subscriber.gpios.begin(), subscriber.gpios.end(),
+                    event.gpio) != subscriber.gpios.end()) {
+        subscriber.pending.push_back(event);
+      }
+    }
+
+    Flush(subscriber, subscriber.options.max_latency.count() <= 0);
+  }
+}
+
+void EdgeMonitor::Flush(Subscriber& subscriber, bool all) {
+  auto& pending = subscriber.pending;
+  const auto kMax = subscriber.options.max_batch;
+
+  std::size_t begin = 0;
+  while (pending.size() - begin >= kMax ||
+         (all && pending.size() > begin)) {
+    auto count = std::min(kMax, pending.size() - begin);
+    subscriber.callback(EdgeSpan(pending.data() + begin, count));
+    begin += count;
+  }
+  pending.erase(pending.begin(), pending.begin() + begin);
+}
+
+void EdgeMonitor::React(const Line& line, int value, int64_t now) {
+  auto edge = value == 1 ? TriggerEdge::RISING : TriggerEdge::FALLING;
+  for (auto i = line.first_reflex; i < line.last_reflex; i++) {
+    const auto& reflex = reflexes_[i];
+    if (reflex.edge != TriggerEdge::BOTH && reflex.edge != edge) continue;
+
+    if (reflex.delay_ns > 0) {
+      if (delayed_.size() == max_delayed_) {
+        reflex_stats_.overflows++;
+        continue;
+      }
+      delayed_.push_back(
+          DelayedWrite{now + reflex.delay_ns, reflex.output, reflex.level});
+    } else {
+      reflex.output->Write2(reflex.level);
+      reflex_stats_.fired++;
+    }
+  }
+}
+
+namespace {
+
+// Orders reflexes by input, looked up by a bare gpio number.
+struct ByGpio {
+  bool operator()(const EdgeMonitor::Reflex& reflex, int gpio) const {
+    return reflex.gpio < gpio;
+  }
+  bool operator()(int gpio, const EdgeMonitor::Reflex& reflex) const {
+    return gpio < reflex.gpio;
+  }
+};
+
+}  // namespace
+
+void EdgeMonitor::IndexReflexes() {
+  for (auto& l : lines_) {
+    auto& line = l.second;
+    auto range = std::equal_range(reflexes_.begin(), reflexes_.end(),
+                                  line.gpio, ByGpio());
+    line.first_reflex = range.first - reflexes_.begin();
+    line.last_reflex = range.second - reflexes_.begin();
+  }
+}
+
+void EdgeMonitor::WriteDelayed(int64_t now) {
+  // in the order of the edges, for writes to the same output
+  std::size_t kept = 0;
+  for (std::size_t i = 0; i < delayed_.size(); i++) {
+    const auto write = delayed_[i];
+    if (write.due_ns > now) {
+      delayed_[kept++] = write;
+      continue;
+    }
+
+    write.output->Write2(write.level);
+    auto late = MonotonicNs() - write.due_ns;
+    reflex_stats_.fired++;
+    reflex_stats_.delayed++;
+    total_late_ns_ += late;
+    reflex_stats_.mean_late_ns = total_late_ns_ / reflex_stats_.delayed;
+    reflex_stats_.max_late_ns = std::max(reflex_stats_.max_late_ns, late);
+  }
+  delayed_.resize(kept);
+}
+
+int64_t EdgeMonitor::NextDeadline() const {
+  int64_t deadline = 0;
+  for (const auto& write : delayed_) {
+    if (deadline == 0 || write.due_ns < deadline) deadline = write.due_ns;
+  }
+  for (const auto& s : subscribers_) {
+    const auto& subscriber = s.second;
+    if (subscriber.pending.empty()) continue;
+
+    auto due = subscriber.pending.front().timestamp_ns +
+               subscriber.options.max_latency.count();
+    if (deadline == 0 || due < deadline) deadline = due;
+  }
+  return deadline;
+}
+
+}  // namespace jetson
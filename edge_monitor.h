@@ -0,0 +1,249 @@
+/**
+ * @file edge_monitor.h
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "inplace_function.h"
+#include "types.h"
+
+namespace jetson {
+
+class BinaryController;
+
+/**
+ * @brief Watches the value files of any number of lines from a single thread.
+ * All edges reported by one wake-up are time stamped together, handed to the
+ * per line callbacks and gathered into spans for batch subscribers.
+ *
+ * The thread is started by the first line or subscriber added. Callbacks run
+ * with the monitor locked: they must not add or remove lines or subscribers.
+ */
+class EdgeMonitor {
+ public:
+  using BatchCallBack = InplaceFunction<void(EdgeSpan)>;
+
+  // An output written on an edge of an input, resolved for the event path.
+  struct Reflex {
+    int gpio;  // of the input
+    TriggerEdge edge;
+    BinaryController* output;
+    Signal level;
+    int64_t delay_ns;
+  };
+
+ public:
+  EdgeMonitor();
+  ~EdgeMonitor();
+
+  /**
+   * @brief Start watching a line. No effect if it is watched already.
+   *
+   * @param line the controller edges are dispatched to.
+   * @param value_file the value file of the line.
+   * @param gpio the global gpio number of the line.
+   */
+  void Add(BinaryController* line, const std::string& value_file, int gpio);
+
+  /**
+   * @brief Stop watching a line. Once this returns, no dispatch to the line
+   * is in progress or will happen.
+   *
+   * @param line the controller.
+   */
+  void Remove(BinaryController* line);
+
+  /**
+   * @brief Stop watching many lines at once, taking the monitor's lock and
+   * rebuilding the reflex table only once.
+   *
+   * @param lines the controllers, watched or not.
+   */
+  void Remove(const std::vector<BinaryController*>& lines);
+
+  /**
+   * @brief Deliver edges of the given lines as spans.
+   *
+   * @param gpios global gpio numbers of the lines.
+   * @param callback called with the gathered edges.
+   * @param options batch size and latency bounds.
+   * @return id of the subscription.
+   */
+  int Subscribe(std::vector<int> gpios, BatchCallBack callback,
+                BatchOptions options);
+
+  /**
+   * @brief Remove a subscription. Pending edges are dropped.
+   *
+   * @param id id of the subscription.
+   */
+  void Unsubscribe(int id);
+
+  /**
+   * @brief Deliver edges as if the monitor had seen them in one wake-up: to
+   * the watched lines they belong to and to the batch subscribers. Used to
+   * replay recorded edges; the value files are not touched.
+   *
+   * @param edges edges of any lines, in order.
+   */
+  void Inject(EdgeSpan edges);
+
+  /**
+   * @brief Replace the reflex table. Reflexes run on the monitor thread as
+   * soon as the edge is read, before any callback, writing the output
+   * directly or, with a delay, from the timeout of the monitor's wait.
+   * Reflexes of a removed line, as input or output, are dropped with it.
+   * Pending delayed writes are kept in a buffer sized here, 16 per delayed
+   * reflex; further ones are dropped and counted as overflows.
+   *
+   * @param reflexes the reflexes, in any order. Inputs must be added lines.
+   */
+  void SetReflexes(std::vector<Reflex> reflexes);
+
+  /**
+   * @brief Get how many reflexes fired and how late the delayed ones were.
+   */
+  ReflexStats GetReflexStats() const;
+
+  /**
+   * @brief Get how many times the kernel event queue overflowed, i.e. edges
+   * were lost before the monitor could read them.
+   */
+  uint64_t GetOverflows() const;
+
+  /**
+   * @brief Set how the monitor thread runs. Only possible before the thread
+   * is started by the first line or subscriber.
+   *
+   * @param config the config, see CheckRealtimeConfig().
+   * @return false if the thread runs already.
+   */
+  bool SetRealtimeConfig(RealtimeConfig config);
+
+  /**
+   * @brief Leave edge detection and timers to the caller's event loop: no
+   * thread is started, edges, delayed reflexes and latency bounds are
+   * handled by Dispatch(). Only possible before the thread is started.
+   *
+   * @param fds further fds to aggregate into the loop fd, e.g. timerfds.
+   * @return The result of setting up the loop fd.
+   */
+  JResult UseExternalLoop(const std::vector<int>& fds);
+
+  /**
+   * @brief Get the fd reporting edges, to poll for readability.
+   */
+  int GetEdgeFd() const;
+
+  /**
+   * @brief Get the epoll fd aggregating the monitor's timer, its wake-ups
+   * and the fds given to UseExternalLoop(), to poll for readability. -1
+   * unless on an external loop.
+   */
+  int GetLoopFd() const;
+
+  /**
+   * @brief Handle what is pending: up to max_events edges, then delayed
+   * reflexes and latency bounds that expired. Callbacks run on the calling
+   * thread. Never blocks.
+   *
+   * @param max_events most edges to handle, at least one.
+   * @return the number of edges handled.
+   */
+  int Dispatch(int max_events);
+
+ private:
+  EdgeMonitor(const EdgeMonitor&) = delete;
+  EdgeMonitor(EdgeMonitor&&) = delete;
+
+ private:
+  struct Line {
+    BinaryController* controller;
+    int gpio;
+    std::size_t first_reflex;  // range of the line in reflexes_
+    std::size_t last_reflex;
+  };
+
+  struct DelayedWrite {
+    int64_t due_ns;
+    BinaryController* output;
+    Signal level;
+  };
+
+  struct Subscriber {
+    std::vector<int> gpios;
+    BatchCallBack callback;
+    BatchOptions options;
+    std::vector<EdgeEvent> pending;
+  };
+
+  void Start();
+  void Run();
+  void Process(const char* buffer, std::size_t length, int64_t now);
+  void Fan(EdgeSpan edges);
+  void Flush(Subscriber& subscriber, bool all);
+  void React(const Line& line, int value, int64_t now);
+  void IndexReflexes();
+  void WriteDelayed(int64_t now);
+  void Expire(int64_t now);
+  int64_t NextDeadline() const;
+
+ private:
+  int inotify_ = -1;
+  int wakeup_ = -1;
+  int kick_ = -1;  // new latency bound after an injection
+  int timer_ = -1;  // next deadline, on an external loop
+  int loop_ = -1;   // aggregates kick_, timer_ and others for an external loop
+  std::once_flag started_;
+  std::future<void> thread_;
+  std::mutex realtime_mutex_;
+  RealtimeConfig realtime_;      // fixed once realtime_fixed_
+  bool realtime_fixed_ = false;  // set by Start()
+
+  mutable std::mutex mutex_;
+  std::map<int, Line> lines_;  // by watch descriptor
+  std::map<int, Subscriber> subscribers_;
+  int next_subscriber_ = 1;  // 0 is never a valid id
+  std::vector<EdgeEvent> events_;
+  std::vector<Reflex> reflexes_;  // by input gpio
+  std::vector<DelayedWrite> delayed_;  // never beyond max_delayed_
+  std::size_t max_delayed_ = 0;
+  ReflexStats reflex_stats_;
+  int64_t total_late_ns_ = 0;
+  std::atomic<uint64_t> overflows_{0};
+};
+
+}  // namespace jetson
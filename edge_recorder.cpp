@@ -0,0 +1,222 @@
+/**
+ * @file edge_recorder.cpp
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "edge_recorder.h"
+#include <time.h>
+#include <algorithm>
+#include <cerrno>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace jetson {
+
+// First line of a recording file.
+static const char* const kRecording_Header = "# jetson gpio edge recording 1";
+
+// Spin instead of sleeping when a span is due within this time.
+static const int64_t kSpin_Ns = 50000;
+
+// Edges dispatched together at most, as many as one monitor wake-up reads.
+static const std::size_t kMax_Span = 256;
+
+JResult SaveRecording(const EdgeRecording& recording,
+                      const std::string& path) {
+  std::ofstream file(path);
+  if (!file) return JResult{"open " + path + " failed", false};
+
+  file << kRecording_Header << "\n";
+  for (const auto& channel : recording.channels) {
+    file << "channel " << channel.first << " " << channel.second << "\n";
+  }
+  for (const auto& edge : recording.edges) {
+    file << edge.timestamp_ns << " " << edge.gpio << " " << edge.value << "\n";
+  }
+
+  file.close();
+  if (!file) return JResult{"write " + path + " failed", false};
+  return JResult{"Ok", true};
+}
+
+JResult LoadRecording(const std::string& path, EdgeRecording* recording) {
+  std::ifstream file(path);
+  std::string line;
+  if (!std::getline(file, line) || line != kRecording_Header) {
+    return JResult{path + " is not an edge recording", false};
+  }
+
+  EdgeRecording loaded;
+  int number = 1;
+  while (std::getline(file, line)) {
+    number++;
+    if (line.empty()) continue;
+
+    std::istringstream fields(line);
+    if (line.compare(0, 8, "channel ") == 0) {
+      std::string keyword, channel;
+      int gpio = 0;
+      if (fields >> keyword >> gpio >> channel) {
+        loaded.channels[gpio] = channel;
+        continue;
+      }
+    } else {
+      EdgeEvent edge{};
+      if (fields >> edge.timestamp_ns >> edge.gpio >> edge.value) {
+        loaded.edges.push_back(edge);
+        continue;
+      }
+    }
+    return JResult{path + ":" + std::to_string(number) + " is malformed",
+                   false};
+  }
+
+  *recording = std::move(loaded);
+  return JResult{"Ok", true};
+}
+
+EdgeRecorder::EdgeRecorder(Gpio& gpio, const std::vector<std::string>& channels,
+                           std::size_t capacity, Pull pull)
+    : gpio_(gpio), capacity_(capacity) {
+  recording_.edges.reserve(capacity_);
+  for (const auto& channel : channels) {
+    auto input = gpio.CreateBinary(channel, Direction::IN, Signal::LOW, pull);
+    if (!input.second) throw std::runtime_error(input.first);
+    recording_.channels[gpio.GetChannelInfo(gpio.GetBoardMode(), channel)
+                            .gpio] = channel;
+  }
+
+  auto result = gpio.RegisterBatchCallback(
+      channels, [this](EdgeSpan edges) { Record(edges); });
+  if (!result.second) throw std::runtime_error(result.first);
+  subscription_ = result.second;
+}
+
+EdgeRecorder::~EdgeRecorder() { Stop(); }
+
+void EdgeRecorder::Stop() {
+  auto subscription = subscription_.exchange(0);
+  if (subscription != 0) gpio_.UnregisterBatchCallback(subscription);
+}
+
+EdgeRecording EdgeRecorder::GetRecording() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return recording_;
+}
+
+uint64_t EdgeRecorder::GetDropped() const { return dropped_.load(); }
+
+void EdgeRecorder::Record(EdgeSpan edges) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto room = capacity_ - recording_.edges.size();
+  auto count = std::min(room, edges.size());
+  recording_.edges.insert(recording_.edges.end(), edges.begin(),
+                          edges.begin() + count);
+  if (count < edges.size()) {
+    dropped_.fetch_add(edges.size() - count, std::memory_order_relaxed);
+  }
+}
+
+EdgeReplayer::EdgeReplayer(Gpio& gpio, EdgeRecording recording)
+    : gpio_(gpio), edges_(std::move(recording.edges)) {
+  std::map<int, int> gpios;  // recorded to this board
+  for (const auto& channel : recording.channels) {
+    auto info = gpio.GetChannelInfo(gpio.GetBoardMode(), channel.second);
+    gpios[channel.first] = info.gpio;
+  }
+
+  for (auto& edge : edges_) {
+    auto it = gpios.find(edge.gpio);
+    if (it != gpios.end()) edge.gpio = it->second;
+  }
+  span_.reserve(kMax_Span);
+}
+
+ReplayStats EdgeReplayer::Replay(ReplayOptions options) {
+  ReplayStats stats;
+  if (edges_.empty()) return stats;
+
+  double speed = options.timing == ReplayTiming::SCALED ? options.speed : 1;
+  bool fast = options.timing == ReplayTiming::FAST || speed <= 0;
+
+  const int64_t kStart = MonotonicNs();
+  const int64_t kFirst = edges_.front().timestamp_ns;
+  int64_t first_dispatch = 0, last_dispatch = 0;
+  int64_t late_sum = 0, dispatch_sum = 0;
+
+  std::size_t i = 0;
+  while (i < edges_.size()) {
+    const int64_t kRecorded = edges_[i].timestamp_ns;
+    int64_t now = MonotonicNs();
+    int64_t due =
+        fast ? now
+             : kStart + static_cast<int64_t>((kRecorded - kFirst) / speed);
+
+    if (due - now > kSpin_Ns) {
+      int64_t wake = due - kSpin_Ns;
+      struct timespec ts = {static_cast<time_t>(wake / 1000000000),
+                            static_cast<long>(wake % 1000000000)};
+      while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) ==
+             EINTR) {
+      }
+    }
+    while ((now = MonotonicNs()) < due) {
+    }
+
+    span_.clear();
+    while (i < edges_.size() && edges_[i].timestamp_ns == kRecorded &&
+           span_.size() < kMax_Span) {
+      span_.push_back(EdgeEvent{now, edges_[i].gpio, edges_[i].value});
+      i++;
+    }
+
+    gpio_.InjectEdges(EdgeSpan(span_.data(), span_.size()));
+    auto done = MonotonicNs();
+
+    if (stats.spans == 0) first_dispatch = now;
+    last_dispatch = done;
+    stats.edges += span_.size();
+    stats.spans++;
+    late_sum += now - due;
+    stats.max_late_ns = std::max(stats.max_late_ns, now - due);
+    dispatch_sum += done - now;
+    stats.max_dispatch_ns = std::max(stats.max_dispatch_ns, done - now);
+  }
+
+  stats.duration_ns = last_dispatch - first_dispatch;
+  stats.edges_per_sec =
+      stats.duration_ns > 0 ? stats.edges * 1e9 / stats.duration_ns : 0;
+  stats.mean_late_ns = late_sum / static_cast<int64_t>(stats.spans);
+  stats.mean_dispatch_ns = dispatch_sum / static_cast<int64_t>(stats.spans);
+  return stats;
+}
+
+}  // namespace jetson
@@ -0,0 +1,168 @@
+/**
+ * @file edge_recorder.h
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "gpio.h"
+#include "types.h"
+
+namespace jetson {
+
+// Edges an EdgeRecorder keeps by default.
+static const std::size_t kDefault_Recording_Capacity = 1 << 20;
+
+/**
+ * @brief Time stamped edges of some inputs. Channel names are kept along
+ * with the gpio numbers, so that a recording can be replayed on another
+ * board type.
+ */
+struct EdgeRecording {
+  std::map<int, std::string> channels;  // channel by global gpio number
+  std::vector<EdgeEvent> edges;         // in the order they were seen
+};
+
+/**
+ * @brief Write a recording to a text file, one edge per line.
+ *
+ * @param recording the recording.
+ * @param path the file.
+ * @return The result of writing the file.
+ */
+JResult SaveRecording(const EdgeRecording& recording, const std::string& path);
+
+/**
+ * @brief Read a recording written by SaveRecording().
+ *
+ * @param path the file.
+ * @param recording filled with the recording.
+ * @return The result of reading the file.
+ */
+JResult LoadRecording(const std::string& path, EdgeRecording* recording);
+
+/**
+ * @brief Records the edges of inputs with the time stamps of the edge
+ * monitor. Edges are kept in memory reserved up front; edges beyond the
+ * capacity are counted and dropped.
+ */
+class EdgeRecorder {
+ public:
+  /**
+   * @brief Create (or reuse) the input channels and start recording. Throws
+   * if a channel can't be created as an input.
+   *
+   * @param gpio the gpio the channels belong to. Must outlive the recorder.
+   * @param channels the input channels.
+   * @param capacity edges kept at most.
+   * @param pull pull up/down of the inputs.
+   */
+  EdgeRecorder(Gpio& gpio, const std::vector<std::string>& channels,
+               std::size_t capacity = kDefault_Recording_Capacity,
+               Pull pull = Pull::OFF);
+  ~EdgeRecorder();
+
+  /**
+   * @brief Stop recording. Edges recorded so far are kept.
+   */
+  void Stop();
+
+  /**
+   * @brief Get a copy of the edges recorded so far.
+   */
+  EdgeRecording GetRecording() const;
+
+  /**
+   * @brief Get how many edges were dropped for lack of capacity.
+   */
+  uint64_t GetDropped() const;
+
+ private:
+  EdgeRecorder(const EdgeRecorder&) = delete;
+  EdgeRecorder(EdgeRecorder&&) = delete;
+
+ private:
+  void Record(EdgeSpan edges);
+
+ private:
+  Gpio& gpio_;
+  const std::size_t capacity_;
+  std::atomic<int> subscription_{0};
+  mutable std::mutex mutex_;  // guards the recording
+  EdgeRecording recording_;
+  std::atomic<uint64_t> dropped_{0};
+};
+
+/**
+ * @brief Feeds a recording back into the callbacks and batch callbacks of
+ * the lines, through Gpio::InjectEdges(). Edges seen in one wake-up of the
+ * recording are replayed together, with the time stamps of the replay.
+ * Replaying does not need the lines to change level, so it also serves as a
+ * load generator on a simulated board.
+ */
+class EdgeReplayer {
+ public:
+  /**
+   * @brief Map the recorded channels onto the gpio. Throws if a channel is
+   * not found in the current board mode.
+   *
+   * @param gpio the gpio to replay to. Must outlive the replayer.
+   * @param recording the recording.
+   */
+  EdgeReplayer(Gpio& gpio, EdgeRecording recording);
+
+  /**
+   * @brief Replay the whole recording on the calling thread. Edges are
+   * dispatched at their due time, the thread sleeps and spins in between.
+   * With ReplayTiming::SCALED, a speed that is not positive replays as fast
+   * as possible.
+   *
+   * @param options the timing of the replay.
+   * @return dispatch throughput, lateness and the time spans took to be
+   * dispatched.
+   */
+  ReplayStats Replay(ReplayOptions options = {});
+
+ private:
+  EdgeReplayer(const EdgeReplayer&) = delete;
+  EdgeReplayer(EdgeReplayer&&) = delete;
+
+ private:
+  Gpio& gpio_;
+  std::vector<EdgeEvent> edges_;  // with gpio numbers of this board
+  std::vector<EdgeEvent> span_;   // the span being dispatched
+};
+
+}  // namespace jetson
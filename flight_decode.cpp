@@ -0,0 +1,56 @@
+/**
+ * @file flight_decode.cpp
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <iostream>
+#include <string>
+#include "flight_recorder.h"
+
+// Turns a dump of the flight recorder (see Gpio::StartFlightRecorder()) into
+// a timeline of all threads, oldest first.
+
+int main(int argc, char** argv) {
+  if (argc != 2 || std::string(argv[1]) == "--help") {
+    std::cout << "Usage: flight_decode DUMP\n";
+    return argc == 2 ? 0 : -1;
+  }
+
+  jetson::FlightDump dump;
+  auto result = jetson::LoadFlightDump(argv[1], &dump);
+  if (!result.second) {
+    std::cerr << "[ERROR]: " << result.first << std::endl;
+    return -1;
+  }
+
+  std::cout << dump.events.size()
+            << " operations, times relative to the dump\n"
+            << jetson::FormatFlightTimeline(dump);
+  return 0;
+}
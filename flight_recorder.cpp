@@ -0,0 +1,412 @@
+/**
+ * @file flight_recorder.cpp
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "flight_recorder.h"
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+namespace jetson {
+
+namespace {
+
+struct FlightDumpHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t entry_size;
+  uint32_t rings;
+  uint64_t start_ticks;  // clock pairs the decoder converts ticks with
+  int64_t start_ns;
+  uint64_t dump_ticks;
+  int64_t dump_ns;
+};
+
+// Precedes the entries of a ring, which are followed by the head once more.
+struct FlightRingHeader {
+  uint64_t capacity;
+  uint64_t head;
+};
+
+const int kCrash_Signals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+
+std::atomic<uint64_t> next_recorder{1};  // 0 is never a valid id
+std::atomic<FlightRecorder*> signal_recorder{nullptr};
+std::atomic<int> dump_signal{0};
+
+// The rings of a thread by recorder. Gives them back when the thread exits.
+struct FlightLeases {
+  struct Lease {
+    uint64_t owner = 0;  // recorder id
+    std::shared_ptr<FlightRing> ring;  // null if the recorder had none left
+  };
+
+  ~FlightLeases() {
+    for (auto& lease : leases) Give(lease);
+  }
+
+  Lease* Find(uint64_t owner) {
+    for (auto& lease : leases) {
+      if (lease.owner == owner) return &lease;
+    }
+    return nullptr;
+  }
+
+  // A free lease, or the earliest taken one given back.
+  Lease& Next() {
+    auto& lease = leases[next++ % kFlight_Leases];
+    Give(lease);
+    return lease;
+  }
+
+  static void Give(Lease& lease) {
+    if (lease.ring) lease.ring->in_use.store(false);
+    lease = Lease{};
+  }
+
+  Lease leases[kFlight_Leases];
+  std::size_t next = 0;
+};
+
+thread_local FlightLeases leases;
+
+bool WriteAll(int fd, const void* data, std::size_t size) {
+  auto bytes = static_cast<const char*>(data);
+  while (size > 0) {
+    auto written = write(fd, bytes, size);
+    if (written < 0 && errno == EINTR) continue;
+    if (written <= 0) return false;
+    bytes += written;
+    size -= written;
+  }
+  return true;
+}
+
+const char* OpName(FlightOp op) {
+  switch (op) {
+    case FlightOp::CREATE_BINARY:
+      return "create";
+    case FlightOp::DESTROY_BINARY:
+      return "destroy";
+    case FlightOp::CREATE_PWM:
+      return "create pwm";
+    case FlightOp::DESTROY_PWM:
+      return "destroy pwm";
+    case FlightOp::WRITE:
+      return "write";
+    case FlightOp::READ:
+      return "read";
+    case FlightOp::EDGE:
+      return "edge";
+    case FlightOp::PWM_START:
+      return "pwm start";
+    case FlightOp::PWM_STOP:
+      return "pwm stop";
+    case FlightOp::PWM_PERIOD:
+      return "pwm period";
+    case FlightOp::PWM_DUTY_CYCLE:
+      return "pwm duty";
+  }
+  return "unknown";
+}
+
+std::string Detail(const FlightEvent& event) {
+  const char* level = event.value == 1 ? "high" : "low";
+  switch (event.op) {
+    case FlightOp::CREATE_BINARY:
+      return event.value == static_cast<int>(Direction::IN) ? "in" : "out";
+    case FlightOp::WRITE:
+      return event.arg ? std::string(level) + " (elided)" : level;
+    case FlightOp::READ:
+    case FlightOp::EDGE:
+      return level;
+    case FlightOp::PWM_PERIOD:
+    case FlightOp::PWM_DUTY_CYCLE:
+      return std::to_string(event.arg) + " ns";
+    default:
+      return "";
+  }
+}
+
+}  // namespace
+
+FlightRecorder::FlightRecorder(std::size_t entries_per_thread)
+    : id_(next_recorder.fetch_add(1)),
+      capacity_([&] {
+        std::size_t capacity = 2;
+        while (capacity < entries_per_thread) capacity *= 2;
+        return capacity;
+      }()),
+      start_ticks_(FlightTicks()),
+      start_ns_(MonotonicNs()) {}
+
+FlightRecorder::~FlightRecorder() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  RestoreSignals();
+}
+
+FlightRing* FlightRecorder::Attach() {
+  // back to a recorder the thread recorded to before
+  if (auto held = leases.Find(id_)) {
+    ring_owner_ = id_;
+    ring_ = held->ring.get();
+    return ring_;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  std::shared_ptr<FlightRing> ring;
+  auto count = ring_count_.load(std::memory_order_relaxed);
+  if (count < kMax_Flight_Threads) {
+    ring = std::make_shared<FlightRing>(capacity_);
+    owned_[count] = ring;
+    rings_[count].store(ring.get(), std::memory_order_release);
+    ring_count_.store(count + 1, std::memory_order_release);
+  } else {
+    // the first ring given back, by index
+    for (const auto& owned : owned_) {
+      if (!owned->in_use.load()) {
+        ring = owned;
+        break;
+      }
+    }
+  }
+
+  if (ring) {
+    ring->tid = static_cast<pid_t>(syscall(SYS_gettid));
+    ring->in_use.store(true);
+  }
+
+  // also when no ring is left, so that the thread does not ask again
+  auto& lease = leases.Next();
+  lease.owner = id_;
+  lease.ring = std::move(ring);
+  ring_owner_ = id_;
+  ring_ = lease.ring.get();
+  return ring_;
+}
+
+JResult FlightRecorder::Dump(const std::string& path) const {
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return JResult{"open " + path + " failed: " + std::strerror(errno), false};
+  }
+
+  bool dumped = DumpTo(fd);
+  if (close(fd) != 0) dumped = false;
+  if (!dumped) return JResult{"write " + path + " failed", false};
+  return JResult{"Ok", true};
+}
+
+bool FlightRecorder::DumpTo(int fd) const {
+  auto count = ring_count_.load(std::memory_order_acquire);
+  FlightDumpHeader header{kFlight_Magic,
+                          kFlight_Version,
+                          sizeof(FlightEntry),
+                          static_cast<uint32_t>(count),
+                          start_ticks_,
+                          start_ns_,
+                          FlightTicks(),
+                          MonotonicNs()};
+  if (!WriteAll(fd, &header, sizeof(header))) return false;
+
+  for (std::size_t i = 0; i < count; i++) {
+    auto ring = rings_[i].load(std::memory_order_acquire);
+    FlightRingHeader ring_header{ring->mask + 1,
+                                 ring->head.load(std::memory_order_acquire)};
+    if (!WriteAll(fd, &ring_header, sizeof(ring_header)) ||
+        !WriteAll(fd, ring->entries.get(),
+                  ring_header.capacity * sizeof(FlightEntry))) {
+      return false;
+    }
+
+    // entries overwritten meanwhile are told by how far the head moved
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    if (!WriteAll(fd, &head, sizeof(head))) return false;
+  }
+  return true;
+}
+
+JResult FlightRecorder::DumpOnSignal(const std::string& path, int signo,
+                                     bool on_crash) {
+  if (path.size() >= sizeof(dump_path_)) {
+    return JResult{"Dump path too long", false};
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  FlightRecorder* owner = nullptr;
+  if (!signal_recorder.compare_exchange_strong(owner, this) &&
+      owner != this) {
+    return JResult{"Another recorder dumps on signals", false};
+  }
+
+  // replaces what an earlier call installed
+  for (const auto& previous : previous_) {
+    sigaction(previous.first, &previous.second, nullptr);
+  }
+  previous_.clear();
+  std::strncpy(dump_path_, path.c_str(), sizeof(dump_path_) - 1);
+  dump_signal.store(signo);
+
+  struct sigaction action = {};
+  action.sa_handler = &FlightRecorder::OnSignal;
+  sigemptyset(&action.sa_mask);
+
+  std::vector<int> signals;
+  if (signo > 0) signals.push_back(signo);
+  if (on_crash) {
+    for (int crash : kCrash_Signals) {
+      if (crash != signo) signals.push_back(crash);
+    }
+  }
+
+  for (int s : signals) {
+    // after a crash the default action takes over
+    action.sa_flags = s == signo ? SA_RESTART : SA_RESETHAND;
+    struct sigaction previous;
+    if (sigaction(s, &action, &previous) != 0) {
+      RestoreSignals();
+      return JResult{std::string("install signal handler failed: ") +
+                         std::strerror(errno),
+                     false};
+    }
+    previous_.emplace_back(s, previous);
+  }
+  return JResult{"Ok", true};
+}
+
+std::size_t FlightRecorder::GetThreads() const { return ring_count_.load(); }
+
+void FlightRecorder::RestoreSignals() {
+  for (const auto& previous : previous_) {
+    sigaction(previous.first, &previous.second, nullptr);
+  }
+  previous_.clear();
+
+  FlightRecorder* owner = this;
+  signal_recorder.compare_exchange_strong(owner, nullptr);
+}
+
+void FlightRecorder::OnSignal(int signo) {
+  int saved_errno = errno;
+
+  if (auto recorder = signal_recorder.load()) {
+    int fd = open(recorder->dump_path_,
+                  O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd >= 0) {
+      (void)recorder->DumpTo(fd);
+      close(fd);
+    }
+  }
+
+  // A crash is raised again with the default action restored. It is
+  // delivered once the handler returns.
+  if (signo != dump_signal.load()) raise(signo);
+  errno = saved_errno;
+}
+
+JResult LoadFlightDump(const std::string& path, FlightDump* dump) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) return JResult{"open " + path + " failed", false};
+
+  FlightDumpHeader header;
+  if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      header.magic != kFlight_Magic || header.version != kFlight_Version ||
+      header.entry_size != sizeof(FlightEntry)) {
+    return JResult{path + " is no flight recorder dump", false};
+  }
+
+  // ticks to ns, by the clock pairs taken at start and at the dump
+  long double ns_per_tick = 1;
+  if (header.dump_ticks > header.start_ticks) {
+    ns_per_tick = static_cast<long double>(header.dump_ns - header.start_ns) /
+                  (header.dump_ticks - header.start_ticks);
+  }
+
+  dump->dump_ns = header.dump_ns;
+  dump->events.clear();
+  std::vector<FlightEntry> entries;
+  for (uint32_t r = 0; r < header.rings; r++) {
+    FlightRingHeader ring;
+    uint64_t head_after = 0;
+    if (!file.read(reinterpret_cast<char*>(&ring), sizeof(ring)) ||
+        ring.capacity == 0 || (ring.capacity & (ring.capacity - 1))) {
+      return JResult{path + " is truncated", false};
+    }
+    entries.resize(ring.capacity);
+    if (!file.read(reinterpret_cast<char*>(entries.data()),
+                   ring.capacity * sizeof(FlightEntry)) ||
+        !file.read(reinterpret_cast<char*>(&head_after), sizeof(head_after))) {
+      return JResult{path + " is truncated", false};
+    }
+
+    // The slot at head_after may have been written while it was dumped.
+    uint64_t begin = head_after + 1 > ring.capacity
+                         ? head_after + 1 - ring.capacity
+                         : 0;
+    for (uint64_t i = begin; i < ring.head; i++) {
+      const auto& entry = entries[i & (ring.capacity - 1)];
+      int64_t ticks = static_cast<int64_t>(entry.ticks - header.start_ticks);
+      dump->events.push_back(FlightEvent{
+          header.start_ns + static_cast<int64_t>(ticks * ns_per_tick),
+          entry.tid, static_cast<FlightOp>(entry.op), entry.gpio, entry.value,
+          entry.arg});
+    }
+  }
+
+  std::stable_sort(dump->events.begin(), dump->events.end(),
+                   [](const FlightEvent& a, const FlightEvent& b) {
+                     return a.time_ns < b.time_ns;
+                   });
+  return JResult{"Ok", true};
+}
+
+std::string FormatFlightTimeline(const FlightDump& dump) {
+  std::ostringstream text;
+  char line[128];
+  for (const auto& event : dump.events) {
+    std::snprintf(line, sizeof(line),
+                  "%14.6f ms  tid %-7d %-12s gpio %-4d %s\n",
+                  (event.time_ns - dump.dump_ns) / 1e6, event.tid,
+                  OpName(event.op), event.gpio, Detail(event).c_str());
+    text << line;
+  }
+  return text.str();
+}
+
+}  // namespace jetson
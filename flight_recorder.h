@@ -0,0 +1,249 @@
+/**
+ * @file flight_recorder.h
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <signal.h>
+#include <sys/types.h>
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "types.h"
+
+namespace jetson {
+
+// Entries kept per thread, unless given otherwise. A power of two.
+static const std::size_t kFlight_Entries = 1 << 14;
+
+// Threads that can record at a time.
+static const std::size_t kMax_Flight_Threads = 64;
+
+// Recorders a thread keeps its ring of at a time.
+static const std::size_t kFlight_Leases = 4;
+
+static constexpr uint32_t kFlight_Magic = 0x4a474652;  // "JGFR"
+static constexpr uint32_t kFlight_Version = 1;
+
+enum class FlightOp : uint32_t {
+  CREATE_BINARY = 1,  // value: direction
+  DESTROY_BINARY,
+  CREATE_PWM,
+  DESTROY_PWM,
+  WRITE,           // value: level, arg: 1 if elided by the output policy
+  READ,            // value: level
+  EDGE,            // value: level
+  PWM_START,
+  PWM_STOP,
+  PWM_PERIOD,      // arg: period in ns
+  PWM_DUTY_CYCLE,  // arg: high time in ns
+};
+
+// One recorded operation, as kept in memory and in dumps.
+struct FlightEntry {
+  uint64_t ticks;  // see FlightTicks()
+  int64_t arg;
+  int32_t gpio;
+  int32_t value;
+  uint32_t op;  // FlightOp
+  int32_t tid;   // of the recording thread
+};
+
+static_assert(sizeof(FlightEntry) == 32, "FlightEntry is part of the dump");
+
+/**
+ * @brief The cheapest clock of the cpu: the time stamp counter on x86-64 and
+ * the virtual counter on aarch64. Converted to nanoseconds only when a dump
+ * is decoded.
+ */
+inline uint64_t FlightTicks() {
+#if defined(__x86_64__)
+  return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+  uint64_t ticks = 0;
+  asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+  return ticks;
+#else
+  return MonotonicNs();
+#endif
+}
+
+// The ring of one thread. Only that thread writes it.
+struct FlightRing {
+  explicit FlightRing(std::size_t capacity)
+      : entries(new FlightEntry[capacity]()), mask(capacity - 1) {}
+
+  std::atomic<uint64_t> head{0};  // entries ever recorded
+  std::unique_ptr<FlightEntry[]> entries;
+  const uint64_t mask;
+  pid_t tid = 0;  // of the thread owning the ring
+  std::atomic<bool> in_use{false};
+};
+
+/**
+ * @brief Keeps the latest operations of every thread in a ring of its own,
+ * so that recording takes no lock and shares no cache line: an entry costs a
+ * counter read and a few stores. A thread takes a ring on its first record
+ * and gives it back when it exits. It keeps its rings of kFlight_Leases
+ * recorders, so switching between them takes no lock; beyond that, the
+ * earliest taken ring is given back. The rings given back are handed on only
+ * once kMax_Flight_Threads rings exist, so their history is kept.
+ *
+ * Dumps are raw and can be written from a signal handler, also while other
+ * threads keep recording. LoadFlightDump() sorts them into a timeline.
+ */
+class FlightRecorder {
+ public:
+  /**
+   * @brief Create a recorder. Rings are allocated as threads record.
+   *
+   * @param entries_per_thread ring size, rounded up to a power of two.
+   */
+  explicit FlightRecorder(std::size_t entries_per_thread = kFlight_Entries);
+  ~FlightRecorder();
+
+  /**
+   * @brief Record an operation of the calling thread. Never blocks, except
+   * for the first record of a thread to this recorder. Nothing is recorded
+   * by a thread beyond kMax_Flight_Threads.
+   */
+  void Record(FlightOp op, int gpio, int value, int64_t arg = 0) {
+    auto ring = ring_;
+    if (ring_owner_ != id_) ring = Attach();
+    if (ring == nullptr) return;
+
+    auto head = ring->head.load(std::memory_order_relaxed);
+    ring->entries[head & ring->mask] =
+        FlightEntry{FlightTicks(), arg, gpio, value,
+                    static_cast<uint32_t>(op), ring->tid};
+    ring->head.store(head + 1, std::memory_order_release);
+  }
+
+  /**
+   * @brief Write a dump to a file.
+   *
+   * @param path the file, replaced if it exists.
+   * @return The result of writing the file.
+   */
+  JResult Dump(const std::string& path) const;
+
+  /**
+   * @brief Write a dump. Async signal safe.
+   *
+   * @param fd where to write to.
+   * @return false if a write failed.
+   */
+  bool DumpTo(int fd) const;
+
+  /**
+   * @brief Dump to a file whenever a signal arrives, and optionally when the
+   * process crashes (SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT). The previous
+   * handlers are restored when the recorder is destroyed; after a crash the
+   * default action follows the dump. Only one recorder of a process can
+   * dump on signals.
+   *
+   * @param path the file, replaced by every dump.
+   * @param signo the signal requesting a dump, 0 for none.
+   * @param on_crash whether to dump on crashes.
+   * @return The result of installing the handlers.
+   */
+  JResult DumpOnSignal(const std::string& path, int signo, bool on_crash);
+
+  /**
+   * @brief Get the number of threads that recorded so far, up to
+   * kMax_Flight_Threads.
+   */
+  std::size_t GetThreads() const;
+
+ private:
+  FlightRecorder(const FlightRecorder&) = delete;
+  FlightRecorder(FlightRecorder&&) = delete;
+
+ private:
+  FlightRing* Attach();
+  void RestoreSignals();
+  static void OnSignal(int signo);
+
+ private:
+  const uint64_t id_;  // unique over the process lifetime
+  const std::size_t capacity_;
+  const uint64_t start_ticks_;
+  const int64_t start_ns_;
+
+  std::mutex mutex_;  // guards taking rings
+  std::shared_ptr<FlightRing> owned_[kMax_Flight_Threads];
+  std::atomic<FlightRing*> rings_[kMax_Flight_Threads] = {};
+  std::atomic<std::size_t> ring_count_{0};
+
+  char dump_path_[PATH_MAX] = {};
+  std::vector<std::pair<int, struct sigaction>> previous_;  // by signal
+
+  // the ring of the calling thread, valid if taken from recorder ring_owner_
+  inline static thread_local FlightRing* ring_ = nullptr;
+  inline static thread_local uint64_t ring_owner_ = 0;
+};
+
+// A recorded operation with its time and thread.
+struct FlightEvent {
+  int64_t time_ns;  // CLOCK_MONOTONIC
+  pid_t tid;
+  FlightOp op;
+  int gpio;
+  int value;
+  int64_t arg;
+};
+
+struct FlightDump {
+  int64_t dump_ns = 0;  // CLOCK_MONOTONIC time of the dump
+  std::vector<FlightEvent> events;  // oldest first
+};
+
+/**
+ * @brief Read a dump of a FlightRecorder. Entries overwritten while the dump
+ * was written are left out.
+ *
+ * @param path the dump file.
+ * @param dump filled with the events of all threads in time order.
+ * @return The result of reading the file.
+ */
+JResult LoadFlightDump(const std::string& path, FlightDump* dump);
+
+/**
+ * @brief Render a dump as text, one event per line, timed relative to the
+ * dump.
+ */
+std::string FormatFlightTimeline(const FlightDump& dump);
+
+}  // namespace jetson
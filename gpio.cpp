@@ -31,26 +31,36 @@
  */
 
 #include "gpio.h"
+#include <sys/mman.h>
 #include <algorithm>
+#include <cerrno>
 #include <chrono>
+#include <cstring>
 #include <experimental/filesystem>
 #include <fstream>
+#include <iostream>
 #include <thread>
+#include "gpio_chips.h"
 #include "gpio_pin_data.h"
-
-#ifdef DEBUG
-#include <iostream>
-#endif
+#include "realtime.h"
 
 namespace fs = std::experimental::filesystem;
 
 namespace jetson {
 
+Gpio::Gpio(std::string root) : root_(std::move(root)) {}
+
+Gpio::~Gpio() {
+  DestroyPwm();
+  DestroyBinary();
+}
+
 JResult Gpio::Detect() {
   type_ = jetson::BoardType::UNKNOWN;
 
-  const std::string kCompatsPath = "/proc/device-tree/compatible";
-  const std::string kIdsPath = "/proc/device-tree/chosen/plugin-manager/ids";
+  const std::string kCompatsPath = root_ + "/proc/device-tree/compatible";
+  const std::string kIdsPath =
+      root_ + "/proc/device-tree/chosen/plugin-manager/ids";
 
   std::ifstream compats_file(kCompatsPath, std::ios::in);
   if (!compats_file.is_open()) {
@@ -120,57 +130,35 @@ COMPATIBLE_DETECT_DONE:
 #endif
 
   // 4. Get GPIO chip offsets
-  const std::vector<std::string> kSysfsPrefixes = {"/sys/devices/",
-                                                   "/sys/devices/platform/"};
+  chips_ = EnumerateGpioChips(root_);
 
-  std::map<std::string, std::string> gpio_chip_dirs;
-  std::map<std::string, int> gpio_chip_base;
-  std::map<std::string, int> gpio_chip_ngpio;
+  std::map<std::string, const GpioChip*> chips_by_device;
+  for (const auto& chip : chips_) chips_by_device[chip.device] = &chip;
 
+  chip_dirs_.clear();
+  chip_bases_.clear();
   for (const auto& pin_def : kPinDefs) {
-    std::string gpio_chip_dir = "";
-
     if (pin_def.chip_gpio_sysfs_dir != "") {
-      for (const auto& prefix : kSysfsPrefixes) {
-        auto dir = prefix + pin_def.chip_gpio_sysfs_dir;
-        if (fs::exists(dir)) {
-          gpio_chip_dir = dir;
-          break;
-        }
-      }
-
-      if (gpio_chip_dir == "") {
+      auto chip = chips_by_device.find(pin_def.chip_gpio_sysfs_dir);
+      if (chip == chips_by_device.end()) {
         auto error_message =
             "cannot find GPIO chip " + pin_def.chip_gpio_sysfs_dir;
         return JResult{error_message, false};
       }
 
-      gpio_chip_dirs[pin_def.chip_gpio_sysfs_dir] = gpio_chip_dir;
-      auto gpio_chip_gpio_dir = gpio_chip_dir + "/gpio";
-      for (auto& p : fs::directory_iterator(gpio_chip_gpio_dir)) {
-        auto path = p.path().filename().string();
-
-        const std::string kGpioChipPrefix = "gpiochip";
-
-        if (path.substr(0, kGpioChipPrefix.size()) == kGpioChipPrefix) {
-          // finds /sys/devices/**/gpiochip** directory
-          // it must contain "base" and "ngpio" file
-          std::ifstream base_file(gpio_chip_gpio_dir + "/" + path + "/base",
-                                  std::ios::in | std::ios::binary);
-          base_file >> gpio_chip_base[pin_def.chip_gpio_sysfs_dir];
-          std::ifstream ngpio_file(gpio_chip_gpio_dir + "/" + path + "/ngpio",
-                                   std::ios::in | std::ios::binary);
-          ngpio_file >> gpio_chip_ngpio[pin_def.chip_gpio_sysfs_dir];
-        }
-      }
+      chip_dirs_[pin_def.chip_gpio_sysfs_dir] = chip->second->dir;
+      chip_bases_[pin_def.chip_gpio_sysfs_dir] = chip->second->base;
     }
   }
 
-  // 5. Find PWM Chips
-  std::map<std::string, std::string> pwm_dirs;
+  const std::vector<std::string> kSysfsPrefixes = {
+      root_ + "/sys/devices/", root_ + "/sys/devices/platform/"};
 
+  // 5. Find PWM Chips
+  pwm_dirs_.clear();
   for (const auto& pin_def : kPinDefs) {
-    if (pin_def.chip_pwm_sysfs_dir != kNONE) {
+    if (pin_def.chip_pwm_sysfs_dir != kNONE &&
+        !pwm_dirs_.count(*pin_def.chip_pwm_sysfs_dir)) {
       std::string pwm_chip_dir = "";
 
       for (const auto& prefix : kSysfsPrefixes) {
@@ -192,119 +180,159 @@ COMPATIBLE_DETECT_DONE:
         auto path = p.path().filename().string();
         const std::string kPwmChipPrefix = "pwmchip";
         if (path.substr(0, kPwmChipPrefix.size()) == kPwmChipPrefix) {
-          pwm_dirs[*(pin_def.chip_pwm_sysfs_dir)] =
+          pwm_dirs_[*(pin_def.chip_pwm_sysfs_dir)] =
               pwm_chip_dir + "/pwm" + "/" + path;
 
 #ifdef DEBUG
           std::cout << "[info]: pwm detected at "
-                    << pwm_dirs[*(pin_def.chip_pwm_sysfs_dir)] << std::endl;
+                    << pwm_dirs_[*(pin_def.chip_pwm_sysfs_dir)] << std::endl;
 #endif
         }
       }
     }
   }
 
-  auto create_gpio_id_name =
-      [&](int chip_relative_id,
-          std::string gpio_chip_name) -> std::pair<int, std::string> {
-    std::pair<int, std::string> id_name;
-    id_name.first = gpio_chip_base[gpio_chip_name] + chip_relative_id;
-    id_name.second = "gpio" + std::to_string(id_name.first);
-    return id_name;
-  };
-
-  // Final Step: gather all channel data
-  auto& board_mode_data = data_[BoardMode::BOARD];
-  for (const auto& x : kPinDefs) {
-    auto pin_number_str = PinNumber2String(x.board_pin_num);
-    auto id_name =
-        create_gpio_id_name(x.chip_gpio_pin_num, x.chip_gpio_sysfs_dir);
-    board_mode_data[pin_number_str] = ChannelInfo{
-        pin_number_str,
-        gpio_chip_dirs[x.chip_gpio_sysfs_dir],
-        x.chip_gpio_pin_num,
-        id_name.first,
-        id_name.second,
-        x.chip_pwm_sysfs_dir == kNONE
-            ? kNONE
-            : std::optional<std::string>(pwm_dirs[*(x.chip_pwm_sysfs_dir)]),
-        x.chip_pwm_id};
-  }
-
-  auto& bcm_mode_data = data_[BoardMode::BCM];
-  for (const auto& x : kPinDefs) {
-    auto pin_number_str = PinNumber2String(x.bcm_pin_num);
-    auto id_name =
-        create_gpio_id_name(x.chip_gpio_pin_num, x.chip_gpio_sysfs_dir);
-    bcm_mode_data[pin_number_str] = {
-        pin_number_str,
-        gpio_chip_dirs[x.chip_gpio_sysfs_dir],
-        x.chip_gpio_pin_num,
-        id_name.first,
-        id_name.second,
-        x.chip_pwm_sysfs_dir == kNONE
-            ? kNONE
-            : std::optional<std::string>(pwm_dirs[*(x.chip_pwm_sysfs_dir)]),
-        x.chip_pwm_id};
-  }
-
-  auto& cvm_mode_data = data_[BoardMode::CVM];
-  for (const auto& x : kPinDefs) {
-    auto id_name =
-        create_gpio_id_name(x.chip_gpio_pin_num, x.chip_gpio_sysfs_dir);
-    cvm_mode_data[x.cvm_pin_name] = {
-        x.cvm_pin_name,
-        gpio_chip_dirs[x.chip_gpio_sysfs_dir],
-        x.chip_gpio_pin_num,
-        id_name.first,
-        id_name.second,
-        x.chip_pwm_sysfs_dir == kNONE
-            ? kNONE
-            : std::optional<std::string>(pwm_dirs[*(x.chip_pwm_sysfs_dir)]),
-        x.chip_pwm_id};
-  }
-
-  auto& tegra_soc_mode_data = data_[BoardMode::TEGRA_SOC];
-  for (const auto& x : kPinDefs) {
-    auto id_name =
-        create_gpio_id_name(x.chip_gpio_pin_num, x.chip_gpio_sysfs_dir);
-    tegra_soc_mode_data[x.tegra_soc_pin_name] = {
-        x.tegra_soc_pin_name,
-        gpio_chip_dirs[x.chip_gpio_sysfs_dir],
-        x.chip_gpio_pin_num,
-        id_name.first,
-        id_name.second,
-        x.chip_pwm_sysfs_dir == kNONE
-            ? kNONE
-            : std::optional<std::string>(pwm_dirs[*(x.chip_pwm_sysfs_dir)]),
-        x.chip_pwm_id};
-  }
+  // Channels of a mode are only gathered once the mode is used.
+  pin_defs_ = &kPinDefs;
+  channels_ = std::make_unique<ChannelIndex>();
 
   return JOK;
 }
 
 JResult Gpio::SetMode(BoardMode mode) {
-  if (curr_board_mode_ != BoardMode::UNKNONW) {
+  auto expected = BoardMode::UNKNONW;
+  if (!curr_board_mode_.compare_exchange_strong(expected, mode)) {
     return JResult{"Mode already set", false};
   }
 
-  curr_board_mode_ = mode;
   return JOK;
 }
 
 ChannelInfo Gpio::GetChannelInfo(BoardMode mode, std::string channel) const {
-  return data_.at(mode).at(channel);
+  auto channels = Channels(mode);
+  if (channels == nullptr) throw std::out_of_range("board mode not available");
+  return channels->at(channel);
 }
 
-BoardMode Gpio::GetBoardMode() const { return curr_board_mode_; }
+BoardMode Gpio::GetBoardMode() const { return curr_board_mode_.load(); }
 
 BoardType Gpio::GetBoardType() const { return type_; }
 
+const std::vector<GpioChip>& Gpio::GetChips() const { return chips_; }
+
 std::string Gpio::GetBoardName() const { return BoardType2String(type_); }
 
+const ChannelInfo* Gpio::FindChannel(BoardMode mode,
+                                     const std::string& channel) const {
+  auto channels = Channels(mode);
+  if (channels == nullptr) return nullptr;
+
+  auto info = channels->find(channel);
+  return info == channels->end() ? nullptr : &info->second;
+}
+
+const std::map<std::string, ChannelInfo>* Gpio::Channels(
+    BoardMode mode) const {
+  int index = -1;
+  switch (mode) {
+    case BoardMode::BOARD:
+      index = 0;
+      break;
+    case BoardMode::BCM:
+      index = 1;
+      break;
+    case BoardMode::CVM:
+      index = 2;
+      break;
+    case BoardMode::TEGRA_SOC:
+      index = 3;
+      break;
+    default:
+      break;
+  }
+  if (index < 0 || !channels_) return nullptr;
+
+  auto& channels = channels_->channels[index];
+  std::call_once(channels_->built[index], [&] {
+    for (const auto& x : *pin_defs_) {
+      std::string channel;
+      switch (mode) {
+        case BoardMode::BOARD:
+          channel = PinNumber2String(x.board_pin_num);
+          break;
+        case BoardMode::BCM:
+          channel = PinNumber2String(x.bcm_pin_num);
+          break;
+        case BoardMode::CVM:
+          channel = x.cvm_pin_name;
+          break;
+        default:
+          channel = x.tegra_soc_pin_name;
+          break;
+      }
+
+      auto gpio = chip_bases_.at(x.chip_gpio_sysfs_dir) + x.chip_gpio_pin_num;
+      channels[channel] = ChannelInfo{
+          channel,
+          chip_dirs_.at(x.chip_gpio_sysfs_dir),
+          x.chip_gpio_pin_num,
+          gpio,
+          "gpio" + std::to_string(gpio),
+          x.chip_pwm_sysfs_dir == kNONE
+              ? kNONE
+              : std::optional<std::string>(
+                    pwm_dirs_.count(*x.chip_pwm_sysfs_dir)
+                        ? pwm_dirs_.at(*x.chip_pwm_sysfs_dir)
+                        : ""),
+          x.chip_pwm_id,
+          root_ + kSysfs_Root};
+    }
+
+    // Chips not in the pin table (e.g. expanders) are addressable line by
+    // line as "<label>:<offset>" in every mode. A label shared by several of
+    // them is replaced by the device name.
+    std::map<std::string, int> labels;
+    for (const auto& chip : chips_) {
+      if (!chip_dirs_.count(chip.device)) labels[chip.label]++;
+    }
+
+    for (const auto& chip : chips_) {
+      if (chip_dirs_.count(chip.device)) continue;
+
+      auto prefix = labels[chip.label] > 1 ? chip.device : chip.label;
+      for (int offset = 0; offset < chip.ngpio; offset++) {
+        auto channel = prefix + ":" + std::to_string(offset);
+        int gpio = chip.base + offset;
+        channels[channel] = ChannelInfo{channel,
+                                        chip.dir,
+                                        offset,
+                                        gpio,
+                                        "gpio" + std::to_string(gpio),
+                                        kNONE,
+                                        kNONE,
+                                        root_ + kSysfs_Root};
+      }
+    }
+  });
+
+  return &channels;
+}
+
+void Gpio::WaitPending(std::unique_lock<std::shared_mutex>& lock,
+                       const std::string& channel) {
+  created_.wait(lock, [&] { return pending_.count(channel) == 0; });
+}
+
+void Gpio::Release(const std::string& channel) {
+  std::unique_lock<std::shared_mutex> lock(registry_mutex_);
+  pending_.erase(channel);
+  created_.notify_all();
+}
+
 Gpio::BinaryResult Gpio::CreateBinary(std::string channel, Direction direction,
                                       Signal initial_value, Pull pull) {
-  if (curr_board_mode_ == BoardMode::UNKNONW) {
+  auto mode = curr_board_mode_.load();
+  if (mode == BoardMode::UNKNONW) {
     return BinaryResult{"Board mode not set", nullptr};
   }
 
@@ -313,32 +341,430 @@ Gpio::BinaryResult Gpio::CreateBinary(std::string channel, Direction direction,
                         nullptr};
   }
 
+  auto info = FindChannel(mode, channel);
+  if (info == nullptr) {
+    return BinaryResult{"Channel " + channel + " not found", nullptr};
+  }
+
+  // A creation of the channel in progress is waited for, it may well create
+  // the controller asked for.
+  std::unique_lock<std::shared_mutex> lock(registry_mutex_);
+  WaitPending(lock, channel);
   auto it = std::find_if(
       binaries_.begin(), binaries_.end(),
       [&](const auto& binary) { return binary->GetChannel() == channel; });
 
-  binaries_.emplace_back(std::make_unique<BinaryController>(
-      data_[curr_board_mode_][channel], direction, initial_value, pull));
+  if (it != binaries_.end()) {
+    if ((*it)->GetDirection() != direction) {
+      return BinaryResult{"Channel " + channel + " is used in the other "
+                          "direction",
+                          nullptr};
+    }
+    return BinaryResult{"Ok", it->get()};
+  }
+
+  // Exporting takes a while. Keep the registry unlocked meanwhile and only
+  // keep others from creating the same channel.
+  pending_.insert(channel);
+  lock.unlock();
+
+  std::unique_ptr<BinaryController> binary;
+  try {
+    binary = std::make_unique<BinaryController>(
+        *info, direction, initial_value, pull,
+        event_loop_.load() ? nullptr : &callback_pool_, &edge_monitor_);
+  } catch (...) {
+    Release(channel);
+    throw;
+  }
 
+  lock.lock();
+  if (publisher_) binary->AttachPublisher(publisher_.get());
+  if (flight_recorder_) {
+    binary->AttachRecorder(flight_recorder_.get());
+    binary->Record(FlightOp::CREATE_BINARY, static_cast<int>(direction));
+  }
+  pending_.erase(channel);
+  created_.notify_all();
+  binaries_.emplace_back(std::move(binary));
   return BinaryResult{"Ok", binaries_.back().get()};
 }
 
+void Gpio::SetCallbackThreads(int threads) {
+  callback_pool_.SetThreads(threads);
+}
+
+JResult Gpio::SetRealtimeConfig(const RealtimeConfig& config) {
+  auto checked = CheckRealtimeConfig(config);
+  if (!checked.second) return checked;
+
+  if (!edge_monitor_.SetRealtimeConfig(config)) {
+    return JResult{"Edge monitor already started", false};
+  }
+  if (!callback_pool_.SetRealtimeConfig(config)) {
+    edge_monitor_.SetRealtimeConfig(realtime_);
+    return JResult{"Worker pool already started", false};
+  }
+  if (!write_scheduler_.SetRealtimeConfig(config)) {
+    edge_monitor_.SetRealtimeConfig(realtime_);
+    callback_pool_.SetRealtimeConfig(realtime_);
+    return JResult{"Write scheduler already started", false};
+  }
+
+  if (config.lock_memory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+    edge_monitor_.SetRealtimeConfig(realtime_);
+    callback_pool_.SetRealtimeConfig(realtime_);
+    write_scheduler_.SetRealtimeConfig(realtime_);
+    return JResult{std::string("lock memory failed: ") + std::strerror(errno),
+                   false};
+  }
+
+  realtime_ = config;
+  return JResult{"Ok", true};
+}
+
+JResult Gpio::UseEventLoop() {
+  std::unique_lock<std::shared_mutex> lock(registry_mutex_);
+  if (event_loop_.load()) return JResult{"Event loop already used", false};
+  if (!binaries_.empty() || !pwms_.empty() || !pending_.empty()) {
+    return JResult{"Channels created already", false};
+  }
+  if (metrics_exporter_) return JResult{"Metrics already exported", false};
+
+  auto used = edge_monitor_.UseExternalLoop({write_scheduler_.GetTimerFd()});
+  if (!used.second) return used;
+  if (!write_scheduler_.UseExternalLoop()) {
+    return JResult{"Write scheduler already started", false};
+  }
+
+  event_loop_.store(true);
+  return JResult{"Ok", true};
+}
+
+std::vector<int> Gpio::GetPollFds() const {
+  if (!event_loop_.load()) return {};
+  return {edge_monitor_.GetEdgeFd(), edge_monitor_.GetLoopFd()};
+}
+
+int Gpio::Dispatch(int max_events) {
+  if (!event_loop_.load()) return 0;
+  return edge_monitor_.Dispatch(max_events) + write_scheduler_.Dispatch();
+}
+
+JResult Gpio::PublishState(const std::string& name) {
+  std::unique_lock<std::shared_mutex> lock(registry_mutex_);
+  if (publisher_) return JResult{"State already published", false};
+
+  try {
+    publisher_ = std::make_unique<StatePublisher>(name);
+  } catch (const std::exception& e) {
+    return JResult{e.what(), false};
+  }
+
+  for (auto& binary : binaries_) binary->AttachPublisher(publisher_.get());
+  for (auto& pwm : pwms_) pwm->AttachPublisher(publisher_.get());
+  return JResult{"Ok", true};
+}
+
+JResult Gpio::StartMetricsExporter(const std::string& path) {
+  std::unique_lock<std::shared_mutex> lock(registry_mutex_);
+  if (metrics_exporter_) return JResult{"Metrics already exported", false};
+  if (event_loop_.load()) return JResult{"No threads in event loop", false};
+
+  try {
+    metrics_exporter_ = std::make_unique<MetricsExporter>(
+        path, [this](MetricsWriter& writer) { RenderMetrics(writer); });
+  } catch (const std::exception& e) {
+    return JResult{e.what(), false};
+  }
+  return JResult{"Ok", true};
+}
+
+JResult Gpio::StartFlightRecorder(std::size_t entries_per_thread) {
+  std::unique_lock<std::shared_mutex> lock(registry_mutex_);
+  if (flight_recorder_) {
+    return JResult{"Flight recorder already started", false};
+  }
+
+  flight_recorder_ = std::make_unique<FlightRecorder>(entries_per_thread);
+  for (auto& binary : binaries_) binary->AttachRecorder(flight_recorder_.get());
+  for (auto& pwm : pwms_) pwm->AttachRecorder(flight_recorder_.get());
+  return JResult{"Ok", true};
+}
+
+JResult Gpio::DumpFlightRecorder(const std::string& path) const {
+  std::shared_lock<std::shared_mutex> lock(registry_mutex_);
+  if (!flight_recorder_) return JResult{"Flight recorder not started", false};
+  return flight_recorder_->Dump(path);
+}
+
+JResult Gpio::DumpFlightRecorderOnSignal(const std::string& path, int signo,
+                                         bool on_crash) {
+  std::shared_lock<std::shared_mutex> lock(registry_mutex_);
+  if (!flight_recorder_) return JResult{"Flight recorder not started", false};
+  return flight_recorder_->DumpOnSignal(path, signo, on_crash);
+}
+
+void Gpio::RenderMetrics(MetricsWriter& writer) const {
+  // Only the registry is locked, the lines are read through their atomics.
+  std::shared_lock<std::shared_mutex> lock(registry_mutex_);
+
+  writer.Family("jetson_gpio_writes_total", "counter",
+                "Writes to the value file of an output.");
+  for (const auto& binary : binaries_) {
+    const auto& m = binary->metrics_;
+    writer.Sample("jetson_gpio_writes_total", m.labels, nullptr,
+                  m.writes.load(std::memory_order_relaxed));
+  }
+
+  writer.Family("jetson_gpio_edges_total", "counter",
+                "Edges seen on a watched line.");
+  for (const auto& binary : binaries_) {
+    const auto& m = binary->metrics_;
+    writer.Sample("jetson_gpio_edges_total", m.labels, "edge=\"rising\"",
+                  m.rising_edges.load(std::memory_order_relaxed));
+    writer.Sample("jetson_gpio_edges_total", m.labels, "edge=\"falling\"",
+                  m.falling_edges.load(std::memory_order_relaxed));
+  }
+
+  writer.Family("jetson_gpio_callbacks_total", "counter",
+                "Edge callbacks run.");
+  for (const auto& binary : binaries_) {
+    const auto& m = binary->metrics_;
+    writer.Sample("jetson_gpio_callbacks_total", m.labels, nullptr,
+                  m.callbacks.load(std::memory_order_relaxed));
+  }
+
+  writer.Family("jetson_gpio_callback_dropped_total", "counter",
+                "Edges dropped by a full callback queue.");
+  for (const auto& binary : binaries_) {
+    const auto& m = binary->metrics_;
+    writer.Sample("jetson_gpio_callback_dropped_total", m.labels, nullptr,
+                  m.dropped.load(std::memory_order_relaxed));
+  }
+
+  writer.Family("jetson_gpio_callback_coalesced_total", "counter",
+                "Edges merged into a pending one of a callback queue.");
+  for (const auto& binary : binaries_) {
+    const auto& m = binary->metrics_;
+    writer.Sample("jetson_gpio_callback_coalesced_total", m.labels, nullptr,
+                  m.coalesced.load(std::memory_order_relaxed));
+  }
+
+  writer.Family("jetson_gpio_callback_latency_seconds", "histogram",
+                "Time from an edge being seen to its callback starting.");
+  for (const auto& binary : binaries_) {
+    const auto& m = binary->metrics_;
+    writer.Histogram("jetson_gpio_callback_latency_seconds", m.labels,
+                     m.callback_latency);
+  }
+
+  writer.Family("jetson_gpio_edge_overflows_total", "counter",
+                "Overflows of the kernel event queue, edges were lost.");
+  writer.Sample("jetson_gpio_edge_overflows_total", std::string(), nullptr,
+                edge_monitor_.GetOverflows());
+}
+
+JOutcome<int> Gpio::RegisterBatchCallback(
+    const std::vector<std::string>& channels,
+    EdgeMonitor::BatchCallBack callback, BatchOptions options) {
+  // Keeps the controllers from being destroyed while they are added.
+  std::shared_lock<std::shared_mutex> lock(registry_mutex_);
+
+  std::vector<BinaryController*> lines;
+  std::vector<int> gpios;
+  for (const auto& channel : channels) {
+    auto it = std::find_if(
+        binaries_.begin(), binaries_.end(),
+        [&](const auto& binary) { return binary->GetChannel() == channel; });
+
+    if (it == binaries_.end()) {
+      return JOutcome<int>{"Channel " + channel + " was not created", 0};
+    }
+    lines.push_back(it->get());
+  }
+
+  for (auto line : lines) {
+    line->Watch();
+    gpios.push_back(line->info_.gpio);
+  }
+
+  return JOutcome<int>{
+      "Ok", edge_monitor_.Subscribe(std::move(gpios), std::move(callback),
+                                    options)};
+}
+
+void Gpio::UnregisterBatchCallback(int id) { edge_monitor_.Unsubscribe(id); }
+
+void Gpio::InjectEdges(EdgeSpan edges) { edge_monitor_.Inject(edges); }
+
+JOutcome<int> Gpio::AddReflex(const ReflexRule& rule) {
+  if (rule.edge != TriggerEdge::RISING && rule.edge != TriggerEdge::FALLING &&
+      rule.edge != TriggerEdge::BOTH) {
+    return JOutcome<int>{"Invalid edge", 0};
+  }
+  if (rule.level != Signal::HIGH && rule.level != Signal::LOW) {
+    return JOutcome<int>{"Invalid level", 0};
+  }
+
+  std::unique_lock<std::shared_mutex> lock(registry_mutex_);
+  for (const auto* channel : {&rule.input, &rule.output}) {
+    auto it = std::find_if(
+        binaries_.begin(), binaries_.end(),
+        [&](const auto& binary) { return binary->GetChannel() == *channel; });
+
+    if (it == binaries_.end()) {
+      return JOutcome<int>{"Channel " + *channel + " was not created", 0};
+    }
+    auto direction = channel == &rule.input ? Direction::IN : Direction::OUT;
+    if ((*it)->GetDirection() != direction) {
+      return JOutcome<int>{"Channel " + *channel + " is not an " +
+                               (direction == Direction::IN ? "input"
+                                                           : "output"),
+                           0};
+    }
+  }
+
+  int id = next_reflex_++;
+  reflexes_.emplace(id, rule);
+  CompileReflexes();
+  return JOutcome<int>{"Ok", id};
+}
+
+void Gpio::RemoveReflex(int id) {
+  std::unique_lock<std::shared_mutex> lock(registry_mutex_);
+  if (reflexes_.erase(id) > 0) CompileReflexes();
+}
+
+ReflexStats Gpio::GetReflexStats() const {
+  return edge_monitor_.GetReflexStats();
+}
+
+void Gpio::CompileReflexes() {
+  std::vector<EdgeMonitor::Reflex> table;
+  for (const auto& r : reflexes_) {
+    const auto& rule = r.second;
+    BinaryController* input = nullptr;
+    BinaryController* output = nullptr;
+    for (const auto& binary : binaries_) {
+      if (binary->GetChannel() == rule.input) input = binary.get();
+      if (binary->GetChannel() == rule.output) output = binary.get();
+    }
+
+    input->Watch();
+    table.push_back(EdgeMonitor::Reflex{input->info_.gpio, rule.edge, output,
+                                        rule.level, rule.delay.count()});
+  }
+  edge_monitor_.SetReflexes(std::move(table));
+}
+
 void Gpio::DestroyBinary(std::string channel) {
-  auto it = std::find_if(
-      binaries_.begin(), binaries_.end(),
-      [&](const auto& binary) { return binary->GetChannel() == channel; });
+  std::unique_ptr<BinaryController> binary;
+  std::list<std::unique_ptr<ScanCycle>> cycles;
+  {
+    std::unique_lock<std::shared_mutex> lock(registry_mutex_);
+    auto it = std::find_if(
+        binaries_.begin(), binaries_.end(),
+        [&](const auto& binary) { return binary->GetChannel() == channel; });
+
+    if (it == binaries_.end()) return;
+    binary = std::move(*it);
+    binaries_.erase(it);
+    binary->Record(FlightOp::DESTROY_BINARY, 0);
+
+    // the monitor drops the compiled reflexes along with the line
+    for (auto r = reflexes_.begin(); r != reflexes_.end();) {
+      bool uses = r->second.input == channel || r->second.output == channel;
+      r = uses ? reflexes_.erase(r) : std::next(r);
+    }
+    value_batches_.remove_if(
+        [&](const auto& batch) { return batch->Contains(binary.get()); });
+    for (auto it = scan_cycles_.begin(); it != scan_cycles_.end();) {
+      auto next = std::next(it);
+      if ((*it)->Contains(binary.get())) {
+        cycles.splice(cycles.end(), scan_cycles_, it);
+      }
+      it = next;
+    }
+  }
+
+  // stopped and unexported outside the lock, a step may call back
+  cycles.clear();
+  write_scheduler_.Remove(binary.get());
+  binary.reset();
+}
+
+void Gpio::DestroyBinary() {
+  std::list<std::unique_ptr<BinaryController>> binaries;
+  std::list<std::unique_ptr<ScanCycle>> cycles;
+  {
+    std::unique_lock<std::shared_mutex> lock(registry_mutex_);
+    value_batches_.clear();
+    reflexes_.clear();
+    cycles.swap(scan_cycles_);
+    binaries.swap(binaries_);
+  }
+
+  cycles.clear();
+  for (const auto& binary : binaries) {
+    binary->Record(FlightOp::DESTROY_BINARY, 0);
+    write_scheduler_.Remove(binary.get());
+  }
+  BinaryController::Destroy(std::move(binaries));
+}
 
-  binaries_.erase(it);
+JOutcome<uint64_t> Gpio::ScheduleWrite(const std::vector<std::string>& channels,
+                                       Signal level, int64_t deadline_ns) {
+  // Keeps the controllers from being destroyed while they are scheduled.
+  std::shared_lock<std::shared_mutex> lock(registry_mutex_);
+
+  std::vector<BinaryController*> lines;
+  for (const auto& channel : channels) {
+    auto it = std::find_if(
+        binaries_.begin(), binaries_.end(),
+        [&](const auto& binary) { return binary->GetChannel() == channel; });
+
+    if (it == binaries_.end()) {
+      return JOutcome<uint64_t>{"Channel " + channel + " was not created", 0};
+    }
+    if ((*it)->GetDirection() != Direction::OUT) {
+      return JOutcome<uint64_t>{"Channel " + channel + " is not an output",
+                                0};
+    }
+    lines.push_back(it->get());
+  }
+
+  if (lines.empty()) return JOutcome<uint64_t>{"No channel given", 0};
+  return JOutcome<uint64_t>{
+      "Ok", write_scheduler_.Schedule(lines, level, deadline_ns)};
 }
 
-void Gpio::DestroyBinary() { binaries_.clear(); }
+bool Gpio::CancelWrite(uint64_t id) { return write_scheduler_.Cancel(id); }
+
+WriteScheduleStats Gpio::GetWriteScheduleStats() const {
+  return write_scheduler_.GetStats();
+}
 
 Gpio::PwmResult Gpio::CreatePwm(std::string channel, float frequency,
                                 float duty_cycle) {
-  if (curr_board_mode_ == BoardMode::UNKNONW) {
+  auto mode = curr_board_mode_.load();
+  if (mode == BoardMode::UNKNONW) {
     return PwmResult{"Board mode not set", nullptr};
   }
 
+  auto info = FindChannel(mode, channel);
+  if (info == nullptr) {
+    return PwmResult{"Channel " + channel + " not found", nullptr};
+  }
+
+  // Pre-check. Ensure all preconditions for creating PWM are met.
+  if (info->pwm_chip_dir == std::nullopt || info->chip_pwm_id == std::nullopt) {
+    return PwmResult{"Channel " + channel + " is not pwm capable", nullptr};
+  }
+
+  // as for binary channels, a creation in progress is waited for
+  std::unique_lock<std::shared_mutex> lock(registry_mutex_);
+  WaitPending(lock, channel);
   auto it = std::find_if(pwms_.begin(), pwms_.end(), [&](const auto& pwm) {
     return pwm->GetChannel() == channel;
   });
@@ -349,33 +775,196 @@ Gpio::PwmResult Gpio::CreatePwm(std::string channel, float frequency,
     return PwmResult{"Ok", it->get()};
   }
 
-  // Pre-check. Ensure all preconditions for creating PWM are met.
-
-  // if (channel_info.pwm_chip_dir == std::nullopt) {
-  //   return JResult{"pwm chip dir do not exist for channel " + channel,
-  //   false};
-  // }
+  pending_.insert(channel);
+  lock.unlock();
 
-  // if (channel_info.chip_pwm_id == std::nullopt) {
-  //   return JResult{"pwm chip id do not exist for channel " + channel, false};
-  // }
+  std::unique_ptr<PWMController> pwm;
+  try {
+    pwm = std::make_unique<PWMController>(*info, frequency, duty_cycle);
+  } catch (...) {
+    Release(channel);
+    throw;
+  }
 
-  pwms_.emplace_back(std::make_unique<PWMController>(
-      data_[curr_board_mode_][channel], frequency, duty_cycle));
+  lock.lock();
+  if (publisher_) pwm->AttachPublisher(publisher_.get());
+  if (flight_recorder_) {
+    pwm->AttachRecorder(flight_recorder_.get());
+    pwm->Record(FlightOp::CREATE_PWM);
+  }
+  pending_.erase(channel);
+  created_.notify_all();
+  pwms_.emplace_back(std::move(pwm));
   return PwmResult{"Ok", pwms_.back().get()};
 }
 
 void Gpio::DestroyPwm(std::string channel) {
-  auto it = std::find_if(pwms_.begin(), pwms_.end(), [&](const auto& pwm) {
-    return pwm->GetChannel() == channel;
-  });
+  std::unique_ptr<PWMController> pwm;
+  {
+    std::unique_lock<std::shared_mutex> lock(registry_mutex_);
+    auto it = std::find_if(pwms_.begin(), pwms_.end(), [&](const auto& pwm) {
+      return pwm->GetChannel() == channel;
+    });
+
+    if (it == pwms_.end()) return;
+    pwm = std::move(*it);
+    pwms_.erase(it);
+    pwm->Record(FlightOp::DESTROY_PWM);
+
+    pwm_groups_.remove_if(
+        [&](const auto& group) { return group->Contains(pwm.get()); });
+  }
 
-  if (it != pwms_.end()) {
-    (*it)->Stop();
+  pwm->Stop();
+}
+
+void Gpio::DestroyPwm() {
+  std::list<std::unique_ptr<PWMController>> pwms;
+  {
+    std::unique_lock<std::shared_mutex> lock(registry_mutex_);
+    pwm_groups_.clear();
+    pwms.swap(pwms_);
+  }
+
+  for (const auto& pwm : pwms) pwm->Record(FlightOp::DESTROY_PWM);
+  PWMController::Destroy(std::move(pwms));
+}
+
+Gpio::PwmGroupResult Gpio::CreatePwmGroup(
+    const std::vector<std::string>& channels) {
+  if (channels.empty()) return PwmGroupResult{"No channel given", nullptr};
+
+  std::unique_lock<std::shared_mutex> lock(registry_mutex_);
+
+  std::vector<PWMController*> pwms;
+  for (const auto& channel : channels) {
+    auto it = std::find_if(pwms_.begin(), pwms_.end(), [&](const auto& pwm) {
+      return pwm->GetChannel() == channel;
+    });
+
+    if (it == pwms_.end()) {
+      return PwmGroupResult{"Channel " + channel + " was not created",
+                            nullptr};
+    }
+
+    if (std::find(pwms.begin(), pwms.end(), it->get()) != pwms.end()) {
+      return PwmGroupResult{"Channel " + channel + " given twice", nullptr};
+    }
+    pwms.push_back(it->get());
+  }
+
+  pwm_groups_.emplace_back(std::make_unique<PwmGroup>(std::move(pwms)));
+  return PwmGroupResult{"Ok", pwm_groups_.back().get()};
+}
+
+void Gpio::DestroyPwmGroup(PwmGroup* group) {
+  std::unique_lock<std::shared_mutex> lock(registry_mutex_);
+  pwm_groups_.remove_if([&](const auto& g) { return g.get() == group; });
+}
+
+Gpio::ValueBatchResult Gpio::CreateValueBatch(
+    const std::vector<std::string>& channels, IoBackend backend) {
+  if (channels.empty()) return ValueBatchResult{"No channel given", nullptr};
+
+  std::unique_lock<std::shared_mutex> lock(registry_mutex_);
+
+  std::vector<BinaryController*> lines;
+  for (const auto& channel : channels) {
+    auto it = std::find_if(
+        binaries_.begin(), binaries_.end(),
+        [&](const auto& binary) { return binary->GetChannel() == channel; });
+
+    if (it == binaries_.end()) {
+      return ValueBatchResult{"Channel " + channel + " was not created",
+                              nullptr};
+    }
+
+    if (std::find(lines.begin(), lines.end(), it->get()) != lines.end()) {
+      return ValueBatchResult{"Channel " + channel + " given twice", nullptr};
+    }
+    lines.push_back(it->get());
+  }
+
+  try {
+    value_batches_.emplace_back(
+        std::make_unique<ValueBatch>(std::move(lines), backend));
+  } catch (const std::exception& e) {
+    return ValueBatchResult{e.what(), nullptr};
+  }
+  return ValueBatchResult{"Ok", value_batches_.back().get()};
+}
+
+void Gpio::DestroyValueBatch(ValueBatch* batch) {
+  std::unique_lock<std::shared_mutex> lock(registry_mutex_);
+  value_batches_.remove_if([&](const auto& b) { return b.get() == batch; });
+}
+
+Gpio::ScanCycleResult Gpio::CreateScanCycle(
+    const std::vector<std::string>& inputs,
+    const std::vector<std::string>& outputs, ScanCycle::Step step,
+    ScanCycleOptions options) {
+  if (inputs.empty() && outputs.empty()) {
+    return ScanCycleResult{"No channel given", nullptr};
+  }
+
+  if (event_loop_.load()) {
+    return ScanCycleResult{"No threads in event loop", nullptr};
+  }
+
+  auto checked = CheckRealtimeConfig(options.realtime);
+  if (!checked.second) return ScanCycleResult{checked.first, nullptr};
+
+  std::unique_lock<std::shared_mutex> lock(registry_mutex_);
+
+  std::vector<BinaryController*> lines[2];
+  const std::vector<std::string>* channels[2] = {&inputs, &outputs};
+  const Direction kDirections[2] = {Direction::IN, Direction::OUT};
+  for (int i = 0; i < 2; i++) {
+    for (const auto& channel : *channels[i]) {
+      auto it = std::find_if(
+          binaries_.begin(), binaries_.end(),
+          [&](const auto& binary) { return binary->GetChannel() == channel; });
+
+      if (it == binaries_.end()) {
+        return ScanCycleResult{"Channel " + channel + " was not created",
+                               nullptr};
+      }
+      if ((*it)->GetDirection() != kDirections[i]) {
+        return ScanCycleResult{"Channel " + channel + " is not an " +
+                                   (i == 0 ? "input" : "output"),
+                               nullptr};
+      }
+      if (std::find(lines[i].begin(), lines[i].end(), it->get()) !=
+          lines[i].end()) {
+        return ScanCycleResult{"Channel " + channel + " given twice",
+                               nullptr};
+      }
+      lines[i].push_back(it->get());
+    }
+  }
+
+  try {
+    scan_cycles_.emplace_back(std::make_unique<ScanCycle>(
+        std::move(lines[0]), std::move(lines[1]), std::move(step),
+        std::move(options)));
+  } catch (const std::exception& e) {
+    return ScanCycleResult{e.what(), nullptr};
   }
+  return ScanCycleResult{"Ok", scan_cycles_.back().get()};
+}
 
-  pwms_.erase(it);
+void Gpio::DestroyScanCycle(ScanCycle* cycle) {
+  std::list<std::unique_ptr<ScanCycle>> cycles;
+  {
+    std::unique_lock<std::shared_mutex> lock(registry_mutex_);
+    for (auto it = scan_cycles_.begin(); it != scan_cycles_.end(); ++it) {
+      if (it->get() == cycle) {
+        cycles.splice(cycles.end(), scan_cycles_, it);
+        break;
+      }
+    }
+  }
+  // stopped outside the lock
 }
 
-void Gpio::DestroyPwm() { pwms_.clear(); }
 }  // namespace jetson
@@ -32,21 +32,66 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <list>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
 #include <string>
+#include <vector>
 #include "binary_gpio.h"
+#include "flight_recorder.h"
+#include "metrics_exporter.h"
 #include "pwm.h"
+#include "pwm_group.h"
+#include "scan_cycle.h"
+#include "state_publisher.h"
 #include "types.h"
+#include "value_batch.h"
+#include "write_scheduler.h"
 
 namespace jetson {
 
+/**
+ * @brief Entry point of the library.
+ *
+ * Thread safety: Detect() and SetMode() belong to the setup phase and must
+ * not run concurrently with other calls. Afterwards the channels of a mode
+ * are gathered once on first use and immutable from then on, and creating,
+ * looking up and destroying controllers may happen from any thread; the
+ * registry is guarded by a reader/writer lock which is never held while a
+ * line is exported or unexported. Destroying a controller while another
+ * thread still uses it is not allowed. The controllers themselves are thread
+ * safe (see BinaryController and PWMController).
+ */
 class Gpio {
  public:
   using BinaryResult = JOutcome<BinaryController*>;
   using PwmResult = JOutcome<PWMController*>;
+  using PwmGroupResult = JOutcome<PwmGroup*>;
+  using ValueBatchResult = JOutcome<ValueBatch*>;
+  using ScanCycleResult = JOutcome<ScanCycle*>;
 
  public:
+  Gpio() = default;
+
+  /**
+   * @brief Construct a GPIO whose device-tree and sysfs paths are resolved
+   * under the given root directory instead of "/". This is mainly used to run
+   * against a simulated board (see sim_board.h).
+   *
+   * @param root The directory standing in for "/".
+   */
+  explicit Gpio(std::string root);
+
+  /**
+   * @brief Destroys every channel left, unexporting them in batches.
+   */
+  ~Gpio();
+
   /**
    * @brief Detect board type and gather board information
    *
@@ -56,7 +101,8 @@ class Gpio {
 
   /**
    * @brief Set the board mode. Once the board mode is set, it can't be changed
-   * anymore unless GPIO object is destroyed.
+   * anymore unless GPIO object is destroyed. The channels of the mode are
+   * gathered on first use.
    *
    * @param mode The board mode
    * @return The result of setting board mode
@@ -80,6 +126,15 @@ class Gpio {
    */
   BoardType GetBoardType() const;
 
+  /**
+   * @brief Get the gpio chips found by Detect(). Lines of chips the pin table
+   * of the board does not use are channels named "<label>:<offset>", in every
+   * board mode.
+   *
+   * @return chips ordered by base
+   */
+  const std::vector<GpioChip>& GetChips() const;
+
   /**
    * @brief Get the board mode
    *
@@ -96,7 +151,8 @@ class Gpio {
 
   /**
    * @brief Create a binary GPIO using RAII. The binary GPIO will be destroy
-   * automatically.
+   * automatically. Creating a channel that already exists in the same
+   * direction returns the existing controller.
    *
    * @param channel The channel where the binary GPIO will be created. The name
    * of the channel depends on the board mode.
@@ -109,6 +165,205 @@ class Gpio {
                             Signal initial_value = Signal::LOW,
                             Pull pull = Pull::OFF);
 
+  /**
+   * @brief Set the number of threads of the worker pool running
+   * CallbackMode::POOL callbacks. Only effective before the first such
+   * callback is registered.
+   *
+   * @param threads number of threads, 0 means one per core (default).
+   */
+  void SetCallbackThreads(int threads);
+
+  /**
+   * @brief Set scheduling policy, priority, cpu affinity and stack prefault
+   * of every thread the library starts: the edge monitor, the worker pool and
+   * the timer thread of scheduled writes. Only possible before the first
+   * callback is registered or write scheduled. The config is tried out first,
+   * so missing privileges are reported here. Locked memory stays locked for
+   * the lifetime of the process.
+   *
+   * @param config the config.
+   * @return The result of setting the config.
+   */
+  JResult SetRealtimeConfig(const RealtimeConfig& config);
+
+  /**
+   * @brief Run the library from the caller's event loop instead of its own
+   * threads: no edge monitor or timer thread is ever started. The caller
+   * polls GetPollFds() for readability and calls Dispatch() when any is
+   * ready; callbacks, reflexes and scheduled writes then run on the calling
+   * thread. CallbackMode::POOL callbacks, scan cycles and the metrics
+   * exporter need threads: RegisterCallback(), CreateScanCycle() and
+   * StartMetricsExporter() refuse them with an error. Only possible before
+   * any channel is created.
+   *
+   * @return The result of switching to the event loop.
+   */
+  JResult UseEventLoop();
+
+  /**
+   * @brief Get the fds to poll in event loop mode: the edge fd, reporting
+   * edges, and one fd aggregating the timers and wake-ups of the library.
+   *
+   * @return both fds, empty unless UseEventLoop() succeeded.
+   */
+  std::vector<int> GetPollFds() const;
+
+  /**
+   * @brief Handle what is ready in event loop mode: up to max_events edges,
+   * then expired latency bounds, delayed reflexes and scheduled writes that
+   * are due. Never blocks; call it again while it returns max_events.
+   *
+   * @param max_events most edges to handle, at least one.
+   * @return the number of edges handled and writes issued.
+   */
+  int Dispatch(int max_events = 64);
+
+  /**
+   * @brief Publish the state of every binary and pwm channel to a shared
+   * memory segment, for monitoring tools to read with PinStateReader (see
+   * pin_state.h) without any call into this process. Channels created later
+   * are published as well. Inputs are watched from then on so that their
+   * edges are counted. Publishing costs a writer a few stores per change.
+   *
+   * @param name name of the segment, see shm_open(3).
+   * @return The result of creating the segment.
+   */
+  JResult PublishState(const std::string& name = kPin_State_Name);
+
+  /**
+   * @brief Serve write and edge counts, callback drops and callback latency
+   * histograms of every binary channel in the Prometheus text format on a
+   * Unix domain socket. Lines count with relaxed atomics all the time; a
+   * scrape reads them without taking any lock of the write or edge paths.
+   *
+   * @param path path of the socket.
+   * @return The result of creating the socket.
+   */
+  JResult StartMetricsExporter(const std::string& path = kMetrics_Socket);
+
+  /**
+   * @brief Record every write, read, edge, pwm change, create and destroy of
+   * the channels from now on into per thread rings (see FlightRecorder). An
+   * operation costs a few stores, with no lock and no syscall.
+   *
+   * @param entries_per_thread how many operations each thread keeps.
+   * @return The result of starting the recorder.
+   */
+  JResult StartFlightRecorder(std::size_t entries_per_thread = kFlight_Entries);
+
+  /**
+   * @brief Write the operations recorded so far to a file, for
+   * LoadFlightDump() or the flight_decode tool.
+   *
+   * @param path the file.
+   * @return The result of writing the dump.
+   */
+  JResult DumpFlightRecorder(const std::string& path) const;
+
+  /**
+   * @brief Dump the recorded operations whenever a signal arrives and,
+   * optionally, when the process crashes.
+   *
+   * @param path the file, replaced by every dump.
+   * @param signo the signal requesting a dump, 0 for none.
+   * @param on_crash whether to dump on SIGSEGV, SIGBUS, SIGFPE, SIGILL and
+   * SIGABRT.
+   * @return The result of installing the signal handlers.
+   */
+  JResult DumpFlightRecorderOnSignal(const std::string& path,
+                                     int signo = SIGUSR2,
+                                     bool on_crash = true);
+
+  /**
+   * @brief Write a level to outputs at a given instant. All writes are issued
+   * by one timer thread; writes due at the same time go out back to back,
+   * grouped by gpio chip. The channels must have been created as outputs.
+   * Destroying a channel drops its pending writes.
+   *
+   * @param channels one or several output channels.
+   * @param level the level to write.
+   * @param deadline_ns when to write, on the clock of MonotonicNs().
+   * @return id of the scheduled write on success, 0 on failure.
+   */
+  JOutcome<uint64_t> ScheduleWrite(const std::vector<std::string>& channels,
+                                   Signal level, int64_t deadline_ns);
+
+  /**
+   * @brief Cancel a scheduled write.
+   *
+   * @param id id returned by ScheduleWrite.
+   * @return true if the write was still pending.
+   */
+  bool CancelWrite(uint64_t id);
+
+  /**
+   * @brief Get how many scheduled writes were issued and how late.
+   *
+   * @return statistics of the scheduled writes.
+   */
+  WriteScheduleStats GetWriteScheduleStats() const;
+
+  /**
+   * @brief Receive the edges of several binary channels in spans. All edges
+   * seen by one wake-up of the shared edge monitor are delivered in one span
+   * (split at options.max_batch), time stamped and tagged with the gpio
+   * number of their line. The channels must have been created already.
+   *
+   * @param channels the channels to watch.
+   * @param callback called on the edge monitor thread. It must not register
+   * callbacks or destroy channels.
+   * @param options batch size and latency bounds.
+   * @return id of the subscription on success, 0 on failure.
+   */
+  JOutcome<int> RegisterBatchCallback(const std::vector<std::string>& channels,
+                                      EdgeMonitor::BatchCallBack callback,
+                                      BatchOptions options = {});
+
+  /**
+   * @brief Remove a batch subscription. Edges not delivered yet are dropped.
+   *
+   * @param id id returned by RegisterBatchCallback.
+   */
+  void UnregisterBatchCallback(int id);
+
+  /**
+   * @brief Deliver edges to the callbacks of the watched lines and to the
+   * batch callbacks, as if the edge monitor had seen them in one wake-up.
+   * The lines themselves are not touched, reflexes fire as on real edges.
+   * Used to replay recorded edges, see EdgeReplayer.
+   *
+   * @param edges edges by global gpio number, in order.
+   */
+  void InjectEdges(EdgeSpan edges);
+
+  /**
+   * @brief Write an output on edges of an input, right from the edge monitor
+   * thread: no callback queue, no thread hop. Rules are compiled into one
+   * table of resolved controllers, ordered by input, which the monitor
+   * consults as soon as it reads an edge. Both channels must have been
+   * created already, as input and as output; the rule is removed with
+   * either of them.
+   *
+   * @param rule input, edge, output, level and an optional delay.
+   * @return id of the rule on success, 0 on failure.
+   */
+  JOutcome<int> AddReflex(const ReflexRule& rule);
+
+  /**
+   * @brief Remove a reflex rule. Delayed writes it already queued still
+   * happen.
+   *
+   * @param id id returned by AddReflex.
+   */
+  void RemoveReflex(int id);
+
+  /**
+   * @brief Get how many outputs reflexes wrote, how late delayed ones
+   * were and how many delayed writes were dropped for too many pending.
+   */
+  ReflexStats GetReflexStats() const;
+
   /**
    * @brief Destroy a binary gpio explicitly. No effect if given channel do not
    * exist or was not created. This might be useful if a channel was used for
@@ -119,7 +374,10 @@ class Gpio {
   void DestroyBinary(std::string channel);
 
   /**
-   * @brief Destroy all binary gpio explicitly.
+   * @brief Destroy all binary gpio explicitly. The lines are removed from the
+   * edge monitor under one lock and unexported through one open unexport
+   * file, saving the per line cost of destroying them one by one. Only a
+   * dispatch or callbacks still running are waited for.
    */
   void DestroyBinary();
 
@@ -145,17 +403,125 @@ class Gpio {
   void DestroyPwm(std::string channel);
 
   /**
-   * @brief Destroy all pwm controller explicitly.
+   * @brief Destroy all pwm controller explicitly, unexporting them through
+   * one open unexport file per pwm chip.
    */
   void DestroyPwm();
 
+  /**
+   * @brief Group pwm channels to update them together (see PwmGroup). The
+   * channels must have been created already. A group is destroyed along with
+   * any of its channels.
+   *
+   * @param channels the channels of the group.
+   * @return The result of group creation.
+   */
+  PwmGroupResult CreatePwmGroup(const std::vector<std::string>& channels);
+
+  /**
+   * @brief Destroy a pwm group explicitly. Its channels are left as they are.
+   *
+   * @param group the group returned by CreatePwmGroup.
+   */
+  void DestroyPwmGroup(PwmGroup* group);
+
+  /**
+   * @brief Batch binary channels to read, write and wait for edges on them
+   * with as few system calls as possible (see ValueBatch). The channels must
+   * have been created already. A batch is destroyed along with any of its
+   * channels.
+   *
+   * @param channels the channels of the batch.
+   * @param backend how the value files are accessed.
+   * @return The result of batch creation.
+   */
+  ValueBatchResult CreateValueBatch(const std::vector<std::string>& channels,
+                                    IoBackend backend = IoBackend::AUTO);
+
+  /**
+   * @brief Destroy a value batch explicitly.
+   *
+   * @param batch the batch returned by CreateValueBatch.
+   */
+  void DestroyValueBatch(ValueBatch* batch);
+
+  /**
+   * @brief Set up a fixed rate read, compute, write loop over binary
+   * channels (see ScanCycle). The channels must have been created already,
+   * the inputs as inputs and the outputs as outputs. The cycle is created
+   * stopped and destroyed along with any of its channels.
+   *
+   * @param inputs the channels of the input image.
+   * @param outputs the channels of the output image.
+   * @param step run every cycle on the scan thread.
+   * @param options period, backend and thread configuration.
+   * @return The result of scan cycle creation.
+   */
+  ScanCycleResult CreateScanCycle(const std::vector<std::string>& inputs,
+                                  const std::vector<std::string>& outputs,
+                                  ScanCycle::Step step,
+                                  ScanCycleOptions options = {});
+
+  /**
+   * @brief Stop and destroy a scan cycle explicitly.
+   *
+   * @param cycle the cycle returned by CreateScanCycle.
+   */
+  void DestroyScanCycle(ScanCycle* cycle);
+
  private:
+  const ChannelInfo* FindChannel(BoardMode mode,
+                                 const std::string& channel) const;
+  const std::map<std::string, ChannelInfo>* Channels(BoardMode mode) const;
+  void WaitPending(std::unique_lock<std::shared_mutex>& lock,
+                   const std::string& channel);
+  void Release(const std::string& channel);
+  void RenderMetrics(MetricsWriter& writer) const;
+  void CompileReflexes();  // with the registry locked
+
+ private:
+  std::string root_;
   BoardType type_ = BoardType::UNKNOWN;
-  ChannelData data_;
-  BoardMode curr_board_mode_ = BoardMode::UNKNONW;
+  std::vector<GpioChip> chips_;
+
+  // chip level facts gathered by Detect()
+  const std::vector<PinDef>* pin_defs_ = nullptr;
+  std::map<std::string, std::string> chip_dirs_;
+  std::map<std::string, int> chip_bases_;
+  std::map<std::string, std::string> pwm_dirs_;
+
+  // channels by board mode, each gathered on first use
+  struct ChannelIndex {
+    std::once_flag built[4];
+    std::map<std::string, ChannelInfo> channels[4];
+  };
+  std::unique_ptr<ChannelIndex> channels_;
+  std::atomic<BoardMode> curr_board_mode_{BoardMode::UNKNONW};
 
+  // declared before the controllers, which may still queue callbacks to them
+  RealtimeConfig realtime_;
+  CallbackPool callback_pool_;
+  EdgeMonitor edge_monitor_;
+  std::unique_ptr<StatePublisher> publisher_;  // guarded by the registry
+  std::unique_ptr<FlightRecorder> flight_recorder_;  // likewise
+  std::atomic<bool> event_loop_{false};
+
+  mutable std::shared_mutex registry_mutex_;
+  std::set<std::string> pending_;
+  std::condition_variable_any created_;  // a pending channel was released
   std::list<std::unique_ptr<BinaryController>> binaries_;
+  std::list<std::unique_ptr<ValueBatch>> value_batches_;  // before binaries
+  std::list<std::unique_ptr<ScanCycle>> scan_cycles_;      // likewise
   std::list<std::unique_ptr<PWMController>> pwms_;
+  std::list<std::unique_ptr<PwmGroup>> pwm_groups_;  // gone before the pwms
+  std::map<int, ReflexRule> reflexes_;  // by id
+  int next_reflex_ = 1;                 // 0 is never a valid id
+
+  // declared after the controllers, it writes to them until stopped
+  WriteScheduler write_scheduler_;
+
+  // gone first, it reads the controllers for every scrape
+  std::unique_ptr<MetricsExporter> metrics_exporter_;
 };
 
 }  // namespace jetson
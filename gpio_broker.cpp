@@ -0,0 +1,112 @@
+/**
+ * @file gpio_broker.cpp
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief Broker daemon serving the gpio lines of the board to other processes.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <signal.h>
+#include <iostream>
+#include <memory>
+#include <string>
+#include "broker.h"
+#include "gpio.h"
+#include "sim_board.h"
+
+namespace {
+
+void PrintUsage() {
+  std::cout << "Usage: gpio_broker [--name=NAME] [--mode=MODE]"
+               " [--simulate=nano|xavier]\n"
+               "  --name=NAME      shared memory name (default /jetson_gpio)\n"
+               "  --mode=MODE      board, bcm, cvm or tegra_soc (default "
+               "board)\n"
+               "  --simulate=NAME  serve a simulated board instead\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string name = jetson::kBroker_Name;
+  auto mode = jetson::BoardMode::BOARD;
+  std::unique_ptr<jetson::SimulatedBoard> board;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg.rfind("--name=", 0) == 0) {
+      name = arg.substr(7);
+    } else if (arg == "--mode=board") {
+      mode = jetson::BoardMode::BOARD;
+    } else if (arg == "--mode=bcm") {
+      mode = jetson::BoardMode::BCM;
+    } else if (arg == "--mode=cvm") {
+      mode = jetson::BoardMode::CVM;
+    } else if (arg == "--mode=tegra_soc") {
+      mode = jetson::BoardMode::TEGRA_SOC;
+    } else if (arg == "--simulate=nano") {
+      board = std::make_unique<jetson::SimulatedBoard>(
+          jetson::BoardType::JETSON_NANO);
+    } else if (arg == "--simulate=xavier") {
+      board = std::make_unique<jetson::SimulatedBoard>(
+          jetson::BoardType::JETSON_XAVIER);
+    } else {
+      PrintUsage();
+      return arg == "--help" ? 0 : -1;
+    }
+  }
+
+  // handled by sigwait below, blocked before any thread starts
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  jetson::Gpio gpio(board ? board->GetRoot() : std::string());
+  auto result = gpio.Detect();
+  if (result.second) result = gpio.SetMode(mode);
+  if (!result.second) {
+    std::cerr << "[ERROR]: " << result.first << std::endl;
+    return -1;
+  }
+
+  try {
+    jetson::GpioBroker broker(gpio, name);
+    std::cout << "Serving " << gpio.GetBoardName() << " at " << name;
+    if (board) std::cout << " (simulated under " << board->GetRoot() << ")";
+    std::cout << std::endl;
+
+    int signal = 0;
+    sigwait(&signals, &signal);
+  } catch (const std::exception& e) {
+    std::cerr << "[ERROR]: " << e.what() << std::endl;
+    return -1;
+  }
+
+  std::cout << "terminating" << std::endl;
+  return 0;
+}
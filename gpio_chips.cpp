@@ -0,0 +1,142 @@
+/**
+ * @file gpio_chips.cpp
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "gpio_chips.h"
+#include <fcntl.h>
+#include <linux/gpio.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdlib>
+#include <experimental/filesystem>
+#include <map>
+
+namespace fs = std::experimental::filesystem;
+
+namespace jetson {
+
+namespace {
+
+struct ChardevInfo {
+  std::string path;
+  std::string label;
+  int lines;
+};
+
+std::string ReadSmallFile(const std::string& path) {
+  char buffer[64];
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return "";
+  auto length = read(fd, buffer, sizeof(buffer));
+  close(fd);
+
+  std::string content(buffer, std::max<ssize_t>(0, length));
+  while (!content.empty() && content.back() == '\n') content.pop_back();
+  return content;
+}
+
+int ReadNumber(const std::string& path) {
+  auto content = ReadSmallFile(path);
+  return static_cast<int>(std::strtol(content.c_str(), nullptr, 10));
+}
+
+bool StartsWith(const std::string& s, const std::string& prefix) {
+  return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+// Character devices by the name of their device directory.
+std::map<std::string, ChardevInfo> ChardevsByDevice(const std::string& root) {
+  std::map<std::string, ChardevInfo> chardevs;
+  std::error_code ec;
+  for (auto it = fs::directory_iterator(root + "/dev", ec);
+       !ec && it != fs::directory_iterator(); it.increment(ec)) {
+    auto name = it->path().filename().string();
+    if (!StartsWith(name, "gpiochip")) continue;
+
+    int fd = open(it->path().c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) continue;
+    struct gpiochip_info info = {};
+    int result = ioctl(fd, GPIO_GET_CHIPINFO_IOCTL, &info);
+    close(fd);
+    if (result < 0) continue;
+
+    // /sys/bus/gpio/devices/gpiochipN links to <device dir>/gpiochipN
+    auto link = fs::read_symlink(
+        root + "/sys/bus/gpio/devices/" + std::string(info.name), ec);
+    if (ec) continue;
+    chardevs[link.parent_path().filename().string()] =
+        ChardevInfo{it->path().string(), info.label,
+                    static_cast<int>(info.lines)};
+  }
+  return chardevs;
+}
+
+}  // namespace
+
+std::vector<GpioChip> EnumerateGpioChips(const std::string& root) {
+  auto chardevs = ChardevsByDevice(root);
+
+  std::vector<GpioChip> chips;
+  std::error_code ec;
+  const auto kClassDir = root + kSysfs_Root;
+  for (auto it = fs::directory_iterator(kClassDir, ec);
+       !ec && it != fs::directory_iterator(); it.increment(ec)) {
+    auto name = it->path().filename().string();
+    if (!StartsWith(name, "gpiochip")) continue;
+
+    std::error_code link_ec;
+    auto dir = fs::canonical(it->path() / "device", link_ec);
+    if (link_ec) continue;
+
+    GpioChip chip;
+    chip.name = name;
+    chip.device = dir.filename().string();
+    chip.dir = dir.string();
+    chip.base = ReadNumber(it->path().string() + "/base");
+
+    auto chardev = chardevs.find(chip.device);
+    if (chardev != chardevs.end()) {
+      chip.label = chardev->second.label;
+      chip.ngpio = chardev->second.lines;
+      chip.chardev = chardev->second.path;
+    } else {
+      chip.label = ReadSmallFile(it->path().string() + "/label");
+      chip.ngpio = ReadNumber(it->path().string() + "/ngpio");
+    }
+    chips.push_back(std::move(chip));
+  }
+
+  std::sort(chips.begin(), chips.end(),
+            [](const auto& a, const auto& b) { return a.base < b.base; });
+  return chips;
+}
+
+}  // namespace jetson
@@ -0,0 +1,140 @@
+/**
+ * @file inplace_function.h
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace jetson {
+
+// Capacity of callbacks stored by the library, enough for a std::function or
+// a handful of captured pointers.
+static constexpr std::size_t kInplace_Function_Capacity = 48;
+
+template <typename Signature,
+          std::size_t Capacity = kInplace_Function_Capacity>
+class InplaceFunction;
+
+/**
+ * @brief A copyable callable wrapper like std::function, except that the
+ * callable is always stored inside the object and never on the heap. Callables
+ * larger than the capacity are rejected at compile time.
+ */
+template <typename R, typename... Args, std::size_t Capacity>
+class InplaceFunction<R(Args...), Capacity> {
+ public:
+  InplaceFunction() = default;
+  InplaceFunction(std::nullptr_t) {}
+
+  template <typename F,
+            typename T = std::decay_t<F>,
+            typename = std::enable_if_t<
+                !std::is_same<T, InplaceFunction>::value &&
+                std::is_invocable_r<R, T&, Args...>::value>>
+  InplaceFunction(F&& f) {
+    static_assert(sizeof(T) <= Capacity,
+                  "callable does not fit into the InplaceFunction");
+    static_assert(alignof(T) <= alignof(std::max_align_t),
+                  "callable is over aligned");
+    new (&storage_) T(std::forward<F>(f));
+    ops_ = &kOps<T>;
+  }
+
+  InplaceFunction(const InplaceFunction& other) : ops_(other.ops_) {
+    if (ops_) ops_->copy(&storage_, &other.storage_);
+  }
+
+  InplaceFunction(InplaceFunction&& other) noexcept : ops_(other.ops_) {
+    if (ops_) ops_->move(&storage_, &other.storage_);
+  }
+
+  ~InplaceFunction() { Reset(); }
+
+  InplaceFunction& operator=(const InplaceFunction& other) {
+    if (this != &other) {
+      Reset();
+      if (other.ops_) other.ops_->copy(&storage_, &other.storage_);
+      ops_ = other.ops_;
+    }
+    return *this;
+  }
+
+  InplaceFunction& operator=(InplaceFunction&& other) noexcept {
+    if (this != &other) {
+      Reset();
+      if (other.ops_) other.ops_->move(&storage_, &other.storage_);
+      ops_ = other.ops_;
+    }
+    return *this;
+  }
+
+  R operator()(Args... args) const {
+    if (!ops_) throw std::bad_function_call();
+    return ops_->invoke(&storage_, std::forward<Args>(args)...);
+  }
+
+  explicit operator bool() const { return ops_ != nullptr; }
+
+ private:
+  struct Ops {
+    R (*invoke)(void*, Args&&...);
+    void (*copy)(void*, const void*);
+    void (*move)(void*, void*);
+    void (*destroy)(void*);
+  };
+
+  template <typename T>
+  static constexpr Ops kOps = {
+      [](void* f, Args&&... args) -> R {
+        return (*static_cast<T*>(f))(std::forward<Args>(args)...);
+      },
+      [](void* to, const void* from) {
+        new (to) T(*static_cast<const T*>(from));
+      },
+      [](void* to, void* from) {
+        new (to) T(std::move(*static_cast<T*>(from)));
+      },
+      [](void* f) { static_cast<T*>(f)->~T(); }};
+
+  void Reset() {
+    if (ops_) ops_->destroy(&storage_);
+    ops_ = nullptr;
+  }
+
+  // mutable like the target of std::function, which may be a stateful lambda
+  mutable std::aligned_storage_t<Capacity, alignof(std::max_align_t)> storage_;
+  const Ops* ops_ = nullptr;
+};
+
+}  // namespace jetson
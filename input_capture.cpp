@@ -0,0 +1,262 @@
+/**
+ * @file input_capture.cpp
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "input_capture.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+namespace jetson {
+
+void InputCapture::Histogram::Add(int64_t ns) {
+  ns = std::max<int64_t>(0, ns);
+  auto count = count_.load(std::memory_order_relaxed);
+  if (count == 0 || ns < min_.load(std::memory_order_relaxed)) {
+    min_.store(ns, std::memory_order_relaxed);
+  }
+  if (count == 0 || ns > max_.load(std::memory_order_relaxed)) {
+    max_.store(ns, std::memory_order_relaxed);
+  }
+
+  sum_.fetch_add(static_cast<uint64_t>(ns), std::memory_order_relaxed);
+  buckets_[Bucket(static_cast<uint64_t>(ns))].fetch_add(
+      1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_release);
+}
+
+void InputCapture::Histogram::Reset() {
+  count_.store(0, std::memory_order_relaxed);
+  sum_.store(0, std::memory_order_relaxed);
+  min_.store(0, std::memory_order_relaxed);
+  max_.store(0, std::memory_order_relaxed);
+  for (auto& bucket : buckets_) bucket.store(0, std::memory_order_relaxed);
+}
+
+CaptureStats InputCapture::Histogram::Get() const {
+  CaptureStats stats{};
+  stats.count = count_.load(std::memory_order_acquire);
+  if (stats.count == 0) return stats;
+
+  stats.min_ns = min_.load(std::memory_order_relaxed);
+  stats.max_ns = max_.load(std::memory_order_relaxed);
+  stats.mean_ns =
+      static_cast<double>(sum_.load(std::memory_order_relaxed)) / stats.count;
+
+  // The buckets may run slightly ahead of the count while edges come in.
+  uint64_t total = 0;
+  uint64_t snapshot[kBuckets];
+  for (int i = 0; i < kBuckets; i++) {
+    snapshot[i] = buckets_[i].load(std::memory_order_relaxed);
+    total += snapshot[i];
+  }
+
+  const double kPercentiles[] = {0.5, 0.9, 0.99};
+  int64_t* results[] = {&stats.p50_ns, &stats.p90_ns, &stats.p99_ns};
+  for (int p = 0; p < 3; p++) {
+    auto rank = std::max<uint64_t>(
+        1, static_cast<uint64_t>(std::ceil(kPercentiles[p] * total)));
+    uint64_t seen = 0;
+    for (int i = 0; i < kBuckets; i++) {
+      seen += snapshot[i];
+      if (seen >= rank) {
+        *results[p] =
+            std::min(std::max(Middle(i), stats.min_ns), stats.max_ns);
+        break;
+      }
+    }
+  }
+  return stats;
+}
+
+int InputCapture::Histogram::Bucket(uint64_t ns) {
+  constexpr uint64_t kSub = 1 << kSub_Bits;
+  if (ns < kSub) return static_cast<int>(ns);
+
+  int msb = 63 - __builtin_clzll(ns);
+  auto sub = (ns >> (msb - kSub_Bits)) & (kSub - 1);
+  return static_cast<int>((msb - kSub_Bits + 1) * kSub + sub);
+}
+
+int64_t InputCapture::Histogram::Middle(int bucket) {
+  constexpr int kSub = 1 << kSub_Bits;
+  if (bucket < kSub) return bucket;
+
+  int group = bucket / kSub;
+  int64_t width = int64_t{1} << (group - 1);
+  return (kSub + bucket % kSub) * width + width / 2;
+}
+
+InputCapture::InputCapture(Gpio& gpio, const std::string& channel, Pull pull)
+    : gpio_(gpio) {
+  auto input = gpio.CreateBinary(channel, Direction::IN, Signal::LOW, pull);
+  if (!input.second) throw std::runtime_error(input.first);
+  gpio_num_ = gpio.GetChannelInfo(gpio.GetBoardMode(), channel).gpio;
+  level_ = input.second->Read();
+
+  auto result = gpio.RegisterBatchCallback(
+      {channel}, [this](EdgeSpan edges) { Capture(edges); });
+  if (!result.second) throw std::runtime_error(result.first);
+  subscription_ = result.second;
+}
+
+InputCapture::~InputCapture() { gpio_.UnregisterBatchCallback(subscription_); }
+
+CaptureStats InputCapture::GetHighTime() const {
+  return ResetPending() ? CaptureStats{} : high_.Get();
+}
+
+CaptureStats InputCapture::GetLowTime() const {
+  return ResetPending() ? CaptureStats{} : low_.Get();
+}
+
+CaptureStats InputCapture::GetPeriod() const {
+  return ResetPending() ? CaptureStats{} : period_.Get();
+}
+
+double InputCapture::GetFrequency() const {
+  if (ResetPending()) return 0;
+  auto period = last_period_ns_.load(std::memory_order_relaxed);
+  return period > 0 ? 1e9 / period : 0;
+}
+
+double InputCapture::CountFrequency(std::chrono::nanoseconds gate) const {
+  auto read = [this](uint64_t* count, int64_t* ns) {
+    uint64_t seq = 0;
+    do {
+      seq = rising_seq_.load(std::memory_order_acquire);
+      *count = rising_count_.load(std::memory_order_relaxed);
+      *ns = rising_ns_.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1) || seq != rising_seq_.load(std::memory_order_relaxed));
+  };
+
+  uint64_t first_count = 0;
+  uint64_t last_count = 0;
+  int64_t first_ns = 0;
+  int64_t last_ns = 0;
+  read(&first_count, &first_ns);
+  std::this_thread::sleep_for(gate);
+  read(&last_count, &last_ns);
+
+  // From the last rising edge before the gate to the last one inside it, so
+  // that a whole number of periods is counted.
+  if (first_count == 0 || last_count == first_count) return 0;
+  return 1e9 * (last_count - first_count) / (last_ns - first_ns);
+}
+
+JOutcome<int64_t> InputCapture::MeasurePulse(Signal level,
+                                             std::chrono::nanoseconds timeout) {
+  const int kLevel = level == Signal::HIGH ? 1 : 0;
+
+  std::unique_lock<std::mutex> lock(pulse_mutex_);
+  waiters_.fetch_add(1);
+  // Pulses are only recorded while someone waits.
+  const auto kStart = MonotonicNs();
+  bool done = pulse_done_.wait_for(
+      lock, timeout, [&] { return pulse_start_ns_[kLevel] >= kStart; });
+  waiters_.fetch_sub(1);
+
+  if (!done) return JOutcome<int64_t>{"Timeout", 0};
+  return JOutcome<int64_t>{"Ok", pulse_width_ns_[kLevel]};
+}
+
+void InputCapture::Reset() {
+  resets_requested_.fetch_add(1, std::memory_order_release);
+}
+
+bool InputCapture::ResetPending() const {
+  return resets_done_.load(std::memory_order_acquire) !=
+         resets_requested_.load(std::memory_order_acquire);
+}
+
+void InputCapture::Capture(EdgeSpan edges) {
+  auto requested = resets_requested_.load(std::memory_order_acquire);
+  if (requested != resets_done_.load(std::memory_order_relaxed)) {
+    high_.Reset();
+    low_.Reset();
+    period_.Reset();
+    last_period_ns_.store(0, std::memory_order_relaxed);
+    last_rising_ns_ = 0;
+    last_falling_ns_ = 0;
+    resets_done_.store(requested, std::memory_order_release);
+  }
+
+  for (const auto& e : edges) {
+    // Edges reported together with the same value were merged by the kernel.
+    if (e.gpio != gpio_num_ || e.value == level_) continue;
+    level_ = e.value;
+
+    if (e.value) {
+      if (last_falling_ns_) {
+        Complete(Signal::LOW, last_falling_ns_, e.timestamp_ns);
+      }
+      if (last_rising_ns_) {
+        period_.Add(e.timestamp_ns - last_rising_ns_);
+        last_period_ns_.store(e.timestamp_ns - last_rising_ns_,
+                              std::memory_order_relaxed);
+      }
+      last_rising_ns_ = e.timestamp_ns;
+
+      auto seq = rising_seq_.load(std::memory_order_relaxed);
+      rising_seq_.store(seq + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      rising_count_.fetch_add(1, std::memory_order_relaxed);
+      rising_ns_.store(e.timestamp_ns, std::memory_order_relaxed);
+      rising_seq_.store(seq + 2, std::memory_order_release);
+    } else {
+      if (last_rising_ns_) {
+        Complete(Signal::HIGH, last_rising_ns_, e.timestamp_ns);
+      }
+      last_falling_ns_ = e.timestamp_ns;
+    }
+  }
+}
+
+void InputCapture::Complete(Signal level, int64_t start_ns, int64_t end_ns) {
+  if (level == Signal::HIGH) {
+    high_.Add(end_ns - start_ns);
+  } else {
+    low_.Add(end_ns - start_ns);
+  }
+
+  if (waiters_.load() > 0) {
+    const int kLevel = level == Signal::HIGH ? 1 : 0;
+    {
+      std::lock_guard<std::mutex> lock(pulse_mutex_);
+      pulse_start_ns_[kLevel] = start_ns;
+      pulse_width_ns_[kLevel] = end_ns - start_ns;
+    }
+    pulse_done_.notify_all();
+  }
+}
+
+}  // namespace jetson
@@ -0,0 +1,197 @@
+/**
+ * @file input_capture.h
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include "gpio.h"
+#include "types.h"
+
+namespace jetson {
+
+struct CaptureStats {
+  uint64_t count;
+  int64_t min_ns;
+  int64_t max_ns;
+  double mean_ns;
+  // Percentiles are accurate to 1/8 of their power of two.
+  int64_t p50_ns;
+  int64_t p90_ns;
+  int64_t p99_ns;
+};
+
+/**
+ * @brief Measures the signal on an input: high time, low time, period and
+ * frequency. Edges are captured on the edge monitor thread from their time
+ * stamps; statistics are kept in fixed size histograms and are readable
+ * without locking from any thread.
+ *
+ * Time stamps are taken when the edge monitor wakes up, so the resolution is
+ * bound by its wake-up latency.
+ */
+class InputCapture {
+ public:
+  /**
+   * @brief Create (or reuse) the input channel and start capturing. Throws if
+   * the channel can't be created as an input.
+   *
+   * @param gpio the gpio the channel belongs to. Must outlive the capture.
+   * @param channel the input channel.
+   * @param pull pull up/down of the input.
+   */
+  InputCapture(Gpio& gpio, const std::string& channel, Pull pull = Pull::OFF);
+  ~InputCapture();
+
+  /**
+   * @brief Statistics of the time between a rising and the next falling edge.
+   */
+  CaptureStats GetHighTime() const;
+
+  /**
+   * @brief Statistics of the time between a falling and the next rising edge.
+   */
+  CaptureStats GetLowTime() const;
+
+  /**
+   * @brief Statistics of the time between two rising edges.
+   */
+  CaptureStats GetPeriod() const;
+
+  /**
+   * @brief Get the frequency from the last period.
+   *
+   * @return frequency in hz, 0 if no period was seen.
+   */
+  double GetFrequency() const;
+
+  /**
+   * @brief Count rising edges for the gate time and compute the frequency
+   * from the time between the first and the last of them. Better suited than
+   * GetFrequency() for high rates. Blocks for the gate time.
+   *
+   * @param gate the gate time.
+   * @return frequency in hz, 0 if no rising edge was seen before and during
+   * the gate.
+   */
+  double CountFrequency(std::chrono::nanoseconds gate) const;
+
+  /**
+   * @brief Wait for the next complete pulse of the given level starting after
+   * the call.
+   *
+   * @param level high for a rising to falling pulse, low for falling to rising.
+   * @param timeout how long to wait at most.
+   * @return the pulse width in nano seconds on success.
+   */
+  JOutcome<int64_t> MeasurePulse(Signal level,
+                                 std::chrono::nanoseconds timeout);
+
+  /**
+   * @brief Clear all statistics. Safe from any thread: the histograms are
+   * single writer, so the clearing is left to the next Capture(). Until then
+   * the statistics read as empty and GetFrequency() returns 0. Pulses are
+   * measured from edges after the reset only.
+   */
+  void Reset();
+
+  /**
+   * @brief Capture a span of edges. Called by the edge monitor; also useful
+   * to feed recorded edges. Must not be called concurrently with itself.
+   *
+   * @param edges edges of the input line, others are ignored.
+   */
+  void Capture(EdgeSpan edges);
+
+ private:
+  InputCapture(const InputCapture&) = delete;
+  InputCapture(InputCapture&&) = delete;
+
+ private:
+  // Log-linear histogram of durations with a single writer.
+  class Histogram {
+   public:
+    void Add(int64_t ns);
+    void Reset();
+    CaptureStats Get() const;
+
+   private:
+    static constexpr int kSub_Bits = 3;
+    static constexpr int kBuckets = (64 - kSub_Bits) * (1 << kSub_Bits);
+
+    static int Bucket(uint64_t ns);
+    static int64_t Middle(int bucket);
+
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<int64_t> min_{0};
+    std::atomic<int64_t> max_{0};
+    std::atomic<uint64_t> buckets_[kBuckets] = {};
+  };
+
+  void Complete(Signal level, int64_t start_ns, int64_t end_ns);
+  bool ResetPending() const;
+
+ private:
+  Gpio& gpio_;
+  int gpio_num_ = -1;
+  int subscription_ = 0;
+
+  // Reset() requests, the last one carried out by Capture
+  std::atomic<uint64_t> resets_requested_{0};
+  std::atomic<uint64_t> resets_done_{0};
+
+  // only touched by Capture
+  int level_ = -1;
+  int64_t last_rising_ns_ = 0;
+  int64_t last_falling_ns_ = 0;
+
+  Histogram high_;
+  Histogram low_;
+  Histogram period_;
+  std::atomic<int64_t> last_period_ns_{0};
+  // rising edge count and time of the last, consistent under rising_seq_
+  std::atomic<uint64_t> rising_seq_{0};
+  std::atomic<uint64_t> rising_count_{0};
+  std::atomic<int64_t> rising_ns_{0};
+
+  // single shot measurements
+  std::atomic<int> waiters_{0};
+  std::mutex pulse_mutex_;
+  std::condition_variable pulse_done_;
+  int64_t pulse_start_ns_[2] = {0, 0};  // by level
+  int64_t pulse_width_ns_[2] = {0, 0};
+};
+
+}  // namespace jetson
@@ -0,0 +1,161 @@
+/**
+ * @file io_uring.cpp
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "io_uring.h"
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace jetson {
+
+IoUring::IoUring(unsigned entries) {
+  struct io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+  if (fd_ < 0) throw std::runtime_error("io_uring is not available.");
+
+  // multishot poll came along with resource tags, a timeout with ext arg
+  const unsigned kFeatures =
+      IORING_FEAT_SINGLE_MMAP | IORING_FEAT_EXT_ARG | IORING_FEAT_RSRC_TAGS;
+  if ((params.features & kFeatures) != kFeatures) {
+    close(fd_);
+    throw std::runtime_error("io_uring lacks the features needed.");
+  }
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if (cq_ring_size_ > sq_ring_size_) sq_ring_size_ = cq_ring_size_;
+  sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+  void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+  if (sq_ring_ == MAP_FAILED || sqes == MAP_FAILED) {
+    if (sq_ring_ != MAP_FAILED) munmap(sq_ring_, sq_ring_size_);
+    if (sqes != MAP_FAILED) munmap(sqes, sqes_size_);
+    close(fd_);
+    throw std::runtime_error("map io_uring failed.");
+  }
+  cq_ring_ = sq_ring_;
+  sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+  auto sq = static_cast<char*>(sq_ring_);
+  sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  sq_entries_ = params.sq_entries;
+  sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+  auto cq = static_cast<char*>(cq_ring_);
+  cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+}
+
+IoUring::~IoUring() {
+  munmap(sqes_, sqes_size_);
+  munmap(sq_ring_, sq_ring_size_);
+  close(fd_);
+}
+
+bool IoUring::RegisterFiles(const std::vector<int>& fds) {
+  return syscall(__NR_io_uring_register, fd_, IORING_REGISTER_FILES,
+                 fds.data(), static_cast<unsigned>(fds.size())) == 0;
+}
+
+bool IoUring::RegisterBuffer(void* data, std::size_t size) {
+  struct iovec buffer = {data, size};
+  return syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS,
+                 &buffer, 1) == 0;
+}
+
+struct io_uring_sqe* IoUring::Next() {
+  // only this thread moves the tail, the kernel moves the head
+  auto head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+  auto tail = *sq_tail_ + prepared_;
+  if (tail - head >= sq_entries_) return nullptr;
+
+  auto index = tail & sq_mask_;
+  auto sqe = &sqes_[index];
+  std::memset(sqe, 0, sizeof(*sqe));
+  sq_array_[index] = index;
+  prepared_++;
+  return sqe;
+}
+
+int IoUring::Enter(unsigned wait, int64_t timeout_ns) {
+  __atomic_store_n(sq_tail_, *sq_tail_ + prepared_, __ATOMIC_RELEASE);
+  auto submit = prepared_;
+  prepared_ = 0;
+
+  unsigned flags = wait > 0 ? IORING_ENTER_GETEVENTS : 0;
+  struct __kernel_timespec ts;
+  struct io_uring_getevents_arg arg;
+  std::memset(&arg, 0, sizeof(arg));
+  if (wait > 0 && timeout_ns >= 0) {
+    ts.tv_sec = timeout_ns / 1000000000;
+    ts.tv_nsec = timeout_ns % 1000000000;
+    arg.sigmask_sz = _NSIG / 8;
+    arg.ts = reinterpret_cast<uint64_t>(&ts);
+    flags |= IORING_ENTER_EXT_ARG;
+  }
+
+  while (true) {
+    long result =
+        flags & IORING_ENTER_EXT_ARG
+            ? syscall(__NR_io_uring_enter, fd_, submit, wait, flags, &arg,
+                      sizeof(arg))
+            : syscall(__NR_io_uring_enter, fd_, submit, wait, flags, nullptr,
+                      0);
+    if (result >= 0) return static_cast<int>(result);
+    if (errno != EINTR) return -errno;
+    submit = 0;  // taken before the wait was interrupted
+  }
+}
+
+bool IoUring::Reap(struct io_uring_cqe* cqe) {
+  auto head = *cq_head_;
+  if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) return false;
+
+  *cqe = cqes_[head & cq_mask_];
+  __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+}  // namespace jetson
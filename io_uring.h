@@ -0,0 +1,123 @@
+/**
+ * @file io_uring.h
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <linux/io_uring.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace jetson {
+
+/**
+ * @brief A minimal io_uring, set up with raw system calls so that no library
+ * is needed. Not thread safe: one thread prepares, submits and reaps.
+ */
+class IoUring {
+ public:
+  /**
+   * @brief Set the ring up. Throws if io_uring is not available, or lacks
+   * multishot poll and waiting with a timeout (Linux 5.13 and newer).
+   *
+   * @param entries submission queue entries, rounded up to a power of two.
+   */
+  explicit IoUring(unsigned entries);
+  ~IoUring();
+
+  /**
+   * @brief Register files, used with IOSQE_FIXED_FILE and their index.
+   *
+   * @param fds the file descriptors.
+   * @return false on failure.
+   */
+  bool RegisterFiles(const std::vector<int>& fds);
+
+  /**
+   * @brief Register a buffer, used with the fixed read and write ops and
+   * buffer index 0.
+   *
+   * @param data start of the buffer.
+   * @param size size of the buffer.
+   * @return false on failure.
+   */
+  bool RegisterBuffer(void* data, std::size_t size);
+
+  /**
+   * @brief Get the next submission entry, cleared.
+   *
+   * @return the entry, nullptr if the submission queue is full.
+   */
+  struct io_uring_sqe* Next();
+
+  /**
+   * @brief Submit the prepared entries and wait for completions.
+   *
+   * @param wait completions to wait for.
+   * @param timeout_ns how long to wait at most, negative for no limit.
+   * @return entries submitted, or -errno; -ETIME when the wait timed out.
+   */
+  int Enter(unsigned wait, int64_t timeout_ns = -1);
+
+  /**
+   * @brief Take a completion.
+   *
+   * @param cqe filled with the completion.
+   * @return false if none is there.
+   */
+  bool Reap(struct io_uring_cqe* cqe);
+
+ private:
+  IoUring(const IoUring&) = delete;
+  IoUring(IoUring&&) = delete;
+
+ private:
+  int fd_ = -1;
+  void* sq_ring_ = nullptr;
+  std::size_t sq_ring_size_ = 0;
+  void* cq_ring_ = nullptr;  // the same mapping as sq_ring_
+  std::size_t cq_ring_size_ = 0;
+  struct io_uring_sqe* sqes_ = nullptr;
+  std::size_t sqes_size_ = 0;
+
+  unsigned* sq_head_ = nullptr;
+  unsigned* sq_tail_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned sq_entries_ = 0;
+  unsigned* sq_array_ = nullptr;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  struct io_uring_cqe* cqes_ = nullptr;
+  unsigned prepared_ = 0;  // entries not submitted yet
+};
+
+}  // namespace jetson
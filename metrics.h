@@ -0,0 +1,98 @@
+/**
+ * @file metrics.h
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace jetson {
+
+/**
+ * @brief A latency histogram with power of two buckets from 1 us up, updated
+ * with relaxed atomics only, so that recording never blocks and a reader
+ * never holds up the recording thread.
+ */
+class LatencyHistogram {
+ public:
+  static constexpr int kBuckets = 20;  // 1 us to 524 ms, then +Inf
+
+  /**
+   * @brief Upper bound of a bucket.
+   *
+   * @param bucket index of the bucket, below kBuckets.
+   * @return the bound in nano seconds.
+   */
+  static constexpr int64_t BoundNs(int bucket) {
+    return int64_t{1000} << bucket;
+  }
+
+  void Record(int64_t ns) {
+    int bucket = 0;
+    while (bucket < kBuckets && ns > BoundNs(bucket)) bucket++;
+    counts_[bucket].fetch_add(1, std::memory_order_relaxed);
+    sum_ns_.fetch_add(ns > 0 ? ns : 0, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Get the samples of one bucket, not cumulative.
+   *
+   * @param bucket up to kBuckets, which is +Inf.
+   */
+  uint64_t Count(int bucket) const {
+    return counts_[bucket].load(std::memory_order_relaxed);
+  }
+
+  uint64_t SumNs() const { return sum_ns_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<uint64_t> counts_[kBuckets + 1] = {};
+  std::atomic<uint64_t> sum_ns_{0};
+};
+
+/**
+ * @brief Counters of a binary line, exported by MetricsExporter. Written by
+ * the line with relaxed atomics; the labels are rendered once when the line
+ * is created.
+ */
+struct LineMetrics {
+  std::string labels;  // e.g. channel="12",gpio="79"
+  std::atomic<uint64_t> writes{0};
+  std::atomic<uint64_t> rising_edges{0};
+  std::atomic<uint64_t> falling_edges{0};
+  std::atomic<uint64_t> callbacks{0};
+  std::atomic<uint64_t> dropped{0};  // oldest or newest, see OverflowPolicy
+  std::atomic<uint64_t> coalesced{0};
+  LatencyHistogram callback_latency;  // edge to start of the callback
+};
+
+}  // namespace jetson
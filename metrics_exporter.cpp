@@ -0,0 +1,219 @@
+/**
+ * @file metrics_exporter.cpp
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "metrics_exporter.h"
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace jetson {
+
+// How long a scraper may take to send its request.
+static const int kRequest_Timeout_Ms = 100;
+
+// Room for the metrics of a fully used header before the first scrape.
+static const std::size_t kInitial_Body = 64 << 10;
+
+void MetricsWriter::Family(const char* name, const char* type,
+                           const char* help) {
+  out_->append("# HELP ").append(name).append(" ").append(help);
+  out_->append("\n# TYPE ").append(name).append(" ").append(type);
+  out_->push_back('\n');
+}
+
+void MetricsWriter::Sample(const char* name, const std::string& labels,
+                           const char* extra, uint64_t value) {
+  out_->append(name);
+  Labels(labels, extra);
+  Number(value);
+}
+
+void MetricsWriter::Histogram(const char* name, const std::string& labels,
+                              const LatencyHistogram& histogram) {
+  uint64_t count = 0;
+  for (int i = 0; i <= LatencyHistogram::kBuckets; i++) {
+    count += histogram.Count(i);
+
+    char le[32];
+    if (i < LatencyHistogram::kBuckets) {
+      auto seconds = LatencyHistogram::BoundNs(i) / 1e9;
+      *std::to_chars(le, le + sizeof(le) - 1, seconds).ptr = '\0';
+    } else {
+      std::strcpy(le, "+Inf");
+    }
+
+    out_->append(name).append("_bucket");
+    Labels(labels, nullptr, le);
+    Number(count);
+  }
+
+  out_->append(name).append("_sum");
+  Labels(labels, nullptr);
+  Number(histogram.SumNs() / 1e9);
+
+  out_->append(name).append("_count");
+  Labels(labels, nullptr);
+  Number(count);
+}
+
+void MetricsWriter::Labels(const std::string& labels, const char* extra,
+                           const char* le) {
+  if (labels.empty() && !extra && !le) {
+    out_->push_back(' ');
+    return;
+  }
+
+  out_->push_back('{');
+  out_->append(labels);
+  if (extra) {
+    if (!labels.empty()) out_->push_back(',');
+    out_->append(extra);
+  }
+  if (le) {
+    if (!labels.empty() || extra) out_->push_back(',');
+    out_->append("le=\"").append(le).push_back('"');
+  }
+  out_->append("} ");
+}
+
+void MetricsWriter::Number(uint64_t value) {
+  char digits[24];
+  auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+  out_->append(digits, end - digits).push_back('\n');
+}
+
+void MetricsWriter::Number(double value) {
+  char digits[32];
+  auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+  out_->append(digits, end - digits).push_back('\n');
+}
+
+MetricsExporter::MetricsExporter(std::string path, Render render)
+    : path_(std::move(path)), render_(std::move(render)) {
+  struct sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (path_.size() >= sizeof(address.sun_path)) {
+    throw std::invalid_argument("socket path " + path_ + " too long.");
+  }
+  std::memcpy(address.sun_path, path_.c_str(), path_.size());
+
+  listen_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  wakeup_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  unlink(path_.c_str());  // left over by a previous process
+  if (listen_ < 0 || wakeup_ < 0 ||
+      bind(listen_, reinterpret_cast<struct sockaddr*>(&address),
+           sizeof(address)) != 0 ||
+      listen(listen_, 8) != 0) {
+    if (listen_ >= 0) close(listen_);
+    if (wakeup_ >= 0) close(wakeup_);
+    throw std::runtime_error("listen on " + path_ + " failed.");
+  }
+
+  body_.reserve(kInitial_Body);
+  thread_ = std::async(std::launch::async, &MetricsExporter::Run, this);
+}
+
+MetricsExporter::~MetricsExporter() {
+  uint64_t one = 1;
+  if (write(wakeup_, &one, sizeof(one)) == sizeof(one)) thread_.get();
+
+  close(wakeup_);
+  close(listen_);
+  unlink(path_.c_str());
+}
+
+uint64_t MetricsExporter::GetScrapes() const { return scrapes_.load(); }
+
+void MetricsExporter::Run() {
+  struct pollfd fds[2] = {{listen_, POLLIN, 0}, {wakeup_, POLLIN, 0}};
+
+  while (true) {
+    if (poll(fds, 2, -1) < 0) continue;
+    if (fds[1].revents & POLLIN) break;
+
+    if (fds[0].revents & POLLIN) {
+      int fd = accept4(listen_, nullptr, nullptr, SOCK_CLOEXEC);
+      if (fd < 0) continue;
+      Serve(fd);
+      close(fd);
+    }
+  }
+}
+
+void MetricsExporter::Serve(int fd) {
+  // A scraper speaking HTTP sends a request first; others just read.
+  bool http = false;
+  struct pollfd request = {fd, POLLIN, 0};
+  if (poll(&request, 1, kRequest_Timeout_Ms) > 0) {
+    char buffer[1024];
+    auto length = read(fd, buffer, sizeof(buffer));
+    http = length >= 4 && std::memcmp(buffer, "GET ", 4) == 0;
+  }
+
+  // a stalled scraper does not keep the exporter from the next one
+  struct timeval timeout = {1, 0};
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  auto scrapes = scrapes_.fetch_add(1, std::memory_order_relaxed) + 1;
+  body_.clear();
+  MetricsWriter writer(&body_);
+  render_(writer);
+  writer.Family("jetson_gpio_scrapes_total", "counter",
+                "Scrapes served by the exporter.");
+  writer.Sample("jetson_gpio_scrapes_total", std::string(), nullptr, scrapes);
+
+  if (http) {
+    char header[128];
+    auto length = std::snprintf(
+        header, sizeof(header),
+        "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+        "Content-Length: %zu\r\n\r\n",
+        body_.size());
+    if (send(fd, header, length, MSG_NOSIGNAL) != length) return;
+  }
+
+  std::size_t sent = 0;
+  while (sent < body_.size()) {
+    auto n = send(fd, body_.data() + sent, body_.size() - sent, MSG_NOSIGNAL);
+    if (n <= 0) return;
+    sent += n;
+  }
+}
+
+}  // namespace jetson
@@ -0,0 +1,140 @@
+/**
+ * @file metrics_exporter.h
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <string>
+#include "metrics.h"
+
+namespace jetson {
+
+// Socket the exporter listens on by default.
+static const char* const kMetrics_Socket = "/tmp/jetson_gpio_metrics.sock";
+
+/**
+ * @brief Appends metrics in the Prometheus text format to a buffer. Numbers
+ * are formatted in place, so rendering into a buffer with enough capacity
+ * does not allocate.
+ */
+class MetricsWriter {
+ public:
+  explicit MetricsWriter(std::string* out) : out_(out) {}
+
+  /**
+   * @brief Start a metric family. All its samples must follow.
+   *
+   * @param name name of the family.
+   * @param type counter, gauge or histogram.
+   * @param help what is measured.
+   */
+  void Family(const char* name, const char* type, const char* help);
+
+  /**
+   * @brief Add a sample.
+   *
+   * @param name name of the sample.
+   * @param labels pre-rendered labels, may be empty.
+   * @param extra one more label, e.g. edge="rising", or nullptr.
+   * @param value the value.
+   */
+  void Sample(const char* name, const std::string& labels, const char* extra,
+              uint64_t value);
+
+  /**
+   * @brief Add the buckets, sum and count of a latency histogram, in
+   * seconds.
+   *
+   * @param name name of the family.
+   * @param labels pre-rendered labels, may be empty.
+   * @param histogram the histogram.
+   */
+  void Histogram(const char* name, const std::string& labels,
+                 const LatencyHistogram& histogram);
+
+ private:
+  void Labels(const std::string& labels, const char* extra,
+              const char* le = nullptr);
+  void Number(uint64_t value);
+  void Number(double value);
+
+ private:
+  std::string* const out_;
+};
+
+/**
+ * @brief Serves metrics in the Prometheus text format on a Unix domain
+ * socket, e.g. for `curl --unix-socket <path> http://localhost/metrics`.
+ * Every connection is answered with a fresh rendering and closed; plain HTTP
+ * requests get a HTTP response. The thread sleeps in poll(2) between scrapes.
+ */
+class MetricsExporter {
+ public:
+  using Render = std::function<void(MetricsWriter&)>;
+
+ public:
+  /**
+   * @brief Listen on the socket and start serving. A socket file left by a
+   * previous process is replaced. Throws if the socket can not be created.
+   *
+   * @param path path of the socket.
+   * @param render called on the exporter thread for every scrape.
+   */
+  MetricsExporter(std::string path, Render render);
+  ~MetricsExporter();
+
+  /**
+   * @brief Get how many scrapes were served.
+   */
+  uint64_t GetScrapes() const;
+
+ private:
+  MetricsExporter(const MetricsExporter&) = delete;
+  MetricsExporter(MetricsExporter&&) = delete;
+
+ private:
+  void Run();
+  void Serve(int fd);
+
+ private:
+  const std::string path_;
+  const Render render_;
+  int listen_ = -1;
+  int wakeup_ = -1;
+  std::string body_;  // reused by every scrape
+  std::atomic<uint64_t> scrapes_{0};
+  std::future<void> thread_;
+};
+
+}  // namespace jetson
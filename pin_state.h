@@ -0,0 +1,208 @@
+/**
+ * @file pin_state.h
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Layout of the pin state segment published by Gpio::PublishState() and a
+// reader for it. Self-contained, so that monitoring processes need nothing
+// but this header (and -lrt on older glibc).
+
+namespace jetson {
+
+// Name of the shared memory segment, unless given otherwise.
+static constexpr const char* kPin_State_Name = "/jetson_gpio_state";
+static constexpr uint32_t kPin_State_Magic = 0x4a505354;  // "JPST"
+static constexpr uint32_t kPin_State_Version = 1;
+static constexpr uint32_t kMax_Published_Lines = 256;
+
+enum PinKind : int32_t {
+  PIN_UNUSED = 0,  // record free, or its line was destroyed
+  PIN_BINARY = 1,
+  PIN_PWM = 2,
+};
+
+// What is published per line.
+struct PinState {
+  char channel[24];
+  int32_t kind;            // PinKind
+  int32_t gpio;            // global gpio number
+  int32_t direction;       // Direction, binary lines
+  int32_t level;           // last driven or observed, -1 if unknown
+  uint64_t rising_edges;   // seen by the edge monitor, inputs
+  uint64_t falling_edges;
+  double frequency;        // in Hz, pwm
+  double duty_cycle;       // in the range of (0,100), pwm
+  int32_t enabled;         // pwm, -1 if unknown
+  int32_t reserved;
+  int64_t updated_ns;      // CLOCK_MONOTONIC time of the last change
+};
+
+static_assert(sizeof(PinState) % sizeof(uint64_t) == 0,
+              "PinState is copied in words");
+
+/**
+ * @brief One line's state behind a seqlock. The sequence is odd while a
+ * writer changes the state; readers retry until they copied it between two
+ * equal even sequences. Writers take turns by moving the sequence to odd.
+ */
+struct PinStateRecord {
+  static constexpr std::size_t kWords = sizeof(PinState) / sizeof(uint64_t);
+
+  std::atomic<uint32_t> seq{0};
+  std::atomic<uint64_t> words[kWords];
+
+  // Take a consistent copy. Never blocks writers and makes no syscall.
+  PinState Read() const {
+    uint64_t copy[kWords];
+    uint32_t before = 0;
+    do {
+      before = seq.load(std::memory_order_acquire);
+      for (std::size_t i = 0; i < kWords; i++) {
+        copy[i] = words[i].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((before & 1) || seq.load(std::memory_order_relaxed) != before);
+
+    PinState state;
+    std::memcpy(&state, copy, sizeof(state));
+    return state;
+  }
+
+  // Apply change(PinState&) to the state as one update.
+  template <typename Change>
+  void Update(Change&& change) {
+    auto before = seq.load(std::memory_order_relaxed);
+    while ((before & 1) ||
+           !seq.compare_exchange_weak(before, before + 1,
+                                      std::memory_order_relaxed)) {
+      before = seq.load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint64_t copy[kWords];
+    for (std::size_t i = 0; i < kWords; i++) {
+      copy[i] = words[i].load(std::memory_order_relaxed);
+    }
+    PinState state;
+    std::memcpy(&state, copy, sizeof(state));
+    change(state);
+    std::memcpy(copy, &state, sizeof(state));
+    for (std::size_t i = 0; i < kWords; i++) {
+      words[i].store(copy[i], std::memory_order_relaxed);
+    }
+
+    seq.store(before + 2, std::memory_order_release);
+  }
+};
+
+struct PinStateSegment {
+  uint32_t magic;
+  uint32_t version;
+  std::atomic<uint32_t> records{0};  // records ever used
+  PinStateRecord lines[kMax_Published_Lines];
+};
+
+/**
+ * @brief Maps a published pin state segment read only. Snapshots are plain
+ * memory reads; they never wait for nor disturb the publishing process.
+ */
+class PinStateReader {
+ public:
+  explicit PinStateReader(const std::string& name = kPin_State_Name) {
+    fd_ = shm_open(name.c_str(), O_RDONLY, 0);
+    struct stat info;
+    if (fd_ < 0 || fstat(fd_, &info) != 0 ||
+        info.st_size < static_cast<off_t>(sizeof(PinStateSegment))) {
+      if (fd_ >= 0) close(fd_);
+      throw std::runtime_error("no pin state at " + name + ".");
+    }
+
+    void* memory =
+        mmap(nullptr, sizeof(PinStateSegment), PROT_READ, MAP_SHARED, fd_, 0);
+    if (memory == MAP_FAILED) {
+      close(fd_);
+      throw std::runtime_error("map pin state " + name + " failed.");
+    }
+
+    segment_ = static_cast<const PinStateSegment*>(memory);
+    if (segment_->magic != kPin_State_Magic ||
+        segment_->version != kPin_State_Version) {
+      munmap(const_cast<PinStateSegment*>(segment_), sizeof(PinStateSegment));
+      close(fd_);
+      throw std::runtime_error("no pin state at " + name + ".");
+    }
+  }
+
+  ~PinStateReader() {
+    munmap(const_cast<PinStateSegment*>(segment_), sizeof(PinStateSegment));
+    close(fd_);
+  }
+
+  /**
+   * @brief Take a consistent snapshot of every published line.
+   *
+   * @param states filled with one entry per line, reusing its capacity.
+   */
+  void Snapshot(std::vector<PinState>* states) const {
+    states->clear();
+    auto records = segment_->records.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < records && i < kMax_Published_Lines; i++) {
+      auto state = segment_->lines[i].Read();
+      if (state.kind != PIN_UNUSED) states->push_back(state);
+    }
+  }
+
+  std::vector<PinState> Snapshot() const {
+    std::vector<PinState> states;
+    Snapshot(&states);
+    return states;
+  }
+
+ private:
+  PinStateReader(const PinStateReader&) = delete;
+  PinStateReader(PinStateReader&&) = delete;
+
+ private:
+  int fd_ = -1;
+  const PinStateSegment* segment_ = nullptr;
+};
+
+}  // namespace jetson
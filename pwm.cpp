@@ -31,11 +31,17 @@
  */
 
 #include "pwm.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <charconv>
 #include <chrono>
 #include <experimental/filesystem>
+#include <fstream>
 #include <iostream>
+#include <map>
 #include <string>
 #include <thread>
+#include "trace.h"
 #include "types.h"
 
 namespace fs = std::experimental::filesystem;
@@ -57,50 +63,136 @@ PWMController::PWMController(ChannelInfo info, float frequency,
   ResetDutyCycle(duty_cycle);
 }
 
-PWMController::~PWMController() { Unexport(); }
+void PWMController::Destroy(std::list<std::unique_ptr<PWMController>> pwms) {
+  // one open unexport file per pwm chip instead of one per channel
+  std::map<std::string, int> unexport_fds;
+  for (auto& pwm : pwms) {
+    const auto& chip_dir = *(pwm->info_.pwm_chip_dir);
+    auto it = unexport_fds.find(chip_dir);
+    if (it == unexport_fds.end()) {
+      auto path = chip_dir + "/unexport";
+      it = unexport_fds
+               .emplace(chip_dir, open(path.c_str(), O_WRONLY | O_CLOEXEC))
+               .first;
+    }
+    pwm->Unexport(it->second);
+  }
+  for (auto& fd : unexport_fds) {
+    if (fd.second >= 0) close(fd.second);
+  }
+}
+
+PWMController::~PWMController() {
+  Unexport();
+  if (publisher_) publisher_->Release(state_);
+}
 
 void PWMController::Start() {
-  f_enable_.seekp(0, std::ios::beg);
-  f_enable_ << "1";
-  f_enable_.flush();  // "must flush otherwise buffered."
+  std::lock_guard<std::mutex> lock(mutex_);
+  WriteNumber(enable_fd_, 1);
+  enabled_ = true;
+  Record(FlightOp::PWM_START);
+  Publish();
 }
 
 void PWMController::Stop() {
-  f_enable_.seekp(0, std::ios::beg);
-  f_enable_ << "0";
-  f_enable_.flush();  // "must flush otherwise buffered."
+  std::lock_guard<std::mutex> lock(mutex_);
+  WriteNumber(enable_fd_, 0);
+  enabled_ = false;
+  Record(FlightOp::PWM_STOP);
+  Publish();
 }
 
 void PWMController::ResetFrequency(double frequency) {
   if (frequency > 0 && frequency <= 1e9) {
-    int64_t period = 1e9 / frequency;  // period in nano second
-    f_period_.seekp(0, std::ios::beg);
-    f_period_ << std::to_string(period);
-    f_period_.flush();  // "must flush otherwise buffered."
+    std::lock_guard<std::mutex> lock(mutex_);
+    WriteNumber(period_fd_, PeriodNs(frequency));
+    Record(FlightOp::PWM_PERIOD, PeriodNs(frequency));
 
     frequency_ = frequency;
 
     // the duty cycle was set according to frequency
-    ResetDutyCycle(duty_cycle_);
+    WriteDutyCycle(duty_cycle_);
+    Publish();
   }
 }
 
 void PWMController::ResetDutyCycle(double duty_cycle) {
   if (duty_cycle >= 0 && duty_cycle <= 100) {
-    int64_t high = (1e7 / frequency_) * duty_cycle;  // "high" in nano second
-    f_duty_cycle_.seekp(0, std::ios::beg);
-    f_duty_cycle_ << std::to_string(high);
-    f_duty_cycle_.flush();  // "must flush otherwise buffered."
-
-    duty_cycle_ = duty_cycle;
+    std::lock_guard<std::mutex> lock(mutex_);
+    WriteDutyCycle(duty_cycle);
+    Publish();
   }
 }
 
-std::string PWMController::GetChannel() const { info_.channel; }
+std::string PWMController::GetChannel() const { return info_.channel; }
+
+double PWMController::GetFrequency() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return frequency_;
+}
 
-double PWMController::GetFrequency() const { return frequency_; }
+double PWMController::GetDutyCycle() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return duty_cycle_;
+}
 
-double PWMController::GetDutyCycle() const { return duty_cycle_; }
+void PWMController::WriteDutyCycle(double duty_cycle) {
+  WriteNumber(duty_cycle_fd_, HighNs(frequency_, duty_cycle));
+  Record(FlightOp::PWM_DUTY_CYCLE, HighNs(frequency_, duty_cycle));
+
+  duty_cycle_ = duty_cycle;
+}
+
+void PWMController::WriteNumber(int fd, int64_t number) const {
+  JETSON_TRACE2(pwm_write_entry, info_.gpio, number);
+  const int64_t kTrace_Start = JETSON_TRACE_START(pwm_write_return);
+
+  // formatted on the stack, written in one go. The newline ends the number
+  // like echo does, also where the file is not truncated (e.g. simulated).
+  char buffer[24];
+  auto result = std::to_chars(buffer, buffer + sizeof(buffer) - 1, number);
+  *result.ptr++ = '\n';
+  (void)pwrite(fd, buffer, result.ptr - buffer, 0);
+
+  JETSON_TRACE3(pwm_write_return, info_.gpio, number,
+                JETSON_TRACE_SINCE(kTrace_Start));
+}
+
+int64_t PWMController::PeriodNs(double frequency) { return 1e9 / frequency; }
+
+int64_t PWMController::HighNs(double frequency, double duty_cycle) {
+  return (1e7 / frequency) * duty_cycle;
+}
+
+void PWMController::AttachPublisher(StatePublisher* publisher) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  state_ = publisher->Acquire(info_, PIN_PWM);
+  if (state_) publisher_ = publisher;
+  Publish();
+}
+
+void PWMController::Publish() {
+  if (state_ == nullptr) return;
+
+  state_->Update([&](PinState& p) {
+    p.direction = static_cast<int32_t>(Direction::OUT);
+    p.frequency = frequency_;
+    p.duty_cycle = duty_cycle_;
+    p.enabled = enabled_ ? *enabled_ : -1;
+    p.updated_ns = MonotonicNs();
+  });
+}
+
+void PWMController::AttachRecorder(FlightRecorder* recorder) {
+  recorder_.store(recorder, std::memory_order_release);
+}
+
+void PWMController::Record(FlightOp op, int64_t arg) {
+  if (auto recorder = recorder_.load(std::memory_order_acquire)) {
+    recorder->Record(op, info_.gpio, 0, arg);
+  }
+}
 
 void PWMController::Export() {
   const std::string kExport_File = *(info_.pwm_chip_dir) + "/export";
@@ -138,21 +230,31 @@ void PWMController::Export() {
           "creating pwm failed after waiting for a second.");
   }
 
-  // open duty cycle file
-  f_duty_cycle_ =
-      std::ofstream(kPwm_Duty_Cycle_File, std::ios::binary | std::ios::out);
+  // open duty cycle, period and enable file
+  duty_cycle_fd_ = open(kPwm_Duty_Cycle_File.c_str(), O_WRONLY | O_CLOEXEC);
+  period_fd_ = open(kPwm_Period_File.c_str(), O_WRONLY | O_CLOEXEC);
+  enable_fd_ = open(kPwm_Enable_File.c_str(), O_WRONLY | O_CLOEXEC);
+  if (duty_cycle_fd_ < 0 || period_fd_ < 0 || enable_fd_ < 0) {
+    Unexport();
+    throw std::runtime_error("open pwm files failed.");
+  }
+}
 
-  // open period file
-  f_period_ = std::ofstream(kPwm_Period_File, std::ios::binary | std::ios::out);
+void PWMController::Unexport(int unexport_fd) {
+  if (unexported_) return;
+  unexported_ = true;
 
-  // open enable file
-  f_enable_ = std::ofstream(kPwm_Enable_File, std::ios::binary | std::ios::out);
-}
+  for (int* fd : {&enable_fd_, &period_fd_, &duty_cycle_fd_}) {
+    if (*fd >= 0) close(*fd);
+    *fd = -1;
+  }
 
-void PWMController::Unexport() {
-  f_enable_.close();
-  f_period_.close();
-  f_duty_cycle_.close();
+  if (unexport_fd >= 0) {
+    // sysfs takes every write as a whole, regardless of the offset
+    auto id = std::to_string(*(info_.chip_pwm_id));
+    (void)pwrite(unexport_fd, id.c_str(), id.size(), 0);
+    return;
+  }
 
   const std::string kUnexport_File = *(info_.pwm_chip_dir) + "/unexport";
   std::ofstream unexport_fs(kUnexport_File, std::ios::out | std::ios::binary);
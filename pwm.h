@@ -30,11 +30,25 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
-#include <fstream>
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include "flight_recorder.h"
+#include "state_publisher.h"
 #include "types.h"
 
 namespace jetson {
+
+/**
+ * @brief A PWM channel. All member functions may be called concurrently;
+ * updates of one channel are serialized.
+ */
 class PWMController {
  public:
   PWMController(ChannelInfo info, float frequency, float duty_cycle);
@@ -92,17 +106,36 @@ class PWMController {
   PWMController(PWMController&&) = delete;
 
  private:
+  static void Destroy(std::list<std::unique_ptr<PWMController>> pwms);
   void Export();
-  void Unexport();
+  void Unexport(int unexport_fd = -1);
+  void WriteDutyCycle(double duty_cycle);
+  void WriteNumber(int fd, int64_t number) const;
+  static int64_t PeriodNs(double frequency);
+  static int64_t HighNs(double frequency, double duty_cycle);
+  void AttachPublisher(StatePublisher* publisher);
+  void Publish();
+  void AttachRecorder(FlightRecorder* recorder);
+  void Record(FlightOp op, int64_t arg = 0);
+
+  friend class Gpio;
+  friend class PwmGroup;
 
  private:
   const ChannelInfo info_;
+  mutable std::mutex mutex_;
 
-  std::ofstream f_duty_cycle_;
-  std::ofstream f_period_;
-  std::ofstream f_enable_;
+  int duty_cycle_fd_ = -1;
+  int period_fd_ = -1;
+  int enable_fd_ = -1;
 
   double frequency_ = 50;   // 50 hz
   double duty_cycle_ = 50;  // 50%
+  std::optional<bool> enabled_;  // unknown until started or stopped
+
+  StatePublisher* publisher_ = nullptr;
+  PinStateRecord* state_ = nullptr;  // when published
+  std::atomic<FlightRecorder*> recorder_{nullptr};
+  bool unexported_ = false;
 };
 }  // namespace jetson
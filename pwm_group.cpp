@@ -0,0 +1,217 @@
+/**
+ * @file pwm_group.cpp
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "pwm_group.h"
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <utility>
+
+namespace jetson {
+
+PwmGroup::PwmGroup(std::vector<PWMController*> pwms) : pwms_(std::move(pwms)) {
+  // channels of one chip are written next to each other
+  std::sort(pwms_.begin(), pwms_.end(), [](const auto* a, const auto* b) {
+    return std::make_pair(*a->info_.pwm_chip_dir, *a->info_.chip_pwm_id) <
+           std::make_pair(*b->info_.pwm_chip_dir, *b->info_.chip_pwm_id);
+  });
+
+  // Channels may belong to several groups; a fixed order avoids deadlocks.
+  lock_order_ = pwms_;
+  std::sort(lock_order_.begin(), lock_order_.end());
+
+  targets_.resize(pwms_.size());
+  landed_.resize(pwms_.size());
+  writes_.reserve(3 * pwms_.size());  // enable, period, duty cycle at most
+}
+
+JResult PwmGroup::Apply(const std::vector<PwmTarget>& targets) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  std::fill(targets_.begin(), targets_.end(), nullptr);
+  for (const auto& target : targets) {
+    auto it = std::find_if(pwms_.begin(), pwms_.end(), [&](const auto* pwm) {
+      return pwm->info_.channel == target.channel;
+    });
+
+    if (it == pwms_.end()) {
+      return JResult{"Channel " + target.channel + " is not in the group",
+                     false};
+    }
+
+    auto& slot = targets_[it - pwms_.begin()];
+    if (slot != nullptr) {
+      return JResult{"Channel " + target.channel + " given twice", false};
+    }
+
+    if (!(target.frequency > 0 && target.frequency <= 1e9) ||
+        !(target.duty_cycle >= 0 && target.duty_cycle <= 100)) {
+      return JResult{"Invalid target for channel " + target.channel, false};
+    }
+    slot = &target;
+  }
+
+  for (auto* pwm : lock_order_) pwm->mutex_.lock();
+
+  writes_.clear();
+
+  // 1. stop channels together before anything else changes
+  for (std::size_t i = 0; i < pwms_.size(); i++) {
+    auto* pwm = pwms_[i];
+    if (targets_[i] && !targets_[i]->enable && pwm->enabled_ != false) {
+      Add(i, ENABLE, 0);
+    }
+  }
+
+  // 2. period and duty cycle, chip by chip
+  for (std::size_t i = 0; i < pwms_.size(); i++) {
+    auto* pwm = pwms_[i];
+    const auto* target = targets_[i];
+    if (target == nullptr) continue;
+
+    auto period = PWMController::PeriodNs(target->frequency);
+    auto high = PWMController::HighNs(target->frequency, target->duty_cycle);
+    auto old_period = PWMController::PeriodNs(pwm->frequency_);
+    auto old_high = PWMController::HighNs(pwm->frequency_, pwm->duty_cycle_);
+
+    // The kernel rejects a duty cycle longer than the period, so the duty
+    // cycle goes first unless it only fits into the new period.
+    if (high != old_high && high <= old_period) {
+      Add(i, DUTY_CYCLE, high);
+      if (period != old_period) Add(i, PERIOD, period);
+    } else {
+      if (period != old_period) Add(i, PERIOD, period);
+      if (high != old_high) Add(i, DUTY_CYCLE, high);
+    }
+  }
+
+  // 3. start channels together once all are set up
+  for (std::size_t i = 0; i < pwms_.size(); i++) {
+    auto* pwm = pwms_[i];
+    if (targets_[i] && targets_[i]->enable && pwm->enabled_ != true) {
+      Add(i, ENABLE, 1);
+    }
+  }
+
+  int64_t skew = 0;
+  std::size_t written = 0;
+  int error = 0;
+  std::fill(landed_.begin(), landed_.end(), 0);
+  if (!writes_.empty()) {
+    auto first = MonotonicNs();
+    for (; written < writes_.size(); written++) {
+      const auto& write = writes_[written];
+      if (pwrite(write.fd, write.text, write.length, 0) != write.length) {
+        error = errno;
+        break;
+      }
+      landed_[write.pwm] |= write.field;
+    }
+    skew = MonotonicNs() - first;
+  }
+
+  for (std::size_t i = 0; i < pwms_.size(); i++) {
+    auto* pwm = pwms_[i];
+    const auto* target = targets_[i];
+    if (target == nullptr) continue;
+
+    auto period = PWMController::PeriodNs(target->frequency);
+    auto high = PWMController::HighNs(target->frequency, target->duty_cycle);
+    auto old_high = PWMController::HighNs(pwm->frequency_, pwm->duty_cycle_);
+    bool period_set = period == PWMController::PeriodNs(pwm->frequency_) ||
+                      (landed_[i] & PERIOD);
+    bool high_set = high == old_high || (landed_[i] & DUTY_CYCLE);
+    bool enable_set = pwm->enabled_ == target->enable || (landed_[i] & ENABLE);
+
+    if (landed_[i] & PERIOD) pwm->Record(FlightOp::PWM_PERIOD, period);
+    if (landed_[i] & DUTY_CYCLE) pwm->Record(FlightOp::PWM_DUTY_CYCLE, high);
+    if (landed_[i] & ENABLE) {
+      pwm->Record(target->enable ? FlightOp::PWM_START : FlightOp::PWM_STOP);
+    }
+
+    if (period_set) pwm->frequency_ = target->frequency;
+    if (period_set && high_set) {
+      pwm->duty_cycle_ = target->duty_cycle;
+    } else if (landed_[i]) {
+      // the high time written, or kept, in the period written, or kept
+      pwm->duty_cycle_ = (high_set ? high : old_high) * pwm->frequency_ / 1e7;
+    }
+    if (enable_set) pwm->enabled_ = target->enable;
+    pwm->Publish();
+  }
+
+  for (auto* pwm : lock_order_) pwm->mutex_.unlock();
+
+  stats_.writes = written;
+  stats_.skew_ns = skew;
+  stats_.max_skew_ns = std::max(stats_.max_skew_ns, skew);
+  if (written < writes_.size()) {
+    const auto& failed = writes_[written];
+    return JResult{"Write to channel " + pwms_[failed.pwm]->info_.channel +
+                       " failed: " + std::strerror(error),
+                   false};
+  }
+  stats_.applies++;
+  return JResult{"Ok", true};
+}
+
+std::vector<std::string> PwmGroup::GetChannels() const {
+  std::vector<std::string> channels;
+  for (const auto* pwm : pwms_) channels.push_back(pwm->info_.channel);
+  return channels;
+}
+
+PwmGroupStats PwmGroup::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+bool PwmGroup::Contains(const PWMController* pwm) const {
+  return std::find(pwms_.begin(), pwms_.end(), pwm) != pwms_.end();
+}
+
+void PwmGroup::Add(std::size_t pwm, Field field, int64_t number) {
+  Write write;
+  write.fd = field == ENABLE   ? pwms_[pwm]->enable_fd_
+             : field == PERIOD ? pwms_[pwm]->period_fd_
+                               : pwms_[pwm]->duty_cycle_fd_;
+  write.pwm = pwm;
+  write.field = field;
+  auto result = std::to_chars(write.text,
+                              write.text + sizeof(write.text) - 1, number);
+  *result.ptr++ = '\n';  // as PWMController::WriteNumber
+  write.length = result.ptr - write.text;
+  writes_.push_back(write);
+}
+
+}  // namespace jetson
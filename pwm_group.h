@@ -0,0 +1,113 @@
+/**
+ * @file pwm_group.h
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "pwm.h"
+#include "types.h"
+
+namespace jetson {
+
+/**
+ * @brief Several PWM channels updated together. Apply() works out every
+ * sysfs write first and then issues them back to back: channels being
+ * disabled are stopped first, then period and duty cycle are written chip by
+ * chip, and channels being enabled are started last. Values a channel already
+ * has are not written again.
+ *
+ * Created by Gpio::CreatePwmGroup(). The group locks its channels during an
+ * update, so other calls on them wait until the burst is complete.
+ */
+class PwmGroup {
+ public:
+  explicit PwmGroup(std::vector<PWMController*> pwms);
+
+  /**
+   * @brief Set channels of the group at once. Channels without a target keep
+   * their settings. Nothing is written if any target is invalid. The writes
+   * stop at the first that fails; channels then keep what was written so
+   * far.
+   *
+   * @param targets at most one per channel.
+   * @return The result of the update.
+   */
+  JResult Apply(const std::vector<PwmTarget>& targets);
+
+  /**
+   * @brief Get the channels of the group, in the order they are written.
+   *
+   * @return channel names.
+   */
+  std::vector<std::string> GetChannels() const;
+
+  /**
+   * @brief Get the write count and skew of the last update.
+   *
+   * @return statistics of the group.
+   */
+  PwmGroupStats GetStats() const;
+
+ private:
+  PwmGroup(const PwmGroup&) = delete;
+  PwmGroup(PwmGroup&&) = delete;
+
+ private:
+  // what a write sets, also a bit of landed_
+  enum Field : uint8_t { ENABLE = 1, PERIOD = 2, DUTY_CYCLE = 4 };
+
+  struct Write {
+    int fd;
+    int length;
+    char text[24];
+    std::size_t pwm;  // index into pwms_
+    Field field;
+  };
+
+  bool Contains(const PWMController* pwm) const;
+  void Add(std::size_t pwm, Field field, int64_t number);
+
+  friend class Gpio;
+
+ private:
+  std::vector<PWMController*> pwms_;        // by pwm chip, then pwm id
+  std::vector<PWMController*> lock_order_;  // by address
+
+  mutable std::mutex mutex_;
+  std::vector<const PwmTarget*> targets_;  // by index into pwms_
+  std::vector<Write> writes_;
+  std::vector<uint8_t> landed_;  // fields written, by index into pwms_
+  PwmGroupStats stats_;
+};
+
+}  // namespace jetson
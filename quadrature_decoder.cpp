@@ -0,0 +1,181 @@
+/**
+ * @file quadrature_decoder.cpp
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "quadrature_decoder.h"
+#include <stdexcept>
+
+namespace jetson {
+
+namespace {
+
+constexpr int8_t kIllegal = 2;
+
+// Steps indexed by previous state << 2 | current state, with state = A << 1 |
+// B. Moving forward the states run 00 -> 10 -> 11 -> 01 -> 00.
+// clang-format off
+constexpr int8_t kX4_Steps[16] = {
+     0,       -1,        1, kIllegal,
+     1,        0, kIllegal,       -1,
+    -1, kIllegal,        0,        1,
+    kIllegal,  1,       -1,        0};
+constexpr int8_t kX2_Steps[16] = {
+     0,        0,        1, kIllegal,
+     0,        0, kIllegal,       -1,
+    -1, kIllegal,        0,        0,
+    kIllegal,  1,        0,        0};
+constexpr int8_t kX1_Steps[16] = {
+     0,        0,        1, kIllegal,
+     0,        0, kIllegal,        0,
+    -1, kIllegal,        0,        0,
+    kIllegal,  0,        0,        0};
+// clang-format on
+
+const int8_t* StepTable(QuadratureMode mode) {
+  switch (mode) {
+    case QuadratureMode::X1:
+      return kX1_Steps;
+    case QuadratureMode::X2:
+      return kX2_Steps;
+    default:
+      return kX4_Steps;
+  }
+}
+
+BinaryController* CreateInput(Gpio& gpio, const std::string& channel,
+                              Pull pull) {
+  auto result = gpio.CreateBinary(channel, Direction::IN, Signal::LOW, pull);
+  if (!result.second) throw std::runtime_error(result.first);
+  return result.second;
+}
+
+}  // namespace
+
+QuadratureDecoder::QuadratureDecoder(Gpio& gpio, const std::string& channel_a,
+                                     const std::string& channel_b,
+                                     QuadratureOptions options)
+    : gpio_(gpio), options_(options), table_(StepTable(options.mode)) {
+  auto a = CreateInput(gpio, channel_a, options_.pull);
+  auto b = CreateInput(gpio, channel_b, options_.pull);
+  gpio_a_ = gpio.GetChannelInfo(gpio.GetBoardMode(), channel_a).gpio;
+  gpio_b_ = gpio.GetChannelInfo(gpio.GetBoardMode(), channel_b).gpio;
+  state_ = static_cast<unsigned>(a->Read() << 1 | b->Read());
+
+  auto result = gpio.RegisterBatchCallback(
+      {channel_a, channel_b}, [this](EdgeSpan edges) { Decode(edges); });
+  if (!result.second) throw std::runtime_error(result.first);
+  subscription_ = result.second;
+}
+
+QuadratureDecoder::~QuadratureDecoder() {
+  gpio_.UnregisterBatchCallback(subscription_);
+}
+
+int64_t QuadratureDecoder::GetPosition() const {
+  return position_.load(std::memory_order_relaxed);
+}
+
+void QuadratureDecoder::SetPosition(int64_t position) {
+  position_.store(position, std::memory_order_relaxed);
+}
+
+double QuadratureDecoder::GetVelocity() const {
+  auto idle = MonotonicNs() - last_count_ns_.load(std::memory_order_relaxed);
+  if (idle > 2 * options_.velocity_window.count()) return 0;
+  return velocity_.load(std::memory_order_relaxed);
+}
+
+uint64_t QuadratureDecoder::GetEdges() const {
+  return edges_.load(std::memory_order_relaxed);
+}
+
+uint64_t QuadratureDecoder::GetIllegalTransitions() const {
+  return illegal_.load(std::memory_order_relaxed);
+}
+
+void QuadratureDecoder::Decode(EdgeSpan edges) {
+  int64_t delta = 0;
+  int64_t last_count_ns = 0;
+  uint64_t seen = 0;
+  uint64_t illegal = 0;
+
+  for (const auto& e : edges) {
+    unsigned next = 0;
+    if (e.gpio == gpio_a_) {
+      next = (state_ & 1u) | (e.value ? 2u : 0u);
+    } else if (e.gpio == gpio_b_) {
+      next = (state_ & 2u) | (e.value ? 1u : 0u);
+    } else {
+      continue;
+    }
+
+    seen++;
+    if (next == state_) {
+      // The opposite edge of the line was missed: the line toggled twice,
+      // which is as undecodable as both lines changing.
+      illegal++;
+      continue;
+    }
+
+    auto step = table_[state_ << 2 | next];
+    if (step == kIllegal) {
+      illegal++;
+    } else if (step != 0) {
+      delta += step;
+      last_count_ns = e.timestamp_ns;
+    }
+    state_ = next;
+  }
+
+  // one atomic update per span
+  if (seen) edges_.fetch_add(seen, std::memory_order_relaxed);
+  if (illegal) illegal_.fetch_add(illegal, std::memory_order_relaxed);
+  if (last_count_ns == 0) return;
+  position_.fetch_add(delta, std::memory_order_relaxed);
+  travel_ += delta;
+
+  // Velocity over the window, which restarts after the encoder stood still.
+  const auto kWindow = options_.velocity_window.count();
+  auto previous_count_ns = last_count_ns_.load(std::memory_order_relaxed);
+  if (window_start_ns_ == 0 ||
+      last_count_ns - previous_count_ns > 2 * kWindow) {
+    window_start_ns_ = last_count_ns;
+    window_start_travel_ = travel_ - delta;
+  } else if (last_count_ns - window_start_ns_ >= kWindow) {
+    velocity_.store(static_cast<double>(travel_ - window_start_travel_) * 1e9 /
+                        (last_count_ns - window_start_ns_),
+                    std::memory_order_relaxed);
+    window_start_ns_ = last_count_ns;
+    window_start_travel_ = travel_;
+  }
+  last_count_ns_.store(last_count_ns, std::memory_order_relaxed);
+}
+
+}  // namespace jetson
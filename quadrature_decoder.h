@@ -0,0 +1,143 @@
+/**
+ * @file quadrature_decoder.h
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "gpio.h"
+#include "types.h"
+
+namespace jetson {
+
+enum class QuadratureMode {
+  X1,  // one count per cycle, on the rising edge of A
+  X2,  // two counts per cycle, on both edges of A
+  X4   // four counts per cycle, on every edge of A and B
+};
+
+struct QuadratureOptions {
+  QuadratureMode mode = QuadratureMode::X4;
+  // Velocity is estimated over windows at least this long.
+  std::chrono::nanoseconds velocity_window = std::chrono::milliseconds(10);
+  Pull pull = Pull::OFF;
+};
+
+/**
+ * @brief Decodes a quadrature encoder on two input channels. Decoding runs on
+ * the edge monitor thread through a batch subscription, so there is no per
+ * edge callback; position, velocity and error counters are atomics readable
+ * from any thread.
+ *
+ * Position increases when A leads B. An edge reporting the level its line
+ * already had means an edge of that line was missed; such a transition can't
+ * be decoded and is counted as illegal.
+ */
+class QuadratureDecoder {
+ public:
+  /**
+   * @brief Create (or reuse) the two input channels and start decoding.
+   * Throws if a channel can't be created as an input.
+   *
+   * @param gpio the gpio the channels belong to. Must outlive the decoder.
+   * @param channel_a channel of the A signal.
+   * @param channel_b channel of the B signal.
+   * @param options counting mode, velocity window and input pull.
+   */
+  QuadratureDecoder(Gpio& gpio, const std::string& channel_a,
+                    const std::string& channel_b,
+                    QuadratureOptions options = {});
+  ~QuadratureDecoder();
+
+  /**
+   * @brief Get the position in counts of the configured mode.
+   */
+  int64_t GetPosition() const;
+
+  /**
+   * @brief Set the position, e.g. to zero it at a reference mark.
+   *
+   * @param position the new position.
+   */
+  void SetPosition(int64_t position);
+
+  /**
+   * @brief Get the velocity in counts per second, estimated from the edge
+   * time stamps of the last complete window. Reads 0 once no count happened
+   * for two windows.
+   */
+  double GetVelocity() const;
+
+  /**
+   * @brief Get the number of edges seen on A and B.
+   */
+  uint64_t GetEdges() const;
+
+  /**
+   * @brief Get the number of transitions where both lines changed at once.
+   */
+  uint64_t GetIllegalTransitions() const;
+
+  /**
+   * @brief Decode a span of edges. Called by the edge monitor; also useful to
+   * feed recorded edges. Must not be called concurrently with itself.
+   *
+   * @param edges edges of the A and B lines, others are ignored.
+   */
+  void Decode(EdgeSpan edges);
+
+ private:
+  QuadratureDecoder(const QuadratureDecoder&) = delete;
+  QuadratureDecoder(QuadratureDecoder&&) = delete;
+
+ private:
+  Gpio& gpio_;
+  const QuadratureOptions options_;
+  const int8_t* const table_;
+  int gpio_a_ = -1;
+  int gpio_b_ = -1;
+  int subscription_ = 0;
+
+  // only touched by Decode
+  unsigned state_ = 0;  // A << 1 | B
+  int64_t travel_ = 0;  // position unaffected by SetPosition
+  int64_t window_start_ns_ = 0;
+  int64_t window_start_travel_ = 0;
+
+  std::atomic<int64_t> position_{0};
+  std::atomic<double> velocity_{0};
+  std::atomic<int64_t> last_count_ns_{0};
+  std::atomic<uint64_t> edges_{0};
+  std::atomic<uint64_t> illegal_{0};
+};
+
+}  // namespace jetson
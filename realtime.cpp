@@ -0,0 +1,124 @@
+/**
+ * @file realtime.cpp
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "realtime.h"
+#include <alloca.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <cstring>
+#include <string>
+#include <thread>
+
+namespace jetson {
+
+static int NativePolicy(SchedPolicy policy) {
+  switch (policy) {
+    case SchedPolicy::FIFO:
+      return SCHED_FIFO;
+    case SchedPolicy::RR:
+      return SCHED_RR;
+    default:
+      return SCHED_OTHER;
+  }
+}
+
+// Touches the stack below the caller page by page. The pages stay mapped
+// once the frame is gone, so the thread never faults on them later.
+__attribute__((noinline)) static void PrefaultStack(std::size_t bytes) {
+  if (bytes == 0) return;
+
+  auto stack = static_cast<volatile char*>(alloca(bytes));
+  const std::size_t kPage = sysconf(_SC_PAGESIZE);
+  for (std::size_t i = 0; i < bytes; i += kPage) stack[i] = 0;
+  stack[bytes - 1] = 0;
+}
+
+JResult CheckRealtimeConfig(const RealtimeConfig& config) {
+  if (config.policy == SchedPolicy::FIFO || config.policy == SchedPolicy::RR) {
+    int policy = NativePolicy(config.policy);
+    if (config.priority < sched_get_priority_min(policy) ||
+        config.priority > sched_get_priority_max(policy)) {
+      return JResult{"Priority " + std::to_string(config.priority) +
+                         " out of range",
+                     false};
+    }
+  } else if (config.priority != 0) {
+    return JResult{"Priority needs SchedPolicy::FIFO or RR", false};
+  }
+
+  for (int cpu : config.cpus) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+      return JResult{"Cpu " + std::to_string(cpu) + " out of range", false};
+    }
+  }
+
+  if (config.prefault_stack > kMax_Prefault_Stack) {
+    return JResult{"Stack to prefault too large", false};
+  }
+
+  JResult result;
+  std::thread probe([&] { result = ApplyRealtimeConfig(config); });
+  probe.join();
+  return result;
+}
+
+JResult ApplyRealtimeConfig(const RealtimeConfig& config) {
+  if (!config.cpus.empty()) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (int cpu : config.cpus) CPU_SET(cpu, &cpus);
+
+    int error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (error != 0) {
+      return JResult{std::string("set cpu affinity failed: ") +
+                         std::strerror(error),
+                     false};
+    }
+  }
+
+  if (config.policy != SchedPolicy::INHERIT) {
+    struct sched_param param = {};
+    param.sched_priority = config.priority;
+    int error = pthread_setschedparam(pthread_self(),
+                                      NativePolicy(config.policy), &param);
+    if (error != 0) {
+      return JResult{std::string("set scheduling failed: ") +
+                         std::strerror(error),
+                     false};
+    }
+  }
+
+  PrefaultStack(config.prefault_stack);
+  return JResult{"Ok", true};
+}
+
+}  // namespace jetson
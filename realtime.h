@@ -0,0 +1,62 @@
+/**
+ * @file realtime.h
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include "types.h"
+
+namespace jetson {
+
+// Largest RealtimeConfig::prefault_stack, well below the 8 MiB stack threads
+// get by default.
+static constexpr std::size_t kMax_Prefault_Stack = 1 << 20;
+
+/**
+ * @brief Check the ranges of a config and try it on a short lived thread, so
+ * that missing privileges or cpus are reported before any library thread
+ * runs with it. Memory is not locked.
+ *
+ * @param config the config.
+ * @return The result of the check.
+ */
+JResult CheckRealtimeConfig(const RealtimeConfig& config);
+
+/**
+ * @brief Apply the scheduling policy, priority and cpu affinity of a config
+ * to the calling thread and prefault its stack. Library threads call this
+ * first thing.
+ *
+ * @param config the config.
+ * @return The result of applying the config.
+ */
+JResult ApplyRealtimeConfig(const RealtimeConfig& config);
+
+}  // namespace jetson
@@ -0,0 +1,170 @@
+/**
+ * @file scan_cycle.cpp
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "scan_cycle.h"
+#include <time.h>
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <utility>
+#include "realtime.h"
+
+namespace jetson {
+
+ScanCycle::ScanCycle(std::vector<BinaryController*> inputs,
+                     std::vector<BinaryController*> outputs, Step step,
+                     ScanCycleOptions options)
+    : lines_([&] {
+        auto lines = inputs;
+        lines.insert(lines.end(), outputs.begin(), outputs.end());
+        return lines;
+      }()),
+      step_(std::move(step)),
+      options_(std::move(options)),
+      input_image_(inputs.size(), Signal::UNKNOWN),
+      output_image_(outputs.size(), Signal::UNKNOWN),
+      written_image_(outputs.size(), Signal::UNKNOWN),
+      changes_(outputs.size(), Signal::UNKNOWN) {
+  if (options_.period.count() <= 0) {
+    throw std::invalid_argument("scan period must be positive.");
+  }
+
+  if (!inputs.empty()) {
+    inputs_ = std::make_unique<ValueBatch>(std::move(inputs), options_.backend);
+  }
+  if (!outputs.empty()) {
+    outputs_ =
+        std::make_unique<ValueBatch>(std::move(outputs), options_.backend);
+  }
+}
+
+ScanCycle::~ScanCycle() { Stop(); }
+
+bool ScanCycle::Start() {
+  if (thread_.valid()) return false;
+
+  // the levels driven so far, from the shadows
+  if (outputs_) (void)outputs_->Read(&written_image_);
+
+  stop_.store(false);
+  thread_ = std::async(std::launch::async, &ScanCycle::Run, this);
+  return true;
+}
+
+void ScanCycle::Stop() {
+  if (!thread_.valid()) return;
+  stop_.store(true);
+  thread_.get();
+}
+
+ScanCycleStats ScanCycle::GetStats() const {
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  return stats_;
+}
+
+void ScanCycle::Run() {
+  (void)ApplyRealtimeConfig(options_.realtime);  // checked when created
+
+  const int64_t kPeriod = options_.period.count();
+  int64_t deadline = MonotonicNs();
+  while (!stop_.load(std::memory_order_relaxed)) {
+    struct timespec due;
+    due.tv_sec = deadline / 1000000000;
+    due.tv_nsec = deadline % 1000000000;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, nullptr) ==
+           EINTR) {
+    }
+
+    auto woke = MonotonicNs();
+    uint64_t writes = 0;
+    bool scanned = Scan(&writes);
+    auto done = MonotonicNs();
+
+    auto jitter = woke - deadline;
+    deadline += kPeriod;
+
+    // on to the next deadline still ahead, skipping those ran over
+    int64_t missed = 0;
+    if (done > deadline) {
+      missed = (done - deadline) / kPeriod + 1;
+      deadline += missed * kPeriod;
+    }
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.cycles++;
+    stats_.overruns += missed > 0;
+    stats_.missed += missed;
+    stats_.errors += !scanned;
+    stats_.writes += writes;
+    stats_.syscalls = (inputs_ ? inputs_->GetStats().syscalls : 0) +
+                      (outputs_ ? outputs_->GetStats().syscalls : 0);
+    stats_.last_jitter_ns = jitter;
+    total_jitter_ns_ += jitter;
+    stats_.mean_jitter_ns = total_jitter_ns_ / stats_.cycles;
+    stats_.max_jitter_ns = std::max(stats_.max_jitter_ns, jitter);
+    stats_.last_exec_ns = done - woke;
+    total_exec_ns_ += stats_.last_exec_ns;
+    stats_.mean_exec_ns = total_exec_ns_ / stats_.cycles;
+    stats_.max_exec_ns = std::max(stats_.max_exec_ns, stats_.last_exec_ns);
+  }
+}
+
+bool ScanCycle::Scan(uint64_t* writes) {
+  bool scanned = true;
+  if (inputs_) scanned = inputs_->Read(&input_image_).second;
+
+  output_image_ = written_image_;  // same size, no allocation
+  step_(input_image_, &output_image_);
+  output_image_.resize(written_image_.size());
+
+  // only the levels the step changed are written
+  *writes = 0;
+  for (std::size_t i = 0; i < output_image_.size(); i++) {
+    auto level = output_image_[i];
+    bool changed = level != Signal::UNKNOWN && level != written_image_[i];
+    changes_[i] = changed ? level : Signal::UNKNOWN;
+    *writes += changed;
+  }
+
+  if (*writes > 0) {
+    scanned = outputs_->Write(changes_).second && scanned;
+    for (std::size_t i = 0; i < changes_.size(); i++) {
+      if (changes_[i] != Signal::UNKNOWN) written_image_[i] = changes_[i];
+    }
+  }
+  return scanned;
+}
+
+bool ScanCycle::Contains(const BinaryController* line) const {
+  return std::find(lines_.begin(), lines_.end(), line) != lines_.end();
+}
+
+}  // namespace jetson
@@ -0,0 +1,132 @@
+/**
+ * @file scan_cycle.h
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "binary_gpio.h"
+#include "inplace_function.h"
+#include "types.h"
+#include "value_batch.h"
+
+namespace jetson {
+
+/**
+ * @brief Runs a read inputs, compute, write outputs loop at a fixed rate, as
+ * a PLC scans. Every cycle reads all inputs in one grouped read, hands the
+ * input image to the step function and writes the outputs whose level the
+ * step changed in one grouped write (see ValueBatch). Cycles start at
+ * absolute CLOCK_MONOTONIC deadlines, so timing errors never accumulate; a
+ * cycle running into the next deadline is an overrun, and the deadlines it
+ * ran over are skipped.
+ *
+ * The loop runs on a thread of its own, configured with
+ * ScanCycleOptions::realtime. The lines must outlive the scan cycle.
+ */
+class ScanCycle {
+ public:
+  // Called with the input image and the output image, which holds the levels
+  // last written. Levels left alone are not written again.
+  using Step = InplaceFunction<void(const std::vector<Signal>& inputs,
+                                    std::vector<Signal>* outputs)>;
+
+ public:
+  /**
+   * @brief Set the cycle up, stopped. Throws if the grouped reads or writes
+   * can not be set up with the backend asked for.
+   *
+   * @param inputs the input lines, in the order of the input image.
+   * @param outputs the output lines, in the order of the output image.
+   * @param step the function run every cycle.
+   * @param options period, backend and thread configuration.
+   */
+  ScanCycle(std::vector<BinaryController*> inputs,
+            std::vector<BinaryController*> outputs, Step step,
+            ScanCycleOptions options);
+  ~ScanCycle();
+
+  /**
+   * @brief Start scanning. The first cycle runs right away.
+   *
+   * @return false if it runs already.
+   */
+  bool Start();
+
+  /**
+   * @brief Stop scanning, once the cycle in progress is done. Returns within
+   * a period.
+   */
+  void Stop();
+
+  /**
+   * @brief Get the cycle counts and timing.
+   */
+  ScanCycleStats GetStats() const;
+
+ private:
+  ScanCycle(const ScanCycle&) = delete;
+  ScanCycle(ScanCycle&&) = delete;
+
+ private:
+  void Run();
+  bool Scan(uint64_t* writes);
+  bool Contains(const BinaryController* line) const;
+
+  friend class Gpio;
+
+ private:
+  const std::vector<BinaryController*> lines_;  // inputs, then outputs
+  Step step_;
+  const ScanCycleOptions options_;
+  std::unique_ptr<ValueBatch> inputs_;   // none without inputs
+  std::unique_ptr<ValueBatch> outputs_;  // none without outputs
+
+  // touched by the scan thread only
+  std::vector<Signal> input_image_;
+  std::vector<Signal> output_image_;
+  std::vector<Signal> written_image_;
+  std::vector<Signal> changes_;
+
+  std::atomic<bool> stop_{false};
+  std::future<void> thread_;
+
+  mutable std::mutex stats_mutex_;
+  ScanCycleStats stats_;
+  int64_t total_jitter_ns_ = 0;
+  int64_t total_exec_ns_ = 0;
+};
+
+}  // namespace jetson
@@ -0,0 +1,254 @@
+/**
+ * @file sim_board.cpp
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "sim_board.h"
+#include <poll.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <experimental/filesystem>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include "gpio_pin_data.h"
+#include "limits.h"
+
+namespace fs = std::experimental::filesystem;
+
+namespace jetson {
+
+namespace {
+
+// Chip bases as seen on the developer kits. Unknown chips are packed after.
+const std::map<std::string, std::pair<int, int>> kChipBaseNgpio = {
+    {"6000d000.gpio", {0, 256}},
+    {"c2f0000.gpio", {248, 40}},
+    {"2200000.gpio", {288, 224}}};
+
+const std::map<BoardType, std::string> kIdSuffix = {
+    {BoardType::JETSON_XAVIER, "-0000-400"},
+    {BoardType::JETSON_AGX_XAVIER, "-0000-400"},
+    {BoardType::JETSON_NANO, "-0000-300"}};
+
+void WriteFile(const std::string& path, const std::string& content) {
+  std::ofstream file(path, std::ios::out | std::ios::binary);
+  file.write(content.c_str(), content.size());
+}
+
+int ReadNumber(const std::string& path) {
+  int number = -1;
+  std::ifstream file(path, std::ios::in | std::ios::binary);
+  file >> number;
+  return number;
+}
+
+}  // namespace
+
+SimulatedBoard::SimulatedBoard(BoardType type) : type_(type) {
+  if (kBoardPins.find(type_) == kBoardPins.end()) {
+    throw std::runtime_error("board type can't be simulated.");
+  }
+
+  std::string temp = fs::exists("/dev/shm") ? "/dev/shm" : "/tmp";
+  temp += "/jetson-gpio-sim-XXXXXX";
+  if (mkdtemp(&temp[0]) == nullptr) {
+    throw std::runtime_error("create simulated board root failed.");
+  }
+  root_ = temp;
+
+  inotify_ = inotify_init1(IN_CLOEXEC);
+  wakeup_ = eventfd(0, EFD_CLOEXEC);
+  Build();
+  server_ = std::async(std::launch::async,
+                       std::bind(&SimulatedBoard::Serve, this));
+}
+
+SimulatedBoard::~SimulatedBoard() {
+  uint64_t one = 1;
+  if (write(wakeup_, &one, sizeof(one)) == sizeof(one)) server_.get();
+  close(wakeup_);
+  close(inotify_);
+
+  std::error_code ec;
+  fs::remove_all(root_, ec);
+}
+
+const std::string& SimulatedBoard::GetRoot() const { return root_; }
+
+BoardType SimulatedBoard::GetBoardType() const { return type_; }
+
+std::string SimulatedBoard::GetValueFile(const ChannelInfo& info) const {
+  return info.sysfs_root + "/" + info.gpio_name + "/value";
+}
+
+void SimulatedBoard::Build() {
+  const auto& kPinDefs = kBoardPins.at(type_);
+
+  // 1. device tree
+  const std::string kDeviceTree = root_ + "/proc/device-tree";
+  fs::create_directories(kDeviceTree + "/chosen/plugin-manager/ids");
+
+  std::string compatibles;
+  for (const auto& c : kBoardCompats.at(type_)) {
+    compatibles += c;
+    compatibles.push_back(static_cast<char>(0x00));
+  }
+  WriteFile(kDeviceTree + "/compatible", compatibles);
+  WriteFile(kDeviceTree + "/chosen/plugin-manager/ids/" +
+                std::to_string(kBoardInfos.at(type_).carrier_board) +
+                kIdSuffix.at(type_),
+            "");
+
+  // 2. gpio class directory
+  const std::string kClassDir = root_ + kSysfs_Root;
+  fs::create_directories(kClassDir);
+  WriteFile(kClassDir + "/export", "");
+  WriteFile(kClassDir + "/unexport", "");
+  Watch(kClassDir + "/export", Request::GPIO_EXPORT, kClassDir);
+
+  // 3. gpio and pwm chips
+  int next_base = 512;
+  std::map<std::string, int> pwm_chips;
+  for (const auto& pin_def : kPinDefs) {
+    const auto& chip = pin_def.chip_gpio_sysfs_dir;
+    auto chip_dir = root_ + "/sys/devices/" + chip + "/gpio";
+    if (!chip.empty() && !fs::exists(chip_dir)) {
+      auto base_ngpio = std::make_pair(next_base, 32);
+      if (kChipBaseNgpio.count(chip)) {
+        base_ngpio = kChipBaseNgpio.at(chip);
+      } else {
+        next_base += 32;
+      }
+
+      AddGpioChip(chip_dir, chip, base_ngpio.first, base_ngpio.second);
+    }
+
+    if (pin_def.chip_pwm_sysfs_dir != kNONE &&
+        !pwm_chips.count(*pin_def.chip_pwm_sysfs_dir)) {
+      int index = pwm_chips.size();
+      pwm_chips[*pin_def.chip_pwm_sysfs_dir] = index;
+
+      auto pwmchip_dir = root_ + "/sys/devices/" +
+                         *pin_def.chip_pwm_sysfs_dir + "/pwm/pwmchip" +
+                         std::to_string(index);
+      fs::create_directories(pwmchip_dir);
+      WriteFile(pwmchip_dir + "/npwm", "4");
+      WriteFile(pwmchip_dir + "/export", "");
+      WriteFile(pwmchip_dir + "/unexport", "");
+      Watch(pwmchip_dir + "/export", Request::PWM_EXPORT, pwmchip_dir);
+    }
+  }
+
+  // 4. an i2c gpio expander the pin table knows nothing about
+  AddGpioChip(root_ + "/sys/devices/" + kExpander_Device + "/gpio",
+              kExpander_Label, kExpander_Base, kExpander_Ngpio);
+}
+
+void SimulatedBoard::AddGpioChip(const std::string& dir,
+                                 const std::string& label, int base,
+                                 int ngpio) {
+  auto name = "gpiochip" + std::to_string(base);
+  auto gpiochip_dir = dir + "/" + name;
+  fs::create_directories(gpiochip_dir);
+  WriteFile(gpiochip_dir + "/base", std::to_string(base));
+  WriteFile(gpiochip_dir + "/ngpio", std::to_string(ngpio));
+  WriteFile(gpiochip_dir + "/label", label);
+
+  // as in sysfs: the class entry links to the chip, which links its device
+  fs::create_symlink("../..", gpiochip_dir + "/device");
+  fs::create_symlink(gpiochip_dir, root_ + kSysfs_Root + "/" + name);
+}
+
+void SimulatedBoard::Watch(const std::string& file, Request request,
+                           std::string dir) {
+  int watch = inotify_add_watch(inotify_, file.c_str(), IN_CLOSE_WRITE);
+  if (watch < 0) throw std::runtime_error("watch " + file + " failed.");
+  watches_[watch] = std::make_pair(request, std::move(dir));
+}
+
+void SimulatedBoard::Serve() {
+  constexpr int kEvent_Size = sizeof(struct inotify_event);
+  constexpr int kEvent_Buffer_Len = (kEvent_Size + NAME_MAX + 1) * 8;
+  alignas(struct inotify_event) char buffer[kEvent_Buffer_Len];
+
+  struct pollfd fds[2] = {{inotify_, POLLIN, 0}, {wakeup_, POLLIN, 0}};
+  while (true) {
+    if (poll(fds, 2, -1) < 0) continue;
+    if (fds[1].revents & POLLIN) break;
+
+    auto length = read(inotify_, buffer, kEvent_Buffer_Len);
+    int i = 0;
+    while (i < length) {
+      auto event = reinterpret_cast<struct inotify_event*>(&buffer[i]);
+      auto it = watches_.find(event->wd);
+      if (it != watches_.end()) {
+        const auto& dir = it->second.second;
+        int number = ReadNumber(dir + "/export");
+        if (number >= 0) {
+          if (it->second.first == Request::GPIO_EXPORT)
+            ExportGpio(dir, number);
+          else
+            ExportPwm(dir, number);
+        }
+      }
+      i += kEvent_Size + event->len;
+    }
+  }
+}
+
+void SimulatedBoard::ExportGpio(const std::string& dir, int gpio) {
+  auto gpio_dir = dir + "/gpio" + std::to_string(gpio);
+  if (fs::exists(gpio_dir)) return;
+
+  // Populate aside and rename, so the line shows up fully formed.
+  auto temp_dir = dir + "/.gpio" + std::to_string(gpio);
+  fs::create_directories(temp_dir);
+  WriteFile(temp_dir + "/value", "0");
+  WriteFile(temp_dir + "/edge", "none");
+  WriteFile(temp_dir + "/active_low", "0");
+  WriteFile(temp_dir + "/direction", "in");
+  fs::rename(temp_dir, gpio_dir);
+}
+
+void SimulatedBoard::ExportPwm(const std::string& dir, int pwm) {
+  auto pwm_dir = dir + "/pwm" + std::to_string(pwm);
+  if (fs::exists(pwm_dir)) return;
+
+  auto temp_dir = dir + "/.pwm" + std::to_string(pwm);
+  fs::create_directories(temp_dir);
+  WriteFile(temp_dir + "/period", "0");
+  WriteFile(temp_dir + "/duty_cycle", "0");
+  WriteFile(temp_dir + "/polarity", "normal");
+  WriteFile(temp_dir + "/enable", "0");
+  fs::rename(temp_dir, pwm_dir);
+}
+
+}  // namespace jetson
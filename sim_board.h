@@ -0,0 +1,112 @@
+/**
+ * @file sim_board.h
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <future>
+#include <map>
+#include <string>
+#include "types.h"
+
+namespace jetson {
+
+/**
+ * @brief A stand-in for the device-tree and sysfs trees of a Jetson board. The
+ * tree is generated under a temporary directory (on tmpfs when /dev/shm is
+ * available) and a background thread plays the part of the kernel for gpio
+ * and pwm export. Construct a Gpio with GetRoot() to run against it.
+ *
+ * Unexported lines are left in place: the real sysfs removes them
+ * synchronously, which a plain directory tree cannot emulate, and a later
+ * export of the same line simply reuses them.
+ */
+class SimulatedBoard {
+ public:
+  // Besides the chips of the pin table, the board carries an i2c gpio
+  // expander, whose lines are channels "pca9555:0" to "pca9555:15".
+  static constexpr const char* kExpander_Device =
+      "platform/7000c400.i2c/i2c-1/1-0020";
+  static constexpr const char* kExpander_Label = "pca9555";
+  static constexpr int kExpander_Base = 1008;
+  static constexpr int kExpander_Ngpio = 16;
+
+ public:
+  explicit SimulatedBoard(BoardType type = BoardType::JETSON_NANO);
+  ~SimulatedBoard();
+
+  /**
+   * @brief Get the directory standing in for "/".
+   *
+   * @return root directory of the simulated board.
+   */
+  const std::string& GetRoot() const;
+
+  /**
+   * @brief Get the simulated board type
+   *
+   * @return Type of the board
+   */
+  BoardType GetBoardType() const;
+
+  /**
+   * @brief Get the value file of a channel. The file exists once the channel
+   * has been created. Writing to it (without closing the file in between)
+   * emulates an edge on an input.
+   *
+   * @param info The channel information.
+   * @return path to the value file.
+   */
+  std::string GetValueFile(const ChannelInfo& info) const;
+
+ private:
+  SimulatedBoard(const SimulatedBoard&) = delete;
+  SimulatedBoard(SimulatedBoard&&) = delete;
+
+ private:
+  enum class Request { GPIO_EXPORT, PWM_EXPORT };
+
+  void Build();
+  void AddGpioChip(const std::string& dir, const std::string& label, int base,
+                   int ngpio);
+  void Serve();
+  void Watch(const std::string& file, Request request, std::string dir);
+  void ExportGpio(const std::string& dir, int gpio);
+  void ExportPwm(const std::string& dir, int pwm);
+
+ private:
+  const BoardType type_;
+  std::string root_;
+  int inotify_ = -1;
+  int wakeup_ = -1;
+  std::map<int, std::pair<Request, std::string>> watches_;
+  std::future<void> server_;
+};
+
+}  // namespace jetson
@@ -0,0 +1,110 @@
+/**
+ * @file state_publisher.cpp
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "state_publisher.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+namespace jetson {
+
+StatePublisher::StatePublisher(std::string name) : name_(std::move(name)) {
+  // a segment left behind is replaced, readers of it see no more updates
+  shm_unlink(name_.c_str());
+  fd_ = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd_ < 0 || ftruncate(fd_, sizeof(PinStateSegment)) != 0) {
+    if (fd_ >= 0) close(fd_);
+    throw std::runtime_error("create pin state " + name_ + " failed.");
+  }
+
+  void* memory = mmap(nullptr, sizeof(PinStateSegment),
+                      PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (memory == MAP_FAILED) {
+    close(fd_);
+    shm_unlink(name_.c_str());
+    throw std::runtime_error("map pin state " + name_ + " failed.");
+  }
+
+  segment_ = new (memory) PinStateSegment();
+  segment_->magic = kPin_State_Magic;
+  segment_->version = kPin_State_Version;
+}
+
+StatePublisher::~StatePublisher() {
+  munmap(segment_, sizeof(PinStateSegment));
+  close(fd_);
+  shm_unlink(name_.c_str());
+}
+
+PinStateRecord* StatePublisher::Acquire(const ChannelInfo& info,
+                                        PinKind kind) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto records = segment_->records.load();
+
+  // a record given back, or a new one
+  uint32_t index = 0;
+  while (index < records && segment_->lines[index].Read().kind != PIN_UNUSED) {
+    index++;
+  }
+  if (index == kMax_Published_Lines) return nullptr;
+
+  auto record = &segment_->lines[index];
+  record->Update([&](PinState& state) {
+    state = PinState{};
+    auto length = std::min(info.channel.size(), sizeof(state.channel) - 1);
+    std::memcpy(state.channel, info.channel.data(), length);
+    state.kind = kind;
+    state.gpio = info.gpio;
+    state.direction = static_cast<int32_t>(Direction::UNKNOWN);
+    state.level = -1;
+    state.enabled = -1;
+    state.updated_ns = MonotonicNs();
+  });
+
+  if (index == records) segment_->records.store(records + 1);
+  return record;
+}
+
+void StatePublisher::Release(PinStateRecord* record) {
+  if (record == nullptr) return;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  record->Update([](PinState& state) {
+    state.kind = PIN_UNUSED;
+    state.updated_ns = MonotonicNs();
+  });
+}
+
+}  // namespace jetson
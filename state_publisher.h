@@ -0,0 +1,82 @@
+/**
+ * @file state_publisher.h
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <string>
+#include "pin_state.h"
+#include "types.h"
+
+namespace jetson {
+
+/**
+ * @brief Owns a pin state segment (see pin_state.h) and hands out its
+ * records. The segment is removed when the publisher is destroyed; readers
+ * keep their mapping until they let go of it.
+ */
+class StatePublisher {
+ public:
+  /**
+   * @brief Create the segment. Throws if it can not be created.
+   *
+   * @param name name of the shared memory segment.
+   */
+  explicit StatePublisher(std::string name = kPin_State_Name);
+  ~StatePublisher();
+
+  /**
+   * @brief Take a record for a line.
+   *
+   * @param info the channel of the line.
+   * @param kind binary or pwm.
+   * @return the record, nullptr if all records are taken.
+   */
+  PinStateRecord* Acquire(const ChannelInfo& info, PinKind kind);
+
+  /**
+   * @brief Give a record back. Readers see the line gone.
+   *
+   * @param record a record of this publisher, or nullptr.
+   */
+  void Release(PinStateRecord* record);
+
+ private:
+  StatePublisher(const StatePublisher&) = delete;
+  StatePublisher(StatePublisher&&) = delete;
+
+ private:
+  const std::string name_;
+  int fd_ = -1;
+  PinStateSegment* segment_ = nullptr;
+  std::mutex mutex_;  // guards taking and giving back records
+};
+
+}  // namespace jetson
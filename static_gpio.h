@@ -0,0 +1,223 @@
+/**
+ * @file static_gpio.h
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief Pin handles bound at compile time.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <unistd.h>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include "gpio.h"
+#include "gpio_pin_data.h"
+#include "types.h"
+
+namespace jetson {
+
+/**
+ * @brief Compile time facts about a pin, looked up in the pin table of board
+ * B. Only the numeric board modes (BOARD and BCM) can be bound at compile
+ * time.
+ */
+template <BoardType B, BoardMode M, int Pin>
+struct StaticPin {
+ private:
+  static constexpr int Find() {
+    const auto& pins = BoardPinTable<B>::kPins;
+    for (std::size_t i = 0; i < sizeof(pins) / sizeof(pins[0]); i++) {
+      if ((M == BoardMode::BOARD && pins[i].board_pin_num == Pin) ||
+          (M == BoardMode::BCM && pins[i].bcm_pin_num == Pin)) {
+        return static_cast<int>(i);
+      }
+    }
+    return -1;
+  }
+
+ public:
+  static_assert(M == BoardMode::BOARD || M == BoardMode::BCM,
+                "only BOARD and BCM pins can be bound at compile time");
+
+  static constexpr int kIndex = Find();
+  static_assert(kIndex >= 0, "pin does not exist on this board");
+
+  static constexpr const StaticPinDef& kDef =
+      BoardPinTable<B>::kPins[kIndex < 0 ? 0 : kIndex];
+  static constexpr const char* kChip = kDef.chip_gpio_sysfs_dir;
+  static constexpr int kOffset = kDef.chip_gpio_pin_num;
+  static constexpr bool kPwmCapable = kDef.chip_pwm_sysfs_dir != nullptr;
+};
+
+namespace detail {
+
+/**
+ * Creates the channel through the (runtime) Gpio once, and checks that the
+ * detected board agrees with the compile time pin table.
+ */
+template <typename P, BoardMode M, int Pin>
+BinaryController* BindStatic(Gpio& gpio, Direction direction,
+                             Signal initial_value, Pull pull) {
+  if (gpio.GetBoardMode() != M) {
+    throw std::runtime_error("static pin bound with a different board mode.");
+  }
+
+  auto channel = PinNumber2String(Pin);
+  if (gpio.GetChannelInfo(M, channel).chip_gpio != P::kOffset) {
+    throw std::runtime_error("static pin " + channel +
+                             " does not match the detected board.");
+  }
+
+  auto result = gpio.CreateBinary(channel, direction, initial_value, pull);
+  if (!result.second) throw std::runtime_error(result.first);
+  return result.second;
+}
+
+}  // namespace detail
+
+/**
+ * @brief An output bound at compile time. Writes are a pwrite on the value
+ * file that bypasses the output policy and the write lock of the underlying
+ * BinaryController; the shadow, the write count, the flight recorder and the
+ * published level are updated after it as for any other write. Mixed with
+ * writes through the controller from other threads, the shadow may not
+ * follow the order the writes reached the line in. The handle is valid as
+ * long as the Gpio it was created from and the channel are.
+ */
+template <BoardType B, BoardMode M, int Pin>
+class StaticOutput {
+ public:
+  using Def = StaticPin<B, M, Pin>;
+
+  explicit StaticOutput(Gpio& gpio, Signal initial_value = Signal::LOW)
+      : controller_(detail::BindStatic<Def, M, Pin>(gpio, Direction::OUT,
+                                                    initial_value, Pull::OFF)),
+        fd_(controller_->NativeHandle()) {}
+
+  /**
+   * @brief Output a level.
+   *
+   * @param high true for high, false for low.
+   */
+  void Write(bool high) const {
+    (void)pwrite(fd_, &kLevels[high], 1, 0);
+    controller_->Wrote(high ? Signal::HIGH : Signal::LOW);
+  }
+
+  void High() const { Write(true); }
+
+  void Low() const { Write(false); }
+
+  /**
+   * @brief Get the underlying controller, e.g. to register callbacks.
+   */
+  BinaryController* Controller() const { return controller_; }
+
+ private:
+  static constexpr char kLevels[] = "01";
+
+  BinaryController* const controller_;
+  const int fd_;
+};
+
+/**
+ * @brief An input bound at compile time. Reads are a single pread on the
+ * value file. The handle is valid as long as the Gpio it was created from and
+ * the channel are.
+ */
+template <BoardType B, BoardMode M, int Pin>
+class StaticInput {
+ public:
+  using Def = StaticPin<B, M, Pin>;
+
+  explicit StaticInput(Gpio& gpio, Pull pull = Pull::OFF)
+      : controller_(detail::BindStatic<Def, M, Pin>(gpio, Direction::IN,
+                                                    Signal::LOW, pull)),
+        fd_(controller_->NativeHandle()) {}
+
+  /**
+   * @brief Read the input level.
+   *
+   * @return true for high, false for low.
+   */
+  bool Read() const {
+    char value = '0';
+    (void)pread(fd_, &value, 1, 0);
+    return value != '0';
+  }
+
+  /**
+   * @brief Get the underlying controller, e.g. to register callbacks.
+   */
+  BinaryController* Controller() const { return controller_; }
+
+ private:
+  BinaryController* const controller_;
+  const int fd_;
+};
+
+/**
+ * @brief A pwm bound at compile time. Pins without pwm are rejected at
+ * compile time. The handle is valid as long as the Gpio it was created from
+ * and the channel are.
+ */
+template <BoardType B, BoardMode M, int Pin>
+class StaticPwm {
+ public:
+  using Def = StaticPin<B, M, Pin>;
+  static_assert(Def::kPwmCapable, "pin is not pwm capable");
+
+  StaticPwm(Gpio& gpio, float frequency_hz, float duty_cycle) {
+    if (gpio.GetBoardMode() != M) {
+      throw std::runtime_error("static pwm bound with a different board mode.");
+    }
+
+    auto result =
+        gpio.CreatePwm(PinNumber2String(Pin), frequency_hz, duty_cycle);
+    if (!result.second) throw std::runtime_error(result.first);
+    pwm_ = result.second;
+  }
+
+  void Start() const { pwm_->Start(); }
+
+  void Stop() const { pwm_->Stop(); }
+
+  void ResetFrequency(double frequency) const {
+    pwm_->ResetFrequency(frequency);
+  }
+
+  void ResetDutyCycle(double duty_cycle) const {
+    pwm_->ResetDutyCycle(duty_cycle);
+  }
+
+  PWMController* Controller() const { return pwm_; }
+
+ private:
+  PWMController* pwm_ = nullptr;
+};
+
+}  // namespace jetson
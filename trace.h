@@ -0,0 +1,146 @@
+/**
+ * @file trace.h
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include "types.h"
+
+/**
+ * Static user-space tracepoints (USDT) of the provider jetson_gpio, in the
+ * format of systemtap's sys/sdt.h, so that bpftrace, perf and systemtap find
+ * them in the binary:
+ *
+ *   bpftrace -e 'usdt:./app:jetson_gpio:write_return { @[arg0] = hist(arg2); }'
+ *
+ * A probe is a single nop until a tracer attaches. Each probe has a
+ * semaphore which tracers like bpftrace raise while attached; durations are
+ * only measured then, and are 0 for tracers that leave it alone. Building
+ * with -DJETSON_NO_TRACE leaves no trace of the probes at all.
+ *
+ * Probes, all arguments signed 64 bit:
+ *   export_entry(gpio), export_return(gpio, duration_ns)
+ *   write_entry(gpio, level), write_return(gpio, level, duration_ns)
+ *   read_entry(gpio), read_return(gpio, level, duration_ns)
+ *   dispatch_entry(gpio, value), dispatch_return(gpio, value, duration_ns)
+ *   pwm_write_entry(gpio, value), pwm_write_return(gpio, value, duration_ns)
+ */
+
+#define JETSON_TRACE_PROBES(X) \
+  X(export_entry)              \
+  X(export_return)             \
+  X(write_entry)               \
+  X(write_return)              \
+  X(read_entry)                \
+  X(read_return)               \
+  X(dispatch_entry)            \
+  X(dispatch_return)           \
+  X(pwm_write_entry)           \
+  X(pwm_write_return)
+
+#if !defined(JETSON_NO_TRACE) && (defined(__x86_64__) || defined(__aarch64__))
+
+#define JETSON_TRACE_ENABLED 1
+
+#define JETSON_TRACE_DECLARE(probe) \
+  extern unsigned short jetson_gpio_##probe##_semaphore;
+JETSON_TRACE_PROBES(JETSON_TRACE_DECLARE)
+#undef JETSON_TRACE_DECLARE
+
+// A note per probe: its address, the link time base, the semaphore, the
+// provider, the name and the locations of the arguments.
+#define JETSON_TRACE_NOTE(probe, args, ...)                                   \
+  __asm__ __volatile__(                                                       \
+      "990: nop\n"                                                            \
+      ".pushsection .note.stapsdt,\"?\",\"note\"\n"                           \
+      ".balign 4\n"                                                           \
+      ".4byte 992f-991f, 994f-993f, 3\n"                                      \
+      "991: .asciz \"stapsdt\"\n"                                             \
+      "992: .balign 4\n"                                                      \
+      "993: .8byte 990b\n"                                                    \
+      ".8byte _.stapsdt.base\n"                                               \
+      ".8byte jetson_gpio_" #probe "_semaphore\n"                             \
+      ".asciz \"jetson_gpio\"\n"                                              \
+      ".asciz \"" #probe "\"\n"                                               \
+      ".asciz \"" args "\"\n"                                                 \
+      "994: .balign 4\n"                                                      \
+      ".popsection\n"                                                         \
+      ".ifndef _.stapsdt.base\n"                                              \
+      ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+      ".weak _.stapsdt.base\n"                                                \
+      ".hidden _.stapsdt.base\n"                                              \
+      "_.stapsdt.base: .space 1\n"                                            \
+      ".size _.stapsdt.base, 1\n"                                             \
+      ".popsection\n"                                                         \
+      ".endif\n"                                                              \
+      :                                                                       \
+      : __VA_ARGS__)
+
+#define JETSON_TRACE1(probe, a0) \
+  JETSON_TRACE_NOTE(probe, "-8@%0", "nor"(static_cast<int64_t>(a0)))
+#define JETSON_TRACE2(probe, a0, a1)                 \
+  JETSON_TRACE_NOTE(probe, "-8@%0 -8@%1",            \
+                    "nor"(static_cast<int64_t>(a0)), \
+                    "nor"(static_cast<int64_t>(a1)))
+#define JETSON_TRACE3(probe, a0, a1, a2)             \
+  JETSON_TRACE_NOTE(probe, "-8@%0 -8@%1 -8@%2",      \
+                    "nor"(static_cast<int64_t>(a0)), \
+                    "nor"(static_cast<int64_t>(a1)), \
+                    "nor"(static_cast<int64_t>(a2)))
+
+// Whether a tracer is attached to the probe.
+#define JETSON_TRACE_ACTIVE(probe)                             \
+  __builtin_expect(*static_cast<volatile unsigned short*>(     \
+                       &jetson_gpio_##probe##_semaphore) != 0, \
+                   0)
+
+#else
+
+#define JETSON_TRACE1(probe, a0) \
+  do {                           \
+  } while (0)
+#define JETSON_TRACE2(probe, a0, a1) \
+  do {                               \
+  } while (0)
+#define JETSON_TRACE3(probe, a0, a1, a2) \
+  do {                                   \
+  } while (0)
+#define JETSON_TRACE_ACTIVE(probe) false
+
+#endif
+
+// Start time of an operation whose return probe is traced, else 0.
+#define JETSON_TRACE_START(probe) \
+  (JETSON_TRACE_ACTIVE(probe) ? ::jetson::MonotonicNs() : int64_t{0})
+
+// Time since JETSON_TRACE_START, 0 if it was not traced.
+#define JETSON_TRACE_SINCE(start) \
+  ((start) != 0 ? ::jetson::MonotonicNs() - (start) : int64_t{0})
@@ -32,6 +32,10 @@
 
 #pragma once
 
+#include <time.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <fstream>
 #include <map>
 #include <optional>
@@ -60,6 +64,19 @@ struct PinDef {
   std::optional<int> chip_pwm_id;
 };
 
+// Literal counterpart of PinDef, usable in constant expressions. A missing
+// pwm is denoted by nullptr and -1.
+struct StaticPinDef {
+  int chip_gpio_pin_num;
+  const char* chip_gpio_sysfs_dir;
+  int board_pin_num;
+  int bcm_pin_num;
+  const char* cvm_pin_name;
+  const char* tegra_soc_pin_name;
+  const char* chip_pwm_sysfs_dir;
+  int chip_pwm_id;
+};
+
 struct BoardInformation {
   int p1_revision;
   int ram_size;
@@ -93,6 +110,16 @@ enum class Direction { OUT = 0, IN = 1, UNKNOWN };
 
 enum class Signal { LOW = 0, HIGH = 1, UNKNOWN };
 
+enum class OutputPolicy {
+  WRITE_THROUGH = 0,  // every write reaches the value file
+  ELIDE_UNCHANGED,    // writes of the level already driven are skipped
+};
+
+enum class OutputReadback {
+  SHADOW = 0,  // reading an output returns the level last driven
+  VERIFY,      // reading an output reads the value file back
+};
+
 enum class Pull {
   OFF = 0 + kPull_Offset,
   DOWN = 1 + kPull_Offset,
@@ -106,6 +133,37 @@ enum class TriggerEdge {
   BOTH = 3 + kEdge_Offset,
 };
 
+enum class CallbackMode {
+  INLINE = 0,  // run on the edge monitor thread
+  POOL,        // run on the worker pool of the Gpio
+  EXECUTOR,    // hand over to a user supplied executor
+};
+
+enum class OverflowPolicy {
+  DROP_OLDEST = 0,  // a full queue discards its oldest pending edge
+  DROP_NEWEST,      // a full queue discards the incoming edge
+  COALESCE,         // only the latest pending edge is kept
+};
+
+enum class SchedPolicy {
+  INHERIT = 0,  // keep the scheduling of the thread creating the thread
+  OTHER,        // SCHED_OTHER, the default time sharing policy
+  FIFO,         // SCHED_FIFO
+  RR,           // SCHED_RR
+};
+
+enum class IoBackend {
+  AUTO = 0,  // io_uring where available, else system calls
+  IO_URING,  // io_uring only
+  SYSCALLS,  // one system call per line
+};
+
+enum class ReplayTiming {
+  ORIGINAL = 0,  // as recorded
+  SCALED,        // recorded gaps divided by ReplayOptions::speed
+  FAST,          // as fast as possible
+};
+
 static constexpr const char* TriggerEdge2String(TriggerEdge edge) {
   switch (edge) {
     case TriggerEdge::NONE:
@@ -119,6 +177,135 @@ static constexpr const char* TriggerEdge2String(TriggerEdge edge) {
   }
 }
 
+// An edge as seen by the edge monitor.
+struct EdgeEvent {
+  int64_t timestamp_ns;  // CLOCK_MONOTONIC time of the wake-up reporting it
+  int gpio;              // global gpio number of the line
+  int value;             // value of the line after the edge
+};
+
+// A contiguous view of objects, in the spirit of C++20 std::span.
+template <typename T>
+class Span {
+ public:
+  constexpr Span() = default;
+  constexpr Span(T* data, std::size_t size) : data_(data), size_(size) {}
+
+  constexpr T* data() const { return data_; }
+  constexpr std::size_t size() const { return size_; }
+  constexpr bool empty() const { return size_ == 0; }
+  constexpr T* begin() const { return data_; }
+  constexpr T* end() const { return data_ + size_; }
+  constexpr T& operator[](std::size_t i) const { return data_[i]; }
+
+ private:
+  T* data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+using EdgeSpan = Span<const EdgeEvent>;
+
+struct BatchOptions {
+  std::size_t max_batch = 64;  // events per delivered span at most
+  // How long an edge may wait for later edges before its span is delivered.
+  // Zero delivers at the end of every wake-up.
+  std::chrono::nanoseconds max_latency{0};
+};
+
+// How the threads of the library run (see Gpio::SetRealtimeConfig).
+struct RealtimeConfig {
+  SchedPolicy policy = SchedPolicy::INHERIT;
+  int priority = 0;                // 1 to 99 with FIFO and RR, else 0
+  std::vector<int> cpus;           // cpus to run on, empty for any
+  bool lock_memory = false;        // lock current and future pages in memory
+  std::size_t prefault_stack = 0;  // stack bytes touched when a thread starts
+};
+
+struct WriteScheduleStats {
+  uint64_t executed = 0;     // scheduled writes issued
+  uint64_t cancelled = 0;    // scheduled writes cancelled or dropped
+  uint64_t bursts = 0;       // wake-ups issuing the writes due
+  int64_t last_late_ns = 0;  // issued minus scheduled time
+  int64_t mean_late_ns = 0;
+  int64_t max_late_ns = 0;
+};
+
+// What one channel of a PwmGroup is set to.
+struct PwmTarget {
+  std::string channel;
+  double frequency = 50;   // in Hz
+  double duty_cycle = 50;  // in the range of (0,100)
+  bool enable = true;
+};
+
+struct ValueBatchStats {
+  bool io_uring = false;    // whether the batch runs on io_uring
+  uint64_t cycles = 0;      // Write(), Read() and WaitEdges() calls
+  uint64_t operations = 0;  // value file reads and writes
+  uint64_t syscalls = 0;    // system calls these took
+};
+
+struct ReplayOptions {
+  ReplayTiming timing = ReplayTiming::ORIGINAL;
+  double speed = 1;  // with ReplayTiming::SCALED, e.g. 10 for ten times
+};
+
+struct ReplayStats {
+  uint64_t edges = 0;            // edges dispatched
+  uint64_t spans = 0;            // wake-ups replayed
+  int64_t duration_ns = 0;       // first to last dispatch
+  double edges_per_sec = 0;      // dispatch throughput
+  int64_t mean_late_ns = 0;      // dispatched minus due time of a span
+  int64_t max_late_ns = 0;
+  int64_t mean_dispatch_ns = 0;  // time a span takes to be dispatched
+  int64_t max_dispatch_ns = 0;
+};
+
+struct ScanCycleOptions {
+  std::chrono::nanoseconds period{1000000};  // 1 kHz
+  IoBackend backend = IoBackend::AUTO;       // of the grouped reads and writes
+  RealtimeConfig realtime;                   // of the scan thread
+};
+
+struct ScanCycleStats {
+  uint64_t cycles = 0;         // steps run
+  uint64_t overruns = 0;       // cycles that ended past the next deadline
+  uint64_t missed = 0;         // deadlines skipped after overruns
+  uint64_t errors = 0;         // cycles whose reads or writes failed
+  uint64_t writes = 0;         // output levels changed
+  uint64_t syscalls = 0;       // taken by the reads and writes
+  int64_t last_jitter_ns = 0;  // wake-up past the deadline
+  int64_t mean_jitter_ns = 0;
+  int64_t max_jitter_ns = 0;
+  int64_t last_exec_ns = 0;    // read, step and write
+  int64_t mean_exec_ns = 0;
+  int64_t max_exec_ns = 0;
+};
+
+// On an edge of the input, write a level to the output (see Gpio::AddReflex).
+struct ReflexRule {
+  std::string input;
+  TriggerEdge edge = TriggerEdge::RISING;  // or FALLING or BOTH
+  std::string output;
+  Signal level = Signal::HIGH;
+  std::chrono::nanoseconds delay{0};  // after the edge was read
+};
+
+struct ReflexStats {
+  uint64_t fired = 0;        // outputs written by reflexes
+  uint64_t delayed = 0;      // of which after a delay
+  int64_t max_late_ns = 0;   // delayed writes past their due time
+  int64_t mean_late_ns = 0;
+  uint64_t overflows = 0;    // delayed writes dropped, too many pending
+};
+
+struct PwmGroupStats {
+  uint64_t applies = 0;     // Apply() calls that succeeded
+  int writes = 0;           // sysfs writes of the last apply
+  int64_t skew_ns = 0;      // first to last write of the last apply
+  int64_t max_skew_ns = 0;  // over all applies
+};
+
 struct ChannelInfo {
   std::string channel;
   std::string gpio_chip_dir;
@@ -127,9 +314,18 @@ struct ChannelInfo {
   std::string gpio_name;
   std::optional<std::string> pwm_chip_dir;
   std::optional<int> chip_pwm_id;
+  std::string sysfs_root;
 };
 
-using ChannelData = std::map<BoardMode, std::map<std::string, ChannelInfo>>;
+struct GpioChip {
+  std::string name;    // sysfs class entry, gpiochip<base>
+  std::string label;
+  std::string device;  // device directory name, as in the pin tables
+  std::string dir;     // device directory
+  int base;
+  int ngpio;
+  std::string chardev;  // character device, empty if not available
+};
 
 struct ChannelConfiguration {
   ChannelInfo channel_info;
@@ -157,4 +353,11 @@ inline std::string PinNumber2String(int pin_num) {
   return std::to_string(pin_num);
 }
 
+// CLOCK_MONOTONIC time in nano seconds, the time base of all time stamps.
+inline int64_t MonotonicNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
 }  // namespace jetson
@@ -0,0 +1,308 @@
+/**
+ * @file value_batch.cpp
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "value_batch.h"
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace jetson {
+
+// Tags the user data of poll completions, the low bits are the line index.
+static const uint64_t kPoll_Tag = uint64_t{1} << 32;
+
+ValueBatch::ValueBatch(std::vector<BinaryController*> lines,
+                       IoBackend backend)
+    : lines_(std::move(lines)),
+      lock_order_(lines_),
+      buffer_(2 * lines_.size()),
+      written_(lines_.size()),
+      armed_(lines_.size()),
+      edged_(lines_.size()) {
+  std::sort(lock_order_.begin(), lock_order_.end());
+
+  if (backend != IoBackend::SYSCALLS) {
+    try {
+      // a read or write per line, and a poll per line being re-armed
+      ring_ = std::make_unique<IoUring>(
+          static_cast<unsigned>(std::max<std::size_t>(2 * lines_.size(), 8)));
+
+      std::vector<int> fds;
+      for (auto line : lines_) fds.push_back(line->value_fd_);
+      if (!ring_->RegisterFiles(fds) ||
+          !ring_->RegisterBuffer(buffer_.data(), buffer_.size())) {
+        throw std::runtime_error("register with io_uring failed.");
+      }
+    } catch (const std::exception&) {
+      ring_.reset();
+      if (backend == IoBackend::IO_URING) throw;
+    }
+  }
+
+  if (!ring_) {
+    for (auto line : lines_) {
+      bool input = line->direction_ == Direction::IN;
+      polls_.push_back(pollfd{input ? line->value_fd_ : -1,
+                                     POLLPRI | POLLERR, 0});
+    }
+  }
+  stats_.io_uring = ring_ != nullptr;
+}
+
+JResult ValueBatch::Write(const std::vector<Signal>& levels) {
+  if (levels.size() != lines_.size()) {
+    return JResult{"One level per line expected", false};
+  }
+  stats_.cycles++;
+
+  // Held until the shadows are updated, like a write of the line itself.
+  for (auto line : lock_order_) line->write_mutex_.lock();
+
+  JResult result{"Ok", true};
+  std::size_t operations = 0;
+  for (std::size_t i = 0; i < lines_.size(); i++) {
+    auto line = lines_[i];
+    auto level = levels[i] == Signal::HIGH ? Signal::HIGH : Signal::LOW;
+    written_[i] =
+        line->direction_ == Direction::OUT && levels[i] != Signal::UNKNOWN &&
+        !(line->policy_.load(std::memory_order_relaxed) ==
+              OutputPolicy::ELIDE_UNCHANGED &&
+          line->shadow_.load(std::memory_order_relaxed) == level);
+    if (!written_[i]) continue;
+
+    // set again once the write landed
+    written_[i] = 0;
+    buffer_[i] = level == Signal::HIGH ? '1' : '0';
+    operations++;
+    if (ring_) {
+      auto sqe = ring_->Next();
+      sqe->opcode = IORING_OP_WRITE_FIXED;
+      sqe->flags = IOSQE_FIXED_FILE;
+      sqe->fd = static_cast<int>(i);
+      sqe->addr = reinterpret_cast<uint64_t>(&buffer_[i]);
+      sqe->len = 1;
+      sqe->buf_index = 0;
+      sqe->user_data = i;
+    } else {
+      stats_.syscalls++;
+      if (pwrite(line->value_fd_, &buffer_[i], 1, 0) == 1) {
+        written_[i] = 1;
+      } else {
+        result = JResult{std::string("write value failed: ") +
+                             std::strerror(errno),
+                         false};
+      }
+    }
+  }
+
+  if (ring_ && operations > 0) result = Complete(operations, &written_);
+  stats_.operations += operations;
+
+  for (std::size_t i = 0; i < lines_.size(); i++) {
+    if (written_[i]) lines_[i]->Wrote(levels[i]);
+  }
+  for (auto line : lock_order_) line->write_mutex_.unlock();
+  return result;
+}
+
+JResult ValueBatch::Read(std::vector<Signal>* levels) {
+  stats_.cycles++;
+  const std::size_t kRead = lines_.size();  // reads go behind the writes
+
+  JResult result{"Ok", true};
+  std::size_t operations = 0;
+  for (std::size_t i = 0; i < lines_.size(); i++) {
+    auto line = lines_[i];
+    buffer_[kRead + i] = 0;
+    if (line->direction_ == Direction::OUT &&
+        line->readback_.load(std::memory_order_relaxed) ==
+            OutputReadback::SHADOW) {
+      continue;
+    }
+
+    operations++;
+    if (ring_) {
+      auto sqe = ring_->Next();
+      sqe->opcode = IORING_OP_READ_FIXED;
+      sqe->flags = IOSQE_FIXED_FILE;
+      sqe->fd = static_cast<int>(i);
+      sqe->addr = reinterpret_cast<uint64_t>(&buffer_[kRead + i]);
+      sqe->len = 1;
+      sqe->buf_index = 0;
+      sqe->user_data = i;
+    } else {
+      stats_.syscalls++;
+      if (pread(line->value_fd_, &buffer_[kRead + i], 1, 0) != 1) {
+        result = JResult{std::string("read value failed: ") +
+                             std::strerror(errno),
+                         false};
+      }
+    }
+  }
+
+  if (ring_ && operations > 0) result = Complete(operations, nullptr);
+  stats_.operations += operations;
+
+  levels->clear();
+  for (std::size_t i = 0; i < lines_.size(); i++) {
+    auto value = buffer_[kRead + i];
+    if (value == 0) {
+      levels->push_back(lines_[i]->shadow_.load(std::memory_order_relaxed));
+    } else {
+      levels->push_back(value == '0' ? Signal::LOW : Signal::HIGH);
+    }
+    lines_[i]->Record(FlightOp::READ, static_cast<int>(levels->back()));
+  }
+  return result;
+}
+
+JResult ValueBatch::WaitEdges(std::chrono::nanoseconds timeout,
+                              std::vector<std::size_t>* lines) {
+  stats_.cycles++;
+  lines->clear();
+
+  if (ring_) {
+    for (std::size_t i = 0; i < lines_.size(); i++) {
+      if (lines_[i]->direction_ != Direction::IN || armed_[i]) continue;
+      auto sqe = ring_->Next();
+      sqe->opcode = IORING_OP_POLL_ADD;
+      sqe->flags = IOSQE_FIXED_FILE;
+      sqe->fd = static_cast<int>(i);
+      sqe->len = IORING_POLL_ADD_MULTI;
+      sqe->poll32_events = POLLPRI | POLLERR;
+      sqe->user_data = kPoll_Tag | i;
+      armed_[i] = 1;
+    }
+
+    // edges seen while reading or writing are there already
+    struct io_uring_cqe cqe;
+    while (ring_->Reap(&cqe)) Polled(cqe);
+    bool seen = std::find(edged_.begin(), edged_.end(), 1) != edged_.end();
+
+    stats_.syscalls++;
+    auto entered = ring_->Enter(seen ? 0 : 1, timeout.count());
+    if (entered < 0 && entered != -ETIME) {
+      return JResult{std::string("wait for edges failed: ") +
+                         std::strerror(-entered),
+                     false};
+    }
+    while (ring_->Reap(&cqe)) Polled(cqe);
+  } else {
+    struct timespec ts = {
+        static_cast<time_t>(timeout.count() / 1000000000),
+        static_cast<long>(timeout.count() % 1000000000)};
+    stats_.syscalls++;
+    auto ready = ppoll(polls_.data(), polls_.size(), &ts, nullptr);
+    if (ready < 0 && errno != EINTR) {
+      return JResult{std::string("wait for edges failed: ") +
+                         std::strerror(errno),
+                     false};
+    }
+
+    for (std::size_t i = 0; ready > 0 && i < polls_.size(); i++) {
+      if (polls_[i].revents & POLLPRI) {
+        // sysfs signals the next edge only once the value was read
+        char value = 0;
+        stats_.syscalls++;
+        (void)pread(polls_[i].fd, &value, 1, 0);
+        edged_[i] = 1;
+      }
+    }
+  }
+
+  for (std::size_t i = 0; i < edged_.size(); i++) {
+    if (edged_[i]) lines->push_back(i);
+    edged_[i] = 0;
+  }
+  return JResult{"Ok", true};
+}
+
+std::vector<std::string> ValueBatch::GetChannels() const {
+  std::vector<std::string> channels;
+  for (auto line : lines_) channels.push_back(line->GetChannel());
+  return channels;
+}
+
+ValueBatchStats ValueBatch::GetStats() const { return stats_; }
+
+bool ValueBatch::Contains(const BinaryController* line) const {
+  return std::find(lines_.begin(), lines_.end(), line) != lines_.end();
+}
+
+JResult ValueBatch::Complete(std::size_t operations, std::vector<char>* done) {
+  JResult result{"Ok", true};
+  struct io_uring_cqe cqe;
+  std::size_t completed = 0;
+  unsigned wait = static_cast<unsigned>(operations);
+
+  while (completed < operations) {
+    stats_.syscalls++;
+    auto entered = ring_->Enter(wait);
+    if (entered < 0) {
+      return JResult{std::string("io_uring failed: ") +
+                         std::strerror(-entered),
+                     false};
+    }
+
+    while (ring_->Reap(&cqe)) {
+      if (cqe.user_data & kPoll_Tag) {
+        Polled(cqe);
+        continue;
+      }
+
+      completed++;
+      if (cqe.res < 0) {
+        result = JResult{std::string("value io failed: ") +
+                             std::strerror(-cqe.res),
+                         false};
+      } else if (done && cqe.res > 0) {
+        (*done)[cqe.user_data] = 1;
+      }
+    }
+    wait = static_cast<unsigned>(operations - completed);
+  }
+  return result;
+}
+
+void ValueBatch::Polled(const struct io_uring_cqe& cqe) {
+  auto i = static_cast<std::size_t>(cqe.user_data & (kPoll_Tag - 1));
+  if (cqe.res > 0) edged_[i] = 1;
+
+  // A poll the file does not support stays unarmed, any other is re-armed
+  // by the next wait once the kernel ends it.
+  if (!(cqe.flags & IORING_CQE_F_MORE) && cqe.res >= 0) armed_[i] = 0;
+}
+
+}  // namespace jetson
@@ -0,0 +1,130 @@
+/**
+ * @file value_batch.h
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <poll.h>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "binary_gpio.h"
+#include "io_uring.h"
+#include "types.h"
+
+namespace jetson {
+
+/**
+ * @brief Reads, writes and waits for edges on a fixed set of binary lines in
+ * one go. On io_uring, the value files and one buffer are registered with
+ * the ring and a whole batch takes a single system call; edge waits are
+ * multishot POLLPRI polls on the same ring. Otherwise, or with
+ * IoBackend::SYSCALLS, every line takes a system call of its own.
+ *
+ * A batch is used by one thread at a time. Writes go along with the writes
+ * of the lines themselves: shadows, output policy and metrics are kept.
+ */
+class ValueBatch {
+ public:
+  /**
+   * @brief Set the batch up. Throws if IoBackend::IO_URING is asked for and
+   * io_uring can not be used.
+   *
+   * @param lines the lines, which must outlive the batch.
+   * @param backend how the value files are accessed.
+   */
+  ValueBatch(std::vector<BinaryController*> lines, IoBackend backend);
+
+  /**
+   * @brief Write a level to every output of the batch. Inputs are skipped.
+   *
+   * @param levels one level per line, in the order of the batch.
+   * Signal::UNKNOWN leaves a line as it is.
+   * @return The result of the writes. Lines not written keep their shadow.
+   */
+  JResult Write(const std::vector<Signal>& levels);
+
+  /**
+   * @brief Read every line of the batch, see BinaryController::Read2().
+   *
+   * @param levels filled with one level per line, reusing its capacity.
+   * @return The result of the reads.
+   */
+  JResult Read(std::vector<Signal>* levels);
+
+  /**
+   * @brief Wait for edges on the inputs of the batch, as signaled by sysfs
+   * with POLLPRI.
+   *
+   * @param timeout how long to wait at most.
+   * @param lines filled with the indices of lines with an edge, reusing its
+   * capacity.
+   * @return The result of the wait. No line and success on a timeout.
+   */
+  JResult WaitEdges(std::chrono::nanoseconds timeout,
+                    std::vector<std::size_t>* lines);
+
+  /**
+   * @brief Get the channels of the batch, in order.
+   */
+  std::vector<std::string> GetChannels() const;
+
+  /**
+   * @brief Get the backend used and the system calls taken.
+   */
+  ValueBatchStats GetStats() const;
+
+ private:
+  ValueBatch(const ValueBatch&) = delete;
+  ValueBatch(ValueBatch&&) = delete;
+
+ private:
+  bool Contains(const BinaryController* line) const;
+  // marks the lines whose operation succeeded in done, if given
+  JResult Complete(std::size_t operations, std::vector<char>* done);
+  void Polled(const struct io_uring_cqe& cqe);
+
+  friend class Gpio;
+
+ private:
+  const std::vector<BinaryController*> lines_;
+  std::vector<BinaryController*> lock_order_;  // never deadlocks two batches
+  std::unique_ptr<IoUring> ring_;  // none when on system calls
+  std::vector<char> buffer_;   // values written, then values read
+  std::vector<char> written_;  // lines written by the current Write()
+  std::vector<char> armed_;    // multishot polls in flight
+  std::vector<char> edged_;    // polls completed since the last wait
+  std::vector<struct pollfd> polls_;  // without io_uring
+  ValueBatchStats stats_;
+};
+
+}  // namespace jetson
@@ -0,0 +1,233 @@
+/**
+ * @file write_scheduler.cpp
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "write_scheduler.h"
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include "binary_gpio.h"
+#include "realtime.h"
+
+namespace jetson {
+
+WriteScheduler::WriteScheduler() {
+  timer_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  wakeup_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (timer_ < 0 || wakeup_ < 0) {
+    throw std::runtime_error("create write scheduler failed.");
+  }
+}
+
+WriteScheduler::~WriteScheduler() {
+  if (thread_.valid()) {
+    uint64_t one = 1;
+    if (write(wakeup_, &one, sizeof(one)) == sizeof(one)) thread_.get();
+  }
+
+  close(wakeup_);
+  close(timer_);
+}
+
+uint64_t WriteScheduler::Schedule(const std::vector<BinaryController*>& lines,
+                                  Signal level, int64_t deadline_ns) {
+  std::call_once(started_, &WriteScheduler::Start, this);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto id = next_id_++;
+  for (auto* line : lines) {
+    heap_.push_back(Pending{deadline_ns, id, line, level});
+    std::push_heap(heap_.begin(), heap_.end(), Later);
+  }
+  live_[id] = lines.size();
+
+  Arm();
+  return id;
+}
+
+bool WriteScheduler::Cancel(uint64_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = live_.find(id);
+  if (it == live_.end()) return false;
+
+  // The heap entries are skipped when they come due.
+  stats_.cancelled += it->second;
+  live_.erase(it);
+  return true;
+}
+
+void WriteScheduler::Remove(BinaryController* line) {
+  // Taking the lock waits for writes in progress.
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto removed = std::remove_if(heap_.begin(), heap_.end(), [&](auto& p) {
+    if (p.line != line) return false;
+
+    auto it = live_.find(p.id);
+    if (it != live_.end()) {
+      stats_.cancelled++;
+      if (--it->second == 0) live_.erase(it);
+    }
+    return true;
+  });
+
+  if (removed != heap_.end()) {
+    heap_.erase(removed, heap_.end());
+    std::make_heap(heap_.begin(), heap_.end(), Later);
+    Arm();
+  }
+}
+
+WriteScheduleStats WriteScheduler::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+bool WriteScheduler::SetRealtimeConfig(RealtimeConfig config) {
+  std::lock_guard<std::mutex> lock(realtime_mutex_);
+  if (realtime_fixed_) return false;
+  realtime_ = std::move(config);
+  return true;
+}
+
+bool WriteScheduler::UseExternalLoop() {
+  if (thread_.valid()) return false;
+  external_.store(true);
+  return true;
+}
+
+int WriteScheduler::GetTimerFd() const { return timer_; }
+
+int WriteScheduler::Dispatch() {
+  uint64_t expirations = 0;
+  if (read(timer_, &expirations, sizeof(expirations)) <= 0) return 0;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto executed = stats_.executed;
+  Fire();
+  return static_cast<int>(stats_.executed - executed);
+}
+
+void WriteScheduler::Start() {
+  {
+    std::lock_guard<std::mutex> lock(realtime_mutex_);
+    realtime_fixed_ = true;
+  }
+  if (external_.load()) return;
+  thread_ = std::async(std::launch::async, &WriteScheduler::Run, this);
+}
+
+void WriteScheduler::Run() {
+  (void)ApplyRealtimeConfig(realtime_);  // checked when it was set
+
+  struct pollfd fds[2] = {{timer_, POLLIN, 0}, {wakeup_, POLLIN, 0}};
+  while (true) {
+    if (poll(fds, 2, -1) < 0) continue;
+    if (fds[1].revents & POLLIN) break;
+
+    if (fds[0].revents & POLLIN) {
+      uint64_t expirations = 0;
+      (void)read(timer_, &expirations, sizeof(expirations));
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      Fire();
+    }
+  }
+}
+
+void WriteScheduler::Fire() {
+  armed_ns_ = 0;
+
+  due_.clear();
+  auto now = MonotonicNs();
+  while (!heap_.empty() && heap_.front().deadline_ns <= now) {
+    std::pop_heap(heap_.begin(), heap_.end(), Later);
+    auto pending = heap_.back();
+    heap_.pop_back();
+
+    auto it = live_.find(pending.id);
+    if (it == live_.end()) continue;  // cancelled
+    if (--it->second == 0) live_.erase(it);
+    due_.push_back(pending);
+  }
+
+  if (!due_.empty()) {
+    // lines of one chip next to each other, in deadline order otherwise
+    std::stable_sort(due_.begin(), due_.end(),
+                     [](const Pending& a, const Pending& b) {
+                       return a.line->info_.gpio_chip_dir <
+                              b.line->info_.gpio_chip_dir;
+                     });
+
+    for (const auto& pending : due_) {
+      auto late = MonotonicNs() - pending.deadline_ns;
+      pending.line->Write2(pending.level);
+
+      total_late_ns_ += late;
+      stats_.last_late_ns = late;
+      stats_.max_late_ns = std::max(stats_.max_late_ns, late);
+    }
+
+    stats_.executed += due_.size();
+    stats_.bursts++;
+    stats_.mean_late_ns =
+        total_late_ns_ / static_cast<int64_t>(stats_.executed);
+  }
+
+  Arm();
+}
+
+bool WriteScheduler::Later(const Pending& a, const Pending& b) {
+  // earliest deadline on top, then the first scheduled
+  return a.deadline_ns != b.deadline_ns ? a.deadline_ns > b.deadline_ns
+                                        : a.id > b.id;
+}
+
+void WriteScheduler::Arm() {
+  // entries of cancelled writes are dropped once on top
+  while (!heap_.empty() && !live_.count(heap_.front().id)) {
+    std::pop_heap(heap_.begin(), heap_.end(), Later);
+    heap_.pop_back();
+  }
+
+  if (heap_.empty() || heap_.front().deadline_ns == armed_ns_) return;
+
+  // a zero time would disarm the timer; any time in the past fires at once
+  armed_ns_ = std::max<int64_t>(1, heap_.front().deadline_ns);
+  struct itimerspec spec = {};
+  spec.it_value.tv_sec = armed_ns_ / 1000000000;
+  spec.it_value.tv_nsec = armed_ns_ % 1000000000;
+  timerfd_settime(timer_, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
+
+}  // namespace jetson
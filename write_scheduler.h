@@ -0,0 +1,159 @@
+/**
+ * @file write_scheduler.h
+ * @author Caoyang Jiang (caoyangjiang@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright
+ *
+ * Copyright (c) 2020, Caoyang Jiang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <mutex>
+#include <vector>
+#include "types.h"
+
+namespace jetson {
+
+class BinaryController;
+
+/**
+ * @brief Issues output writes at given CLOCK_MONOTONIC instants from a
+ * single timer thread. Pending writes are kept in a min-heap by deadline; a
+ * timerfd armed with the earliest deadline wakes the thread. All writes due
+ * at a wake-up are issued back to back, ordered by gpio chip.
+ *
+ * The thread is started by the first scheduled write.
+ */
+class WriteScheduler {
+ public:
+  WriteScheduler();
+  ~WriteScheduler();
+
+  /**
+   * @brief Schedule writing a level to several outputs at once.
+   *
+   * @param lines the output controllers.
+   * @param level the level to write.
+   * @param deadline_ns when to write, as MonotonicNs(). A deadline in the
+   * past is written right away.
+   * @return id of the scheduled write, never 0.
+   */
+  uint64_t Schedule(const std::vector<BinaryController*>& lines, Signal level,
+                    int64_t deadline_ns);
+
+  /**
+   * @brief Cancel a scheduled write.
+   *
+   * @param id id returned by Schedule.
+   * @return true if the write was still pending.
+   */
+  bool Cancel(uint64_t id);
+
+  /**
+   * @brief Drop the pending writes to a line. Once this returns, no write to
+   * the line is in progress or will happen.
+   *
+   * @param line the controller.
+   */
+  void Remove(BinaryController* line);
+
+  /**
+   * @brief Get the write counts and lateness.
+   */
+  WriteScheduleStats GetStats() const;
+
+  /**
+   * @brief Set how the timer thread runs. Only possible before the thread is
+   * started.
+   *
+   * @param config the config, see CheckRealtimeConfig().
+   * @return false if the thread runs already.
+   */
+  bool SetRealtimeConfig(RealtimeConfig config);
+
+  /**
+   * @brief Leave the timer to the caller's event loop: no thread is started,
+   * due writes are issued by Dispatch(). Only possible before the thread is
+   * started.
+   *
+   * @return false if the thread runs already.
+   */
+  bool UseExternalLoop();
+
+  /**
+   * @brief Get the timerfd to poll for readability in an external loop.
+   */
+  int GetTimerFd() const;
+
+  /**
+   * @brief Issue the writes due. Never blocks.
+   *
+   * @return the number of writes issued.
+   */
+  int Dispatch();
+
+ private:
+  WriteScheduler(const WriteScheduler&) = delete;
+  WriteScheduler(WriteScheduler&&) = delete;
+
+ private:
+  struct Pending {
+    int64_t deadline_ns;
+    uint64_t id;
+    BinaryController* line;
+    Signal level;
+  };
+
+  void Start();
+  void Run();
+  void Fire();
+  void Arm();
+  static bool Later(const Pending& a, const Pending& b);
+
+ private:
+  int timer_ = -1;
+  int wakeup_ = -1;
+  std::once_flag started_;
+  std::future<void> thread_;
+  std::atomic<bool> external_{false};  // driven by Dispatch(), no thread
+  std::mutex realtime_mutex_;
+  RealtimeConfig realtime_;      // fixed once realtime_fixed_
+  bool realtime_fixed_ = false;  // set by Start()
+
+  mutable std::mutex mutex_;
+  std::vector<Pending> heap_;     // earliest deadline first
+  std::map<uint64_t, int> live_;  // lines still to write, by id
+  uint64_t next_id_ = 1;          // 0 is never a valid id
+  int64_t armed_ns_ = 0;          // deadline the timer is set to, 0 if none
+  std::vector<Pending> due_;
+  WriteScheduleStats stats_;
+  int64_t total_late_ns_ = 0;
+};
+
+}  // namespace jetson